@@ -0,0 +1,361 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/classifier/src/linear.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-06_15:12:40
+ * @brief
+ *
+ **/
+
+#include "linear.h"
+
+#include <cmath>
+#include <random>
+#include <fstream>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "glog/logging.h"
+
+namespace chatopera {
+namespace bot {
+namespace classifier {
+
+static const uint32_t LINEAR_MAGIC = 0x4d4c4c43; // "CLLM"
+static const uint32_t LINEAR_FORMAT = 2;
+static const size_t LINEAR_ALIGN = 16;
+
+LinearModel::LinearModel() : _buckets(0), _classes(0), _stride(0), _count(0), _dense(false),
+  _ids(NULL), _rows(NULL) {
+}
+
+LinearModel::~LinearModel() {
+}
+
+size_t LinearModel::classes() const {
+  return _classes;
+}
+
+uint32_t LinearModel::buckets() const {
+  return _buckets;
+}
+
+const std::string& LinearModel::getLabel(const size_t& index) const {
+  return _labels[index];
+}
+
+size_t LinearModel::memoryUsage() const {
+  size_t bytes = _file.isOpen() ? _file.size()
+                 : _weights.size() * sizeof(float) + _trained_ids.size() * sizeof(uint32_t);
+
+  for(const std::string& label : _labels) {
+    bytes += label.size();
+  }
+
+  return bytes;
+}
+
+void LinearModel::features(const std::vector<std::string>& terms, std::vector<uint32_t>& features) const {
+  HashedFeatures(terms, _buckets, features);
+}
+
+void LinearModel::axpyScalar(const float& x, const float* row, float* out, const size_t& n) {
+  for(size_t i = 0; i < n; i++) {
+    out[i] += x * row[i];
+  }
+}
+
+void LinearModel::axpy(const float& x, const float* row, float* out, const size_t& n) {
+#ifdef __SSE2__
+  const __m128 xv = _mm_set1_ps(x);
+
+  for(size_t i = 0; i < n; i += 4) {
+    _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(xv, _mm_loadu_ps(row + i))));
+  }
+
+#else
+  axpyScalar(x, row, out, n);
+#endif
+}
+
+void LinearModel::softmax(float* scores, const size_t& n) {
+  float top = *std::max_element(scores, scores + n);
+  float sum = 0.0;
+
+  for(size_t i = 0; i < n; i++) {
+    scores[i] = std::exp(scores[i] - top);
+    sum += scores[i];
+  }
+
+  for(size_t i = 0; i < n; i++) {
+    scores[i] /= sum;
+  }
+}
+
+/**
+ * 特征对应的行，训练中没有出现过的特征返回NULL
+ */
+inline const float* LinearModel::row(const uint32_t& feature) const {
+  if(_dense) {
+    return feature < _buckets ? _rows + (size_t)(feature + 1) * _stride : NULL;
+  }
+
+  const uint32_t* found = std::lower_bound(_ids, _ids + _count, feature);
+
+  if(found == _ids + _count || *found != feature) {
+    return NULL;
+  }
+
+  return _rows + (size_t)(found - _ids + 1) * _stride;
+}
+
+/**
+ * 偏置加上各特征行，特征取值为 1/sqrt(特征数)
+ */
+void LinearModel::scores(const std::vector<uint32_t>& features, float* out) const {
+  std::copy(_rows, _rows + _stride, out);
+
+  if(features.empty()) {
+    return;
+  }
+
+  const float x = 1.0 / std::sqrt((float) features.size());
+
+  for(const uint32_t& feature : features) {
+    const float* r = row(feature);
+
+    if(r != NULL) {
+      axpy(x, r, out, _stride);
+    }
+  }
+}
+
+void LinearModel::predict(const std::vector<uint32_t>& features, std::vector<float>& probs) const {
+  probs.resize(_stride);
+
+  if(_classes == 0) {
+    probs.clear();
+    return;
+  }
+
+  scores(features, probs.data());
+  probs.resize(_classes);
+  softmax(probs.data(), _classes);
+}
+
+/**
+ * 随机梯度下降，学习率线性衰减；L2只作用于样本涉及的行
+ */
+void LinearModel::train(const std::vector<std::string>& labels,
+                        const std::vector<LinearSample>& samples,
+                        const uint32_t& buckets,
+                        const size_t& epochs,
+                        const float& rate,
+                        const float& l2) {
+  _file.close();
+  _labels = labels;
+  _buckets = buckets;
+  _classes = labels.size();
+  _stride = (_classes + 3) & ~3u;
+  _weights.assign((size_t)(_buckets + 1) * _stride, 0.0);
+  _rows = _weights.data();
+  _dense = true;
+
+  if(_classes == 0 || samples.empty()) {
+    compact();
+    return;
+  }
+
+  std::vector<size_t> order(samples.size());
+
+  for(size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+
+  std::mt19937 rng(20200106);
+  std::vector<float> probs(_stride);
+  const size_t total = epochs * samples.size();
+  size_t step = 0;
+
+  for(size_t epoch = 0; epoch < epochs; epoch++) {
+    std::shuffle(order.begin(), order.end(), rng);
+
+    for(const size_t& index : order) {
+      const LinearSample& sample = samples[index];
+      const float lr = rate * (1.0 - (float) step++ / (float) total);
+
+      scores(sample.second, probs.data());
+      softmax(probs.data(), _classes);
+      // 梯度: p - y
+      probs[sample.first] -= 1.0;
+
+      float* bias = _weights.data();
+
+      for(size_t c = 0; c < _classes; c++) {
+        bias[c] -= lr * probs[c];
+      }
+
+      if(sample.second.empty()) {
+        continue;
+      }
+
+      const float x = 1.0 / std::sqrt((float) sample.second.size());
+
+      for(const uint32_t& feature : sample.second) {
+        float* row = _weights.data() + (size_t)(feature + 1) * _stride;
+
+        for(size_t c = 0; c < _classes; c++) {
+          row[c] -= lr * (probs[c] * x + l2 * row[c]);
+        }
+      }
+    }
+  }
+
+  compact();
+  VLOG(3) << __func__ << " classes: " << _classes << ", samples: " << samples.size()
+          << ", buckets: " << _buckets << ", features: " << _count;
+}
+
+/**
+ * 去掉全为0的行，即样本中没有出现过的特征
+ */
+void LinearModel::compact() {
+  std::vector<float> dense;
+  dense.swap(_weights);
+  _trained_ids.clear();
+  _weights.assign(dense.begin(), dense.begin() + _stride);
+
+  for(uint32_t feature = 0; feature < _buckets; feature++) {
+    const float* begin = dense.data() + (size_t)(feature + 1) * _stride;
+    const float* end = begin + _stride;
+
+    if(std::count(begin, end, 0.0f) < (long) _stride) {
+      _trained_ids.push_back(feature);
+      _weights.insert(_weights.end(), begin, end);
+    }
+  }
+
+  _count = _trained_ids.size();
+  _ids = _trained_ids.data();
+  _rows = _weights.data();
+  _dense = false;
+}
+
+/**
+ * 文件格式: magic, format, buckets, classes, stride, 特征数count, 类别名(长度+字节),
+ * 补齐到16字节后为 count 个升序的特征，再补齐到16字节后为 (count + 1) * stride 个float
+ */
+bool LinearModel::save(const std::string& filepath) const {
+  std::ofstream ofs(filepath.c_str(), std::ios::binary | std::ios::trunc);
+
+  if(!ofs.is_open()) {
+    VLOG(2) << __func__ << " can not open " << filepath;
+    return false;
+  }
+
+  utils::writeBinary(ofs, LINEAR_MAGIC);
+  utils::writeBinary(ofs, LINEAR_FORMAT);
+  utils::writeBinary(ofs, _buckets);
+  utils::writeBinary(ofs, _classes);
+  utils::writeBinary(ofs, _stride);
+  utils::writeBinary(ofs, _count);
+
+  for(const std::string& label : _labels) {
+    utils::writeBinary(ofs, (uint32_t) label.size());
+    utils::writeBinary(ofs, label.data(), label.size());
+  }
+
+  const char padding[LINEAR_ALIGN] = {0};
+  size_t offset = ofs.tellp();
+  utils::writeBinary(ofs, padding, (LINEAR_ALIGN - offset % LINEAR_ALIGN) % LINEAR_ALIGN);
+  utils::writeBinary(ofs, _ids, _count);
+  offset = ofs.tellp();
+  utils::writeBinary(ofs, padding, (LINEAR_ALIGN - offset % LINEAR_ALIGN) % LINEAR_ALIGN);
+  utils::writeBinary(ofs, _rows, (size_t)(_count + 1) * _stride);
+  ofs.close();
+  return !ofs.fail();
+}
+
+bool LinearModel::load(const std::string& filepath) {
+  _weights.clear();
+  _trained_ids.clear();
+  _labels.clear();
+  _ids = NULL;
+  _rows = NULL;
+  _classes = 0;
+  _count = 0;
+  _dense = false;
+
+  if(!_file.open(filepath)) {
+    VLOG(2) << __func__ << " can not open " << filepath;
+    return false;
+  }
+
+  utils::MmapReader reader(_file);
+  uint32_t magic = 0, format = 0, buckets = 0, classes = 0, stride = 0, count = 0;
+
+  if(!reader.read(magic) || !reader.read(format) || magic != LINEAR_MAGIC || format != LINEAR_FORMAT
+      || !reader.read(buckets) || !reader.read(classes) || !reader.read(stride) || !reader.read(count)
+      || buckets == 0 || (buckets & (buckets - 1)) != 0 || stride != ((classes + 3) & ~3u)
+      || count > buckets) {
+    VLOG(2) << __func__ << " invalid model header " << filepath;
+    _file.close();
+    return false;
+  }
+
+  for(uint32_t i = 0; i < classes; i++) {
+    uint32_t size = 0;
+    const char* label = reader.read(size) ? reader.skip(size) : NULL;
+
+    if(label == NULL) {
+      VLOG(2) << __func__ << " truncated labels " << filepath;
+      _file.close();
+      return false;
+    }
+
+    _labels.push_back(std::string(label, size));
+  }
+
+  size_t offset = _file.size() - reader.remaining();
+  reader.skip((LINEAR_ALIGN - offset % LINEAR_ALIGN) % LINEAR_ALIGN);
+  const uint32_t* ids = reinterpret_cast<const uint32_t*>(reader.skip((size_t) count * sizeof(uint32_t)));
+  offset = _file.size() - reader.remaining();
+  reader.skip((LINEAR_ALIGN - offset % LINEAR_ALIGN) % LINEAR_ALIGN);
+  const char* rows = ids == NULL ? NULL : reader.skip((size_t)(count + 1) * stride * sizeof(float));
+
+  for(uint32_t i = 0; rows != NULL && i < count; i++) {
+    if(ids[i] >= buckets || (i > 0 && ids[i - 1] >= ids[i])) {
+      rows = NULL; // 特征须升序且在哈希桶范围内
+    }
+  }
+
+  if(rows == NULL) {
+    VLOG(2) << __func__ << " truncated weights " << filepath;
+    _labels.clear();
+    _file.close();
+    return false;
+  }
+
+  _buckets = buckets;
+  _classes = classes;
+  _stride = stride;
+  _count = count;
+  _ids = ids;
+  _rows = reinterpret_cast<const float*>(rows);
+  VLOG(3) << __func__ << " loaded " << filepath << ", classes: " << _classes << ", buckets: " << _buckets;
+  return true;
+}
+
+} // namespace classifier
+} // namespace bot
+} // namespace chatopera
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,96 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/classifier/src/linear.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-06_15:12:40
+ * @brief
+ * Multinomial logistic regression over hashed features.
+ **/
+
+#ifndef __CHATOPERA_BOT_CLASSIFIER_LINEAR_H__
+#define __CHATOPERA_BOT_CLASSIFIER_LINEAR_H__
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include "MmapFile.hpp"
+#include "ngrams.h"
+
+namespace chatopera {
+namespace bot {
+namespace classifier {
+
+/**
+ * 训练样本：类别下标和特征
+ */
+typedef std::pair<uint32_t, std::vector<uint32_t> > LinearSample;
+
+/**
+ * 线性分类器
+ * 权重按特征存储，每个特征一行，包含所有类别的权重，行宽补齐到4的倍数；
+ * 打分时把查询特征对应的行累加起来，一次得到所有类别的分数。
+ * 训练后只保留样本中出现过的特征行，按特征升序存储，大小与训练语料的特征数成正比，与哈希桶数无关。
+ * 训练结果保存为二进制文件，加载时映射到内存。
+ */
+class LinearModel {
+ public: // constructors
+  LinearModel();
+  ~LinearModel();
+
+ public: // functions
+  void train(const std::vector<std::string>& labels,
+             const std::vector<LinearSample>& samples,
+             const uint32_t& buckets,
+             const size_t& epochs = 10,
+             const float& rate = 0.5,
+             const float& l2 = 1e-6);
+  bool save(const std::string& filepath) const;
+  bool load(const std::string& filepath);
+  void features(const std::vector<std::string>& terms, std::vector<uint32_t>& features) const;
+  // 所有类别的概率，下标与getLabel一致
+  void predict(const std::vector<uint32_t>& features, std::vector<float>& probs) const;
+  size_t classes() const;
+  uint32_t buckets() const;
+  const std::string& getLabel(const size_t& index) const;
+  size_t memoryUsage() const;
+
+ public: // kernels
+  // out[0, n) += x * row[0, n)，n 为4的倍数
+  static void axpy(const float& x, const float* row, float* out, const size_t& n);
+  static void axpyScalar(const float& x, const float* row, float* out, const size_t& n);
+
+ private: // functions
+  const float* row(const uint32_t& feature) const;
+  void scores(const std::vector<uint32_t>& features, float* out) const;
+  void compact();
+  static void softmax(float* scores, const size_t& n);
+
+ private: // members
+  uint32_t _buckets;
+  uint32_t _classes;
+  uint32_t _stride;                       // 每行的float数
+  uint32_t _count;                        // 有权重的特征数
+  bool _dense;                            // 训练中，每个哈希桶一行
+  std::vector<std::string> _labels;
+  std::vector<uint32_t> _trained_ids;     // 训练得到的有权重的特征
+  std::vector<float> _weights;            // 训练得到的权重，第一行为偏置
+  const uint32_t* _ids;                   // 有权重的特征，升序，指向_trained_ids或映射的文件
+  const float* _rows;                     // 偏置和_ids对应的行，指向_weights或映射的文件
+  chatopera::utils::MmapFile _file;
+};
+
+} // namespace classifier
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,88 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/classifier/src/ngrams.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-06_15:12:40
+ * @brief
+ * Hashed word and character n-gram features of an utterance.
+ **/
+
+#ifndef __CHATOPERA_BOT_CLASSIFIER_NGRAMS_H__
+#define __CHATOPERA_BOT_CLASSIFIER_NGRAMS_H__
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include "StringUtils.hpp"
+
+namespace chatopera {
+namespace bot {
+namespace classifier {
+
+/**
+ * FNV-1a，kind 区分特征类型，避免词和字的哈希冲突
+ */
+inline uint32_t HashFeature(const char& kind, const std::string& lhs, const std::string& rhs = std::string()) {
+  uint32_t hash = 2166136261u;
+  hash = (hash ^ (unsigned char) kind) * 16777619u;
+
+  for(const char& c : lhs) {
+    hash = (hash ^ (unsigned char) c) * 16777619u;
+  }
+
+  for(const char& c : rhs) {
+    hash = (hash ^ (unsigned char) c) * 16777619u;
+  }
+
+  return hash;
+}
+
+/**
+ * 分词结果的特征：词、字、相邻两字，首尾用 ^ $ 补齐
+ * buckets 为2的幂，输出升序去重的特征下标
+ */
+inline void HashedFeatures(const std::vector<std::string>& terms,
+                           const uint32_t& buckets,
+                           std::vector<uint32_t>& features) {
+  features.clear();
+  const uint32_t mask = buckets - 1;
+  std::vector<std::string> chars;
+  std::vector<std::string> chs;
+
+  for(const std::string& term : terms) {
+    features.push_back(HashFeature('w', term) & mask);
+    chatopera::utils::CharSegment(term, chs);
+    chars.insert(chars.end(), chs.begin(), chs.end());
+  }
+
+  std::string prev("^");
+
+  for(const std::string& ch : chars) {
+    features.push_back(HashFeature('c', ch) & mask);
+    features.push_back(HashFeature('b', prev, ch) & mask);
+    prev = ch;
+  }
+
+  if(!chars.empty()) {
+    features.push_back(HashFeature('b', prev, "$") & mask);
+  }
+
+  std::sort(features.begin(), features.end());
+  features.erase(std::unique(features.begin(), features.end()), features.end());
+}
+
+} // namespace classifier
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,180 @@
+/*
+ * linear intent classifier.
+ *
+ * @author   hain
+ * @email    hain@chatopera.com
+ */
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include <set>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdio>
+#include <fstream>
+#include "linear.h"
+
+using namespace std;
+using namespace chatopera::bot::classifier;
+
+static const uint32_t TEST_BUCKETS = 1 << 12;
+
+/**
+ * 三个意图的分词样例
+ */
+static void fixture(LinearModel& model, vector<string>& labels, vector<LinearSample>& samples) {
+  const vector<vector<vector<string> > > utterances = {
+    {{"查", "一下", "天气"}, {"明天", "天气", "怎么样"}, {"今天", "下雨", "吗"}, {"@LOC", "的", "天气"}},
+    {{"订", "一张", "机票"}, {"帮", "我", "买", "机票"}, {"明天", "去", "@LOC", "的", "航班"}, {"订", "机票"}},
+    {{"我", "要", "退货"}, {"怎么", "退款"}, {"订单", "退货"}, {"申请", "退款", "吧"}}
+  };
+  labels = {"weather", "flight", "refund"};
+
+  for(size_t c = 0; c < utterances.size(); c++) {
+    for(const vector<string>& terms : utterances[c]) {
+      vector<uint32_t> features;
+      HashedFeatures(terms, TEST_BUCKETS, features);
+      samples.push_back(make_pair((uint32_t) c, features));
+    }
+  }
+
+  model.train(labels, samples, TEST_BUCKETS, 30);
+}
+
+static size_t argmax(const vector<float>& probs) {
+  return std::max_element(probs.begin(), probs.end()) - probs.begin();
+}
+
+TEST(ClassifierTest, FEATURES) {
+  vector<uint32_t> features;
+  HashedFeatures({"天气", "好"}, TEST_BUCKETS, features);
+  // 2个词，3个字，4个相邻字
+  EXPECT_LE(features.size(), 9);
+  EXPECT_TRUE(std::is_sorted(features.begin(), features.end()));
+
+  for(const uint32_t& feature : features) {
+    EXPECT_LT(feature, TEST_BUCKETS);
+  }
+
+  HashedFeatures({}, TEST_BUCKETS, features);
+  EXPECT_TRUE(features.empty());
+}
+
+TEST(ClassifierTest, TRAIN_PREDICT) {
+  LinearModel model;
+  vector<string> labels;
+  vector<LinearSample> samples;
+  fixture(model, labels, samples);
+  ASSERT_EQ(model.classes(), 3);
+
+  vector<float> probs;
+
+  for(const LinearSample& sample : samples) {
+    model.predict(sample.second, probs);
+    ASSERT_EQ(probs.size(), 3);
+    EXPECT_EQ(argmax(probs), sample.first);
+  }
+
+  vector<uint32_t> features;
+  model.features({"后天", "天气"}, features);
+  model.predict(features, probs);
+  EXPECT_EQ(model.getLabel(argmax(probs)), "weather");
+
+  model.features({"退款"}, features);
+  model.predict(features, probs);
+  EXPECT_EQ(model.getLabel(argmax(probs)), "refund");
+
+  // 没有见过的特征不影响分数
+  vector<float> bias, unseen;
+  model.predict({}, bias);
+  model.features({"荧光", "棒"}, features);
+  model.predict(features, unseen);
+  ASSERT_EQ(unseen.size(), bias.size());
+
+  for(size_t c = 0; c < bias.size(); c++) {
+    EXPECT_FLOAT_EQ(unseen[c], bias[c]);
+  }
+}
+
+/**
+ * 只保存样本中出现过的特征，与哈希桶数无关
+ */
+TEST(ClassifierTest, SPARSE_ROWS) {
+  LinearModel model;
+  vector<string> labels;
+  vector<LinearSample> samples;
+  fixture(model, labels, samples);
+
+  std::set<uint32_t> seen;
+
+  for(const LinearSample& sample : samples) {
+    seen.insert(sample.second.begin(), sample.second.end());
+  }
+
+  const size_t stride = 4;
+  EXPECT_LE(model.memoryUsage(), (seen.size() + 1) * stride * sizeof(float)
+            + seen.size() * sizeof(uint32_t) + 64);
+  EXPECT_LT(model.memoryUsage(), (size_t) TEST_BUCKETS * stride * sizeof(float) / 10);
+}
+
+TEST(ClassifierTest, SAVE_LOAD) {
+  LinearModel model;
+  vector<string> labels;
+  vector<LinearSample> samples;
+  fixture(model, labels, samples);
+
+  const string filepath = "classifier.test.linear.bin";
+  ASSERT_TRUE(model.save(filepath));
+
+  LinearModel loaded;
+  ASSERT_TRUE(loaded.load(filepath));
+  ASSERT_EQ(loaded.classes(), model.classes());
+  EXPECT_EQ(loaded.buckets(), model.buckets());
+
+  for(size_t c = 0; c < labels.size(); c++) {
+    EXPECT_EQ(loaded.getLabel(c), labels[c]);
+  }
+
+  vector<float> expected, probs;
+
+  for(const LinearSample& sample : samples) {
+    model.predict(sample.second, expected);
+    loaded.predict(sample.second, probs);
+    ASSERT_EQ(probs.size(), expected.size());
+
+    for(size_t c = 0; c < probs.size(); c++) {
+      EXPECT_FLOAT_EQ(probs[c], expected[c]);
+    }
+  }
+
+  // 截断的文件不能加载
+  std::ifstream ifs(filepath.c_str(), std::ios::binary);
+  string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  std::ofstream ofs(filepath.c_str(), std::ios::binary | std::ios::trunc);
+  ofs.write(data.data(), data.size() / 2);
+  ofs.close();
+  EXPECT_FALSE(loaded.load(filepath));
+  std::remove(filepath.c_str());
+}
+
+TEST(ClassifierTest, AXPY_KERNEL) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> dist(-1.0, 1.0);
+
+  for(size_t n = 4; n <= 128; n += 4) {
+    vector<float> row(n), lhs(n), rhs(n);
+
+    for(size_t i = 0; i < n; i++) {
+      row[i] = dist(rng);
+      lhs[i] = rhs[i] = dist(rng);
+    }
+
+    LinearModel::axpy(0.37, row.data(), lhs.data(), n);
+    LinearModel::axpyScalar(0.37, row.data(), rhs.data(), n);
+
+    for(size_t i = 0; i < n; i++) {
+      EXPECT_FLOAT_EQ(lhs[i], rhs[i]);
+    }
+  }
+}
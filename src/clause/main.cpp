@@ -38,15 +38,36 @@ DEFINE_string(redis_host, "", "Redis IP Host");
 DEFINE_int32(redis_port, 6379, "Redis port");
 DEFINE_int32(redis_db, 5, "Redis Database number, [0-15]");
 DEFINE_string(redis_pass, "", "Redis Auth pass.");
+DEFINE_int32(redis_pool_size, 32, "Redis connection pool size, shared by serving threads.");
 
 // sysdicts
 DEFINE_string(sysdicts_host, "sysdicts", "Chatopera Sysdicts Service Host");
 DEFINE_int32(sysdicts_port, 8066, "Chatopera Sysdicts Service Port");
+DEFINE_bool(sysdicts_inproc, false, "Label sysdicts with LAC in process, requires building with CLAUSE_WITH_INPROC_LAC");
+DEFINE_string(sysdicts_lac_conf_dir, "../../../../var/data/lac/conf", "Baidu LAC Config dir for in process labeling");
+
+// bots
+DEFINE_int32(bot_version_reconcile_interval, 10, "Seconds between reconciling local bot versions with Redis, 0 reads Redis on every chat.");
+DEFINE_int32(bot_loader_threads, 2, "Background threads loading new bot versions, 0 loads in the requesting thread.");
+DEFINE_int32(bot_warmup_queries, 3, "Sample utterances run through a new bot version before it serves.");
+DEFINE_int32(bot_memory_budget_mb, 0, "Estimated memory budget of loaded bots, idle bots are evicted LRU when exceeded, 0 is unlimited.");
+DEFINE_int32(bot_evict_idle_seconds, 300, "Bots used within this period are never evicted.");
+DEFINE_int32(bot_stats_interval, 60, "Seconds between logging loaded bot statistics, 0 disables it.");
+DEFINE_int32(bot_leveldb_cache_mb, 32, "Block cache shared by dictwords leveldb of all bots.");
+DEFINE_int32(bot_preload_threads, 4, "Threads loading online production bots at startup, 0 disables preloading.");
+DEFINE_double(bot_preload_ready_ratio, 1.0, "Fraction of online production bots loaded before serving starts.");
+DEFINE_int32(bot_load_retry_seconds, 10, "Seconds before retrying a bot version that failed to load, doubled on each failure.");
+DEFINE_int32(bot_load_retry_max_seconds, 600, "Upper bound of the retry backoff of a bot version that failed to load.");
 
 // miscs
 DEFINE_string(workarea, "../../../../var/trainer/workarea", "Generated and captured models, bot dicts, indexes.");
 DEFINE_string(data, "../../../../var/trainer/data", "Prebuilt data, templates, dicts etc.");
 DEFINE_double(intent_classify_threshold, 0.9, "Threshold for classify intent.");
+DEFINE_bool(intent_recall_index, true, "Recall intent candidates from an in-memory index built at bot loading instead of Xapian.");
+DEFINE_int32(intent_recall_depth, 10, "Number of recalled candidates scored for intent classification.");
+DEFINE_string(intent_classify_mode, "recall", "Intent classification: recall, or linear to score all intents with the trained linear model first.");
+DEFINE_double(intent_linear_threshold, 0.6, "Minimum probability to accept the linear classifier result.");
+DEFINE_double(intent_linear_margin, 0.2, "Minimum lead over the second intent to skip recall as tie-breaker.");
 
 using namespace std;
 using namespace ::chatopera::bot::clause;
@@ -15,29 +15,117 @@
 #include "bot.h"
 #include "crfsuite.hpp"
 #include "tsl/serialize.hpp"
+#include "leveldb/cache.h"
 
 namespace chatopera {
 namespace bot {
 namespace clause {
 
-Bot::Bot() {
-  _similarity = new chatopera::bot::distance::Similarity();
+/**
+ * 所有BOT的自定义词典leveldb共用一个块缓存，总量由 bot_leveldb_cache_mb 限制，不计入单个BOT
+ */
+static leveldb::Cache* dictwords_block_cache() {
+  static leveldb::Cache* cache = leveldb::NewLRUCache((size_t)FLAGS_bot_leveldb_cache_mb << 20);
+  return cache;
+}
+
+/**
+ * 文件或目录下所有文件的字节数
+ */
+static size_t artifact_size(const fs::path& path) {
+  boost::system::error_code ec;
+
+  if(fs::is_regular_file(path, ec)) {
+    return fs::file_size(path, ec);
+  }
+
+  size_t bytes = 0;
+
+  if(fs::is_directory(path, ec)) {
+    for(fs::recursive_directory_iterator it(path, ec), end; it != end; it.increment(ec)) {
+      if(ec) {
+        break;
+      }
+
+      if(fs::is_regular_file(it->path(), ec)) {
+        bytes += fs::file_size(it->path(), ec);
+      }
+    }
+  }
+
+  return bytes;
+}
+
+/**
+ * 用dictnames中词典的表达式生成组合匹配器，没有表达式时返回NULL
+ */
+static PatternDictMatcher* build_pattern_matcher(const std::vector<pair<const intent::TDict*, CompiledPattern> >& patterns,
+    const std::set<string>& dictnames) {
+  PatternDictMatcher* matcher = NULL;
+
+  for(const pair<const intent::TDict*, CompiledPattern>& p : patterns) {
+    if(dictnames.count(p.first->name()) == 0)
+      continue;
+
+    if(matcher == NULL)
+      matcher = new PatternDictMatcher();
+
+    matcher->add(p.first->name(), p.first->id(), p.second);
+  }
+
+  if(matcher != NULL)
+    matcher->build();
+
+  return matcher;
+}
+
+Bot::Bot() :
+  _mysql(NULL),
+  _redis(NULL),
+  _tokenizer(NULL),
+  _taggers(NULL),
+  _ner_attributes(NULL),
+  _recall(NULL),
+  _recall_index(NULL),
+  _linear(NULL),
+  _profile(NULL),
+  _similarity(new chatopera::bot::distance::Similarity()),
+  _dictwords(NULL),
+  _dictwords_members(NULL),
+  _dictwords_leveldb(NULL),
+  _referred_sysdicts(NULL),
+  _pattern_dicts(NULL),
+  _pattern_matcher(NULL),
+  _footprint(0) {
 };
 
 Bot::~Bot() {
   delete _referred_sysdicts;
   delete _profile;
-  delete _dictwords_triedb;
+  delete _dictwords;
+  delete _dictwords_members;
   delete _dictwords_leveldb;
   delete _similarity;
   delete _pattern_dicts;
+  delete _pattern_matcher;
+
+  for(std::map<string, PatternDictMatcher*>::iterator it = _intent_pattern_matchers.begin();
+      it != _intent_pattern_matchers.end(); it++) {
+    delete it->second;
+  }
+
+  delete _recall_index;
+  delete _linear;
   // Jieba分词
   delete _tokenizer;
   // crfsuite tagger
-  delete _tagger;
-  // 关闭xapian搜索引擎
-  _recall->close();
-  delete _recall;
+  delete _taggers;
+  delete _ner_attributes;
+  // 关闭xapian搜索引擎，加载失败时可能未打开
+  if(_recall != NULL) {
+    _recall->close();
+    delete _recall;
+  }
 };
 
 /**
@@ -62,11 +150,24 @@ bool Bot::init(const string& chatbotID,
     ss << FLAGS_workarea << "/" << chatbotID << "/" << buildver;
     string verdir = ss.str();
     string dictdir = verdir + "/jieba";
-    _tokenizer = new cppjieba::Jieba( dictdir + "/jieba.dict.utf8",
-                                      dictdir + "/hmm_model.utf8",
-                                      dictdir + "/user.dict.utf8",
-                                      dictdir + "/idf.utf8",
-                                      dictdir + "/stop_words.utf8");
+    // 基础词典、HMM模型在进程内按内容共享，机器人只加载自己的用户词典；
+    // 使用版本目录下训练时的拷贝，缺失时才使用数据目录下的默认词典
+    string basedir = dictdir;
+
+    if(!fs::exists(basedir + "/jieba.dict.utf8")) {
+      VLOG(2) << __func__ << " missing jieba dict in " << dictdir << ", use default dict.";
+      basedir = FLAGS_data + "/jieba/default";
+    }
+
+    // 训练时生成的二进制词典，与文本词典不符时仍解析文本
+    string binfile = basedir + "/" + cppjieba::JIEBA_BINARY_FILE;
+
+    _tokenizer = new cppjieba::Jieba(cppjieba::JiebaBase::Get(basedir + "/jieba.dict.utf8",
+                                     basedir + "/hmm_model.utf8",
+                                     basedir + "/idf.utf8",
+                                     basedir + "/stop_words.utf8",
+                                     binfile),
+                                     dictdir + "/user.dict.utf8");
 
     VLOG(3) << __func__ << " tokenizer successfully.";
 
@@ -75,24 +176,57 @@ bool Bot::init(const string& chatbotID,
     _recall = new Xapian::Database(verdir + "/xapian");
     VLOG(3) << __func__ << " xapian successfully.";
 
+    // 构建内存召回索引，成功后不再需要xapian
+    if(FLAGS_intent_recall_index) {
+      _recall_index = new RecallIndex();
+
+      if(_recall_index->build(*_recall)) {
+        _recall->close();
+        delete _recall;
+        _recall = NULL;
+      } else {
+        VLOG(2) << __func__ << " fail to build recall index, use xapian. chatbotID: " << chatbotID;
+        delete _recall_index;
+        _recall_index = NULL;
+      }
+    }
+
+    // 线性意图分类器，早期训练的版本没有该文件时只用召回
+    if(FLAGS_intent_classify_mode == "linear") {
+      _linear = new chatopera::bot::classifier::LinearModel();
+
+      if(!_linear->load(verdir + "/" + CL_INTENT_LINEAR_MODEL) || _linear->classes() == 0) {
+        VLOG(2) << __func__ << " no linear classifier, use recall. chatbotID: " << chatbotID << ", version: " << buildver;
+        delete _linear;
+        _linear = NULL;
+      }
+    }
+
     // 初始化crfsuire tagger
     VLOG(3) << __func__ << " tagger ...";
-    _tagger = new chatopera::bot::crfsuite::Tagger();
+    _taggers = new chatopera::bot::crfsuite::TaggerPool();
 
-    if(!_tagger->open(verdir + "/crfsuite.ner.model")) {
+    if(!_taggers->open(verdir + "/crfsuite.ner.model")) {
       // TODO 可能因训练失败而导致没有NER model的情况：原因比如机器人没有一个合理的说法
       VLOG(2) << __func__ << " fail to open crfsuite model for chatbotID: " << chatbotID << ", branch: " << branch << ", version: " << buildver;
       result = false;
+    } else {
+      // 预先解析模型的属性表，标注时不再构造特征字符串
+      _ner_attributes = new NerAttributes();
+      crfsuite::ScopedTagger tagger(*_taggers);
+      _ner_attributes->build(tagger->attributes());
     }
 
     VLOG(3) << __func__ << " tagger successfully.";
 
-    // 初始化 dictwords
-    VLOG(3) << __func__ << " dictwords hat-trie ...";
+    // 初始化 dictwords：映射训练生成的AC自动机，同一版本的多个进程共用映射的页面
+    // 之前训练的版本没有该文件，解压并反序列化 hat-trie，在内存中生成
+    VLOG(3) << __func__ << " dictwords automaton ...";
     string dictwordsfile(verdir + "/dictwords.trie.bin");
-    _dictwords_triedb = new tsl::htrie_map<char, set<string> >();
+    _dictwords = new chatopera::utils::DictwordsAutomaton();
 
-    {
+    if(!_dictwords->open(verdir + "/" + CL_DICTWORDS_AUTOMATON)) {
+      tsl::htrie_map<char, set<string> > dictwords;
       std::ifstream ifs;
       ifs.exceptions(ifs.badbit | ifs.failbit | ifs.eofbit);
       ifs.open(dictwordsfile, std::ios::binary);
@@ -103,22 +237,47 @@ bool Bot::init(const string& chatbotID,
 
       boost::archive::binary_iarchive ia(fi);
 
-      ia >> (*_dictwords_triedb);
-    }
-    VLOG(3) << __func__ << " dictwords hat-trie successfully.";
+      ia >> dictwords;
+      chatopera::utils::DictwordsAutomatonBuilder builder;
+      string bytes;
 
-    // 初始化自定义词典词条的leveldb
-    VLOG(3) << __func__ << " dictwords leveldb ...";
-    leveldb::Options options;
-    options.create_if_missing = true;
-    options.error_if_exists = false;
-    leveldb::Status status = leveldb::DB::Open(options, verdir + "/leveldb", &_dictwords_leveldb);
+      for(auto it = dictwords.begin(); it != dictwords.end(); ++it) {
+        for(const string& dictname : it.value()) {
+          builder.add(it.key(), dictname);
+        }
+      }
 
-    if(!status.ok()) {
-      VLOG(3) << __func__ << " warn: can not load leveldb in " << verdir << "/leveldb";
+      if(!builder.save(bytes) || !_dictwords->assign(bytes)) {
+        VLOG(2) << __func__ << " fail to build dictwords automaton " << dictwordsfile;
+        result = false;
+      }
     }
+    VLOG(3) << __func__ << " dictwords automaton successfully.";
+
+    // 初始化自定义词典词条的成员表，映射后不占用文件句柄
+    // 之前训练的版本没有成员表，仍然打开leveldb
+    VLOG(3) << __func__ << " dictwords membership table ...";
+    _dictwords_members = new chatopera::utils::MembershipTable();
+
+    if(_dictwords_members->open(verdir + "/" + CL_DICTWORDS_MEMBERSHIP)) {
+      VLOG(3) << __func__ << " dictwords membership table successfully. words: " << _dictwords_members->size();
+    } else {
+      delete _dictwords_members;
+      _dictwords_members = NULL;
+
+      VLOG(3) << __func__ << " dictwords leveldb ...";
+      leveldb::Options options;
+      options.create_if_missing = true;
+      options.error_if_exists = false;
+      options.block_cache = dictwords_block_cache();
+      leveldb::Status status = leveldb::DB::Open(options, verdir + "/leveldb", &_dictwords_leveldb);
+
+      if(!status.ok()) {
+        VLOG(3) << __func__ << " warn: can not load leveldb in " << verdir << "/leveldb";
+      }
 
-    VLOG(3) << __func__ << " dictwords leveldb successfully.";
+      VLOG(3) << __func__ << " dictwords leveldb successfully.";
+    }
 
     // 初始化 profile
     VLOG(3) << __func__ << " profile ...";
@@ -133,16 +292,51 @@ bool Bot::init(const string& chatbotID,
 
     // 初始化正则表达式词典
     _pattern_dicts = new std::vector<pair<string, intent::TDict> >();
+    std::vector<pair<const intent::TDict*, CompiledPattern> > patterns;
 
     for(const intent::TDict& dict : _profile->dicts()) {
       if(dict.type() != CL_DICT_TYPE_PATTERN)
         continue;
 
-      if(dict.has_dictpattern())
+      if(dict.has_dictpattern()) {
         _pattern_dicts->push_back(std::make_pair(dict.name(), dict));
+
+        // 表达式只在加载时编译一次，对话时只读共享
+        for(const std::string& pattern : dict.dictpattern().patterns()) {
+          try {
+            patterns.push_back(std::make_pair(&dict, CompiledPattern(pattern)));
+          } catch(boost::regex_error& e) {
+            VLOG(2) << __func__ << " discard invalid pattern: " << pattern << ", dictname: " << dict.name() << ", error: " << e.what();
+          }
+        }
+      }
+    }
+
+    // 组合表达式在同一位置只保留第一个命中的分支，
+    // 所以按意图只组合其槽位引用的词典，避免无关词典遮蔽相关词典的匹配
+    std::set<string> related;
+
+    for(const intent::TIntent& i : _profile->intents()) {
+      std::set<string> dictnames;
+
+      for(const intent::TIntentSlot& slot : i.slots()) {
+        dictnames.insert(slot.dictname());
+      }
+
+      related.insert(dictnames.begin(), dictnames.end());
+      PatternDictMatcher* matcher = build_pattern_matcher(patterns, dictnames);
+
+      if(matcher != NULL) {
+        delete _intent_pattern_matchers[i.name()];
+        _intent_pattern_matchers[i.name()] = matcher;
+      }
     }
 
-    VLOG(3) << __func__ << " loaded pattern dict size: " << _pattern_dicts->size();
+    // 还没有确定意图时，使用所有意图引用的词典
+    _pattern_matcher = build_pattern_matcher(patterns, related);
+
+    VLOG(3) << __func__ << " loaded pattern dict size: " << _pattern_dicts->size()
+            << ", intent matchers: " << _intent_pattern_matchers.size();
 
     // 获得所有引用的系统词典
     VLOG(3) << __func__ << " sysdicts ...";
@@ -158,6 +352,18 @@ bool Bot::init(const string& chatbotID,
 
     VLOG(3) << __func__ << " sysdicts successfully. dictnames: " << boost::join(*_referred_sysdicts, "\t");
 
+    // 估算内存占用：分词器只计算自己的用户词典，基础词典在进程内共享；
+    // 未使用内存召回索引时的xapian检索缓存、crfsuite模型和profile按文件大小估算
+    _footprint += _tokenizer->GetDictTrie()->MemoryUsage()
+                  + (_recall_index != NULL ? _recall_index->memoryUsage() : artifact_size(verdir + "/xapian"))
+                  + (_linear != NULL ? _linear->memoryUsage() : 0)
+                  + (_ner_attributes != NULL ? _ner_attributes->memoryUsage() : 0)
+                  + _dictwords->memoryUsage()
+                  + (_dictwords_members != NULL ? _dictwords_members->memoryUsage() : 0)
+                  + artifact_size(verdir + "/crfsuite.ner.model")
+                  + artifact_size(verdir + "/profile.pbs");
+    VLOG(3) << __func__ << " estimated footprint: " << _footprint << " bytes";
+
   } catch(std::exception ex) {
     VLOG(2) << __func__ << " bot fails. chatbotID: " << chatbotID << ", branch: " << branch << ", buildver: " << buildver;
     VLOG(2) << __func__ << ex.what();
@@ -183,16 +389,136 @@ string Bot::getBuildver() {
   return _buildver;
 };
 
+/**
+ * 估算的内存占用字节数，加载完成后不再变化
+ */
+size_t Bot::getFootprint() const {
+  return _footprint;
+};
+
 void Bot::tokenize(const string& query, std::vector<pair<string, string> >& tokens) {
   _tokenizer->Tag(query, tokens);
 };
 
 /**
  * 意图识别
- * 从xapian数据库中找回候选集并进行比较，得到最匹配的作为意图
+ * --intent_classify_mode=linear 且版本中有线性分类器时先用分类器，否则召回后比较相似度
  */
 bool Bot::classify(const std::vector<pair<string, string> >& query,
-                   const string& intentName) {
+                   string& intentName) {
+  if(_linear != NULL) {
+    return classifyWithLinear(query, intentName);
+  }
+
+  return classifyWithRecall(query, intentName);
+};
+
+/**
+ * 线性分类器一次得到所有意图的概率
+ * 最高概率不低于阈值且领先第二名足够多时直接采用，否则由召回和相似度决定，
+ * 召回也没有结果时再采用分类器过阈值的结果
+ */
+bool Bot::classifyWithLinear(const std::vector<pair<string, string> >& query,
+                             string& intentName) {
+  vector<string> terms;
+  terms.reserve(query.size());
+
+  for(const pair<string, string>& token : query) {
+    terms.push_back(token.first);
+  }
+
+  vector<uint32_t> features;
+  vector<float> probs;
+  _linear->features(terms, features);
+  _linear->predict(features, probs);
+
+  size_t top = 0;
+  float second = 0.0;
+
+  for(size_t i = 1; i < probs.size(); i++) {
+    if(probs[i] > probs[top]) {
+      second = probs[top];
+      top = i;
+    } else if(probs[i] > second) {
+      second = probs[i];
+    }
+  }
+
+  VLOG(3) << __func__ << " intent: " << _linear->getLabel(top) << " prob: " << probs[top] << " second: " << second;
+
+  if(probs[top] >= FLAGS_intent_linear_threshold && probs[top] - second >= FLAGS_intent_linear_margin) {
+    intentName = _linear->getLabel(top);
+    return true;
+  }
+
+  if(classifyWithRecall(query, intentName)) {
+    return true;
+  }
+
+  if(probs[top] >= FLAGS_intent_linear_threshold) {
+    intentName = _linear->getLabel(top);
+    return true;
+  }
+
+  return false;
+};
+
+/**
+ * 从内存召回索引中找回候选集并进行比较，得到最匹配的作为意图
+ * 候选说法在加载时已切分、编码并排序，请求期间只处理query本身
+ */
+bool Bot::classifyWithRecall(const std::vector<pair<string, string> >& query,
+                             string& intentName) {
+  if(_recall_index == NULL) {
+    return classifyWithXapian(query, intentName);
+  }
+
+  vector<string> terms;
+  vector<uint32_t> lhschs;
+  terms.reserve(query.size());
+
+  for(const pair<string, string>& token : query) {
+    terms.push_back(token.first);
+    distance::AppendCharCodes(token.first, lhschs);
+  }
+
+  std::sort(lhschs.begin(), lhschs.end());
+
+  vector<uint32_t> hits;
+  _recall_index->search(terms, FLAGS_intent_recall_depth, hits);
+  VLOG(3) << __func__ << " " << hits.size() << " results found.";
+
+  if(hits.empty()) {
+    VLOG(3) << __func__ << " No relevant data for utterance: " << query;
+    return false;
+  }
+
+  vector<pair<const uint32_t*, const uint32_t*> > candidates(hits.size());
+
+  for(size_t i = 0; i < hits.size(); i++) {
+    _recall_index->getChars(hits[i], candidates[i].first, candidates[i].second);
+  }
+
+  // 先用上界剪枝，只对可能胜出的候选计算编辑距离
+  double score = 0.0;
+  int best = _similarity->best(lhschs.data(), lhschs.size(), candidates,
+                               FLAGS_intent_classify_threshold, score);
+
+  if(best < 0) {
+    return false;
+  }
+
+  intentName = _recall_index->getIntentName(hits[best]);
+  VLOG(3) << __func__ << " intent: " << intentName << " score: " << score;
+  return true;
+};
+
+/**
+ * 意图识别
+ * 从xapian数据库中找回候选集并进行比较，得到最匹配的作为意图
+ */
+bool Bot::classifyWithXapian(const std::vector<pair<string, string> >& query,
+                             string& intentName) {
   _recall->reopen();
   // Start an enquire session.
   Xapian::Enquire enquire(*_recall);
@@ -217,9 +543,9 @@ bool Bot::classify(const std::vector<pair<string, string> >& query,
   Xapian::Query q(Xapian::Query::OP_ELITE_SET, conditions.begin(), conditions.end(), 30);
   VLOG(3) << __func__ << " parsed query is:" << q.get_description();
 
-  // Find the top 10 results for the query.
+  // Find the top results for the query.
   enquire.set_query(q);
-  Xapian::MSet matches = enquire.get_mset(0, 10);
+  Xapian::MSet matches = enquire.get_mset(0, FLAGS_intent_recall_depth);
 
   VLOG(3) << __func__ << " " << matches.get_matches_estimated() << " results found.";
   VLOG(3) << __func__ << " Matches 1-" << matches.size() << ":\n";
@@ -313,7 +639,7 @@ inline void setupNerItemSequence(const vector<string>& terms,
   const signed int length = (terms.size() - 1);
 
   // 标识位
-  signed int curr, pre2, pre1, post1, post2;
+  signed int curr = 0, pre2, pre1, post1, post2;
 
   vector<string>::const_iterator term = terms.begin();
   vector<string>::const_iterator pos  = poss.begin();
@@ -505,6 +831,27 @@ inline void setupNerItemSequence(const vector<string>& terms,
   };
 }
 
+/**
+ * NER标注
+ * 有属性表时直接按属性ID输入模型，特征和缓冲区都不分配字符串
+ * 每次从池中取出一个tagger，并发请求各自使用独立的lattice
+ */
+vector<string> Bot::tagEntities(const vector<string>& terms,
+                                const vector<string>& poss) {
+  if(_ner_attributes != NULL) {
+    static thread_local vector<int> aids;
+    static thread_local vector<size_t> offsets;
+    _ner_attributes->extract(terms, poss, aids, offsets);
+    crfsuite::ScopedTagger tagger(*_taggers);
+    return tagger->tag(aids.data(), offsets.data(), terms.size());
+  }
+
+  crfsuite::ItemSequence xseq;
+  setupNerItemSequence(terms, poss, xseq);
+  crfsuite::ScopedTagger tagger(*_taggers);
+  return tagger->tag(xseq);
+};
+
 /**
  * 从ner的返回结果中获得实体信息
  */
@@ -554,20 +901,27 @@ inline bool extract_slot_candidates_with_yseq(const vector<string>& terms,
 
 /**
  * if customized dicts contains word
+ * 优先查成员表，版本没有成员表时查leveldb
  */
-inline bool lookup_word_by_dictname_in_leveldb(const leveldb::DB& db,
-    const string& dictname,
-    const string& word) {
+inline bool lookup_word_by_dictname(const chatopera::utils::MembershipTable* members,
+                                    leveldb::DB* db,
+                                    const string& dictname,
+                                    const string& word) {
   VLOG(3) << __func__ << " dictname: " << dictname << ", word: " << word;
+  bool found = false;
 
-  stringstream ss;
-  ss << dictname << '\001' << word;
-  string start(ss.str());
-  leveldb::Slice key = start;
-  std::string value;
-  leveldb::Status s = db.Get(leveldb::ReadOptions(), key, &value);
+  if(members != NULL) {
+    found = members->contains(dictname, word);
+  } else if(db != NULL) {
+    stringstream ss;
+    ss << dictname << '\001' << word;
+    string start(ss.str());
+    leveldb::Slice key = start;
+    std::string value;
+    found = db->Get(leveldb::ReadOptions(), key, &value).ok();
+  }
 
-  if(s.ok()) {
+  if(found) {
     VLOG(3) << __func__ << " db " << dictname << "  contains word " << word;
     return true;
   } else {
@@ -580,63 +934,20 @@ inline bool lookup_word_by_dictname_in_leveldb(const leveldb::DB& db,
 /**
  * 检索执行词典的命名实体
  * 当前指定匹配到词典名称，即便在实体词典中查找到其他选项也忽略
+ * matches 为自动机对整句的匹配结果，各槽位共用
  */
-inline bool extract_slotvalue_from_utterence_with_triedata(const tsl::htrie_map<char, set<string> >& dictwords,
-    const string& query,
+inline bool extract_slotvalue_from_dictwords_matches(const chatopera::utils::DictwordsAutomaton& dictwords,
+    const vector<chatopera::utils::DictwordsMatch>& matches,
     const string& dictname,
     string& slotvalue) {
-  VLOG(3) << __func__ << " query: " << query << ", find dictname " << dictname;
+  VLOG(3) << __func__ << " matches: " << matches.size() << ", find dictname " << dictname;
 
-  // 直接匹配
-  auto match = dictwords.longest_prefix(query);
-
-  if(match != dictwords.end()) {
-    string key = match.key();
-    VLOG(3) << __func__ << " word " << match.key() << ", dictname "
-            << *match;
-
-    if((*match).find(dictname) != (*match).end() ) {
-      slotvalue = key;
-      return true;
-    }
-  }
-
-  vector<string> chs;
-  CharSegment(query, chs);
-
-  size_t length = chs.size();
-
-  if(length <= 1) {
-    return false;
+  if(dictwords.extract(matches, dictname, slotvalue)) {
+    VLOG(3) << __func__ << " word " << slotvalue << ", dictname " << dictname;
+    return true;
   }
 
-  vector<string>::iterator cbegin = chs.begin();
-
-  for(size_t curr = 1; curr < length; curr++) {
-    stringstream ss;
-    size_t incre = 0;
-
-    while ((cbegin + curr + incre) != chs.end()) {
-      ss << *(cbegin + curr + incre);
-      incre++;
-    }
-
-    VLOG(3) << __func__ << " prefix string: " << ss.str();
-
-    // 再次匹配
-    match = dictwords.longest_prefix(ss.str());
-
-    if(match != dictwords.end()) {
-      string key = match.key();
-      VLOG(3) << __func__ << " word " << match.key() << ", dictname "
-              << *match;
-
-      if((*match).find(dictname) !=  (*match).end()) {
-        slotvalue = key;
-        return true;
-      }
-    }
-  }
+  return false;
 }
 
 
@@ -733,10 +1044,74 @@ inline bool setSessionEntityValueByName(const string& entityName,
   return true;
 };
 
+/**
+ * 预热
+ * 用说法样例走一遍分词、检索和NER，使词典、索引和模型的页面在服务前载入内存
+ * 返回成功执行的样例数
+ */
+size_t Bot::warmup(const size_t& queries) {
+  size_t done = 0;
+
+  if(_profile == NULL) {
+    return done;
+  }
+
+  for(const intent::TIntent& intent : _profile->intents()) {
+    for(const intent::TIntentUtter& utter : intent.utters()) {
+      if(done >= queries) {
+        return done;
+      }
+
+      try {
+        std::vector<pair<string, string> > tokens;
+        tokenize(utter.utterance(), tokens);
+
+        string intentName;
+        classify(tokens, intentName);
+
+        if(_taggers != NULL && !tokens.empty()) {
+          vector<string> terms;
+          vector<string> tags;
+
+          for(const pair<string, string>& token : tokens) {
+            terms.push_back(token.first);
+            tags.push_back(token.second);
+          }
+
+          tagEntities(terms, tags);
+        }
+
+        done++;
+      } catch(std::exception& e) {
+        VLOG(2) << __func__ << " chatbotID: " << _chatbotID << ", utterance: " << utter.utterance()
+                << ", error: " << e.what();
+        return done;
+      }
+
+      break; // 每个意图一个样例
+    }
+  }
+
+  return done;
+};
+
 std::vector<pair<string, intent::TDict> >* Bot::getPatternDicts() const {
   return _pattern_dicts;
 }
 
+/**
+ * 获得意图相关的正则表达式词典组合匹配器，意图为空时包含所有意图引用的词典
+ * 没有相关的正则表达式词典时返回NULL
+ */
+const PatternDictMatcher* Bot::getPatternMatcher(const string& intentName) const {
+  if(intentName.empty()) {
+    return _pattern_matcher;
+  }
+
+  std::map<string, PatternDictMatcher*>::const_iterator it = _intent_pattern_matchers.find(intentName);
+  return it == _intent_pattern_matchers.end() ? NULL : it->second;
+}
+
 /**
  * 获得引用的系统词典列表
  */
@@ -894,6 +1269,9 @@ bool Bot::chat(const ChatMessage& payload,
         // 但是偶然情况下，两个命名实体的值可能是一样的
         // 最坏的情况是做多次的追问，体验比较勉强
         std::set<string> bypassValues;
+        // 用户词表词典：整句匹配一次，追问槽位和其它槽位的查找共用
+        vector<chatopera::utils::DictwordsMatch> dictwordsMatches;
+        _dictwords->match(payload.textMessage, dictwordsMatches);
 
         if(boost::starts_with(session.proactive_dictname(), "@")) { // 处理系统词典
           for(const sysdicts::Entity& se : builtins) {
@@ -918,8 +1296,8 @@ bool Bot::chat(const ChatMessage& payload,
               break;
             }
           }
-        } else if(extract_slotvalue_from_utterence_with_triedata(*_dictwords_triedb,
-                  payload.textMessage,
+        } else if(extract_slotvalue_from_dictwords_matches(*_dictwords,
+                  dictwordsMatches,
                   session.proactive_dictname(),
                   slotvalue)) {
           // 从用户词表词典中查找到命名实体值
@@ -969,8 +1347,8 @@ bool Bot::chat(const ChatMessage& payload,
                   break;
                 }
               }
-            } else if(extract_slotvalue_from_utterence_with_triedata(*_dictwords_triedb,
-                      payload.textMessage,
+            } else if(extract_slotvalue_from_dictwords_matches(*_dictwords,
+                      dictwordsMatches,
                       ie.dictname(),
                       extras_slotvalue)) {
               // 查询用户词表词典
@@ -1002,10 +1380,8 @@ bool Bot::chat(const ChatMessage& payload,
        * 进行NER识别
        * 未识别到的槽位并且为必填项: 设置回复为追问。
        */
-      crfsuite::ItemSequence xseq;
-      setupNerItemSequence(payload.terms, payload.tags, xseq);
       VLOG(3) << __func__ << " labeling entities with ner model ...";
-      vector<string> labels = _tagger->tag(xseq);
+      vector<string> labels = tagEntities(payload.terms, payload.tags);
 
       VLOG(3) << __func__ << " labels: " << join(labels, "\t");
       VLOG(3) << __func__ << " tokens: " << join(payload.terms, "\t");
@@ -1078,7 +1454,7 @@ bool Bot::chat(const ChatMessage& payload,
                   break;
                 }
               }
-            } else if(lookup_word_by_dictname_in_leveldb(*_dictwords_leveldb, entity->dictname(), it->second)) {
+            } else if(lookup_word_by_dictname(_dictwords_members, _dictwords_leveldb, entity->dictname(), it->second)) {
               // 基于词表的词典
               VLOG(3) << __func__ << " resolve slot: " << it->first << " as value: " << it->second << " successfully.";
               settledown = true;
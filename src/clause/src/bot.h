@@ -19,6 +19,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 #include <sstream>
 #include <algorithm>
 #include <gflags/gflags.h>
@@ -42,6 +43,11 @@
 #include "similarity.h"
 #include "sysdicts/serving/server_types.h"
 #include "pattern.h"
+#include "recall.h"
+#include "linear.h"
+#include "nerattrs.h"
+#include "DictwordsAutomaton.hpp"
+#include "MembershipTable.hpp"
 
 using namespace std;
 using namespace chatopera::redis;
@@ -51,13 +57,19 @@ namespace fs = boost::filesystem;
 DECLARE_string(data);                      // 配置数据文件
 DECLARE_string(workarea);                  // 工作空间
 DECLARE_double(intent_classify_threshold);
+DECLARE_bool(intent_recall_index);
+DECLARE_int32(intent_recall_depth);
+DECLARE_string(intent_classify_mode);
+DECLARE_double(intent_linear_threshold);
+DECLARE_double(intent_linear_margin);
+DECLARE_int32(bot_leveldb_cache_mb);
 
 namespace chatopera {
 namespace bot {
 
 // forward definition
 namespace crfsuite {
-class Tagger;
+class TaggerPool;
 }
 
 namespace clause {
@@ -74,12 +86,13 @@ class Bot {
             const string& branch,
             const string& buildver);
   void tokenize(const string& query, std::vector<pair<string, string> >& tokens); // 分词
+  size_t warmup(const size_t& queries);                           // 用说法样例预热
   // 获得意图后，将槽位信息加入到session中
   bool setSessionEntitiesByIntentName(const string& intentName,
                                       intent::TChatSession& session);
   bool session(ChatSession& session);                            // 创建session
   bool classify(const std::vector<pair<string, string> >& query,
-                const string& intentName);                      // 意图识别
+                string& intentName);                            // 意图识别
   bool chat(const ChatMessage& payload,
             const string& query, /* 改写后的query */
             const vector<sysdicts::Entity>& builtins, /* 系统词典识别到的命名实体 */
@@ -87,12 +100,24 @@ class Bot {
             intent::TChatSession& session,
             ChatMessage& reply);
   string getBuildver();                                          // 获得构建版本
+  size_t getFootprint() const;                                   // 估算的内存占用
   vector<string> getReferredSysdicts();                          // 获得引用的系统词典列表
   bool hasReferredSysdict(const string& dictname);               // 是否引用了某系统词典
   bool patchSysdictsRequestEntities(sysdicts::Data& request);    // 请求系统词典前增加被引用的列表信息
   std::vector<pair<string, intent::TDict> >* getPatternDicts() const; // 获得正则表达式词典列表
+  const PatternDictMatcher* getPatternMatcher(const string& intentName) const; // 获得意图相关的正则表达式词典组合匹配器
   bool hasRelatedPatternDict(const string& dictname, const string& intentName);
 
+ private: // function
+  bool classifyWithRecall(const std::vector<pair<string, string> >& query,
+                          string& intentName);                  // 召回后比较相似度
+  bool classifyWithXapian(const std::vector<pair<string, string> >& query,
+                          string& intentName);                  // 未构建内存召回索引时使用
+  bool classifyWithLinear(const std::vector<pair<string, string> >& query,
+                          string& intentName);                  // 线性分类器，低置信时使用召回
+  vector<string> tagEntities(const vector<string>& terms,
+                             const vector<string>& poss);       // NER标注
+
  private: // member
   MySQL* _mysql;
   Redis* _redis;
@@ -101,14 +126,21 @@ class Bot {
   string _buildver;                                    // 构建版本
 
   cppjieba::Jieba* _tokenizer;
-  chatopera::bot::crfsuite::Tagger* _tagger;           // 命名实体标识
+  chatopera::bot::crfsuite::TaggerPool* _taggers;      // 命名实体标识，共享映射的模型，每个线程取用独立的tagger
+  NerAttributes* _ner_attributes;                      // NER特征到模型属性ID
   Xapian::Database* _recall;                           // BoW检索
+  RecallIndex* _recall_index;                          // 内存召回索引，构建后关闭_recall
+  chatopera::bot::classifier::LinearModel* _linear;    // 线性意图分类器
   chatopera::bot::intent::Profile* _profile;           // 意图描述文件
   chatopera::bot::distance::Similarity* _similarity;   // 相似度比较
-  tsl::htrie_map<char, set<string> >* _dictwords_triedb;     // 自定义词典词条的前缀树
-  leveldb::DB* _dictwords_leveldb;                     // 自定义词典词条的leveldb
+  chatopera::utils::DictwordsAutomaton* _dictwords;    // 自定义词典词条的AC自动机，映射到内存
+  chatopera::utils::MembershipTable* _dictwords_members; // 自定义词典词条的成员表，映射到内存
+  leveldb::DB* _dictwords_leveldb;                     // 自定义词典词条的leveldb，版本没有成员表时使用
   std::vector<string>* _referred_sysdicts;             // 引用的系统词典
   std::vector<pair<string, intent::TDict> >*  _pattern_dicts; // 正则表达式词典
+  PatternDictMatcher* _pattern_matcher;                 // 正则表达式词典组合匹配器，所有意图引用的词典
+  std::map<string, PatternDictMatcher*> _intent_pattern_matchers; // 意图名称 -> 该意图引用的词典的组合匹配器
+  size_t _footprint;                                   // 估算的内存占用字节数
 };
 
 
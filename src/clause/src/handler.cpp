@@ -36,10 +36,22 @@ ServingHandler::ServingHandler() {
   _emojis = new sep::Emojis();
   _punts = new sep::Punctuations();
   _stopwords = new sep::Stopwords();
+  _versions = NULL;
+  _brokersub = NULL;
+  _loader = new BotLoader(_bots);
 };
 
 ServingHandler::~ServingHandler() {
+  // 先停止版本变化的来源：消息订阅和定期核对，再清除监听者
   delete _brokersub;
+  _brokersub = NULL;
+
+  if(_versions != NULL) {
+    _versions->stop();
+    _versions->listen(BotVersions::Listener());
+  }
+
+  delete _loader;
   delete _emojis;
   delete _punts;
   delete _stopwords;
@@ -83,11 +95,40 @@ bool ServingHandler::init() {
     if(!_redis->init(FLAGS_redis_host,
                      FLAGS_redis_port,
                      FLAGS_redis_db,
-                     FLAGS_redis_pass)) {
+                     FLAGS_redis_pass,
+                     FLAGS_redis_pool_size)) {
       VLOG(2) << "Init redis fails.";
       return false;
     }
 
+    // 已加载BOT的内存预算
+    _bots.setBudget((size_t)FLAGS_bot_memory_budget_mb << 20, FLAGS_bot_evict_idle_seconds);
+    _bots.report(FLAGS_bot_stats_interval);
+
+    // BOT加载器，版本变化后在后台加载新版本
+    if(!_loader->init(FLAGS_bot_loader_threads, FLAGS_bot_warmup_queries)) {
+      VLOG(2) << "Init bot loader fails.";
+      return false;
+    }
+
+    // 加载失败的版本在退避期内不再重试
+    _loader->setRetryBackoff(FLAGS_bot_load_retry_seconds, FLAGS_bot_load_retry_max_seconds);
+
+    // BOT版本表，依赖Redis核对
+    // 训练完成、上线等事件立即预加载；核对发现的变化只预加载本机正在服务的BOT
+    _versions = BotVersions::getInstance();
+    _versions->listen([this](const string & chatbotID, const string & branch,
+    const string & version, bool reconciled) {
+      if(!reconciled || _bots.find(chatbotID, branch)) {
+        _loader->schedule(chatbotID, branch, version);
+      }
+    });
+
+    if(!_versions->init(_redis, FLAGS_bot_version_reconcile_interval)) {
+      VLOG(2) << "Init bot versions fails.";
+      return false;
+    }
+
     // mysql database
     _mysql = chatopera::mysql::MySQL::getInstance();
 
@@ -120,6 +161,29 @@ bool ServingHandler::init() {
       VLOG(2) << "Init fails, exception in Sysdicts.";
       return false;
     }
+
+    // 预加载所有上线的生产环境BOT，达到就绪比例后才开始服务
+    if(FLAGS_bot_preload_threads > 0) {
+      vector<pair<string, string> > provers;
+
+      if(rget_online_chatbot_provers(*_redis, provers)) {
+        vector<BotLoadJob> jobs;
+
+        for(const pair<string, string>& prover : provers) {
+          BotLoadJob job;
+          job.chatbotID = prover.first;
+          job.branch = CL_BOT_BRANCH_PRO;
+          job.version = prover.second;
+          jobs.push_back(job);
+          _versions->remember(job.chatbotID, job.branch, job.version);
+        }
+
+        size_t loaded = _loader->preload(jobs, FLAGS_bot_preload_threads, FLAGS_bot_preload_ready_ratio);
+        VLOG(2) << "Preload online bots: " << jobs.size() << ", loaded: " << loaded;
+      } else {
+        VLOG(2) << "Preload skipped, can not list online bots in Redis.";
+      }
+    }
   } catch (sql::SQLException &e) {
     /*
       The JDBC API throws three different exceptions:
@@ -2144,6 +2208,7 @@ void ServingHandler::status(Data& _return, const Data& request) {
         fs::path symlink = fs::read_symlink(developdir);
         VLOG(3) << __func__ << " develop version in disk: " << symlink.string();
         rdone_chatbot_build_and_devver(*_redis, request.chatbotID, symlink.string());
+        _versions->set(request.chatbotID, CL_BOT_BRANCH_DEV, symlink.string());
         _return.rc = 0;
         _return.__isset.rc = true;
         _return.msg = CL_CHATBOT_BUILD_DONE;
@@ -2417,14 +2482,12 @@ void ServingHandler::putSession(Data& _return, const Data& request) {
         string sessionKey = rkey_chatbot_session(session.id);
         tsession.SerializeToString(&serialized);
 
-        // 设定过期时间
-        _redis->set(sessionKey, serialized);
-        _redis->expire(sessionKey, CL_CHATSESSION_MAX_IDLE_PERIOD);
-
-        append_sessionid_to_chatbot_branch(*_redis,
-                                           request.session.chatbotID,
-                                           request.session.branch,
-                                           session.id);
+        // 写入session并设定过期时间，同时追加到BOT分支上，一次往返
+        vector<string> replies;
+        _redis->pipeline({
+          {"SETEX", sessionKey, std::to_string(CL_CHATSESSION_MAX_IDLE_PERIOD), serialized},
+          {"RPUSH", rkey_chatbot_branch_session_lis(request.session.chatbotID, request.session.branch), session.id}
+        }, replies);
 
         _return.rc = 0;
         _return.session = session;
@@ -2518,70 +2581,51 @@ void ServingHandler::getSession(Data& _return, const Data& request) {
 
 /**
  * 验证BOT实例
- * 如果该实例已经不是最新的，从新加载BOT
+ * 如果该实例已经不是最新的，后台加载新版本，本机没有任何版本时同步加载
+ * 返回的实例在请求处理期间持有，被新版本替换后也不会提前释放
  */
-int ServingHandler::resolveBotByChatbotIDAndBranch(const Redis& redis,
-    map<string, Bot* >& bots,
+BotPtr ServingHandler::resolveBotByChatbotIDAndBranch(const Redis& redis,
     const intent::TChatSession& session) {
   VLOG(3) << __func__ << " resolve chatbotID: " << session.chatbotid() << ", branch: " << session.branch();
-  int result = 1;
 
-  // 获得版本信息
+  // 获得版本信息，优先读取事件维护的本地版本表
   string version;
 
-  if(session.branch() == CL_BOT_BRANCH_DEV) { // 开发分支
-    version = redis.get(rkey_chatbot_devver(session.chatbotid()));
-  } else if(session.branch() == CL_BOT_BRANCH_PRO) { // 生产环境
-    version = redis.get(rkey_chatbot_prover(session.chatbotid()));
-  } else {
+  if(session.branch() != CL_BOT_BRANCH_DEV && session.branch() != CL_BOT_BRANCH_PRO) {
     VLOG(3) << __func__ << " Error: invalid branch";
     throw std::runtime_error("Error: invalid branch, should not happen." );
   }
 
-  if(!version.empty()) {  // 取得最新版本
-    VLOG(3) << __func__ << " get version in redis: " << version;
-    bool reload = false;  // 是否重新加载BOT
-    bool freepre = false; // 是否释放前版本
-
-    if(bots.find(session.chatbotid()) != bots.end()) { // 当前服务包含该bot实例
-      if(bots[session.chatbotid()]->getBuildver() != version) {
-        reload = true;
-        freepre = true;
-      }
-    } else { // 重新加载BOT
-      reload = true;
+  if(!_versions->get(session.chatbotid(), session.branch(), version)) {
+    if(session.branch() == CL_BOT_BRANCH_DEV) { // 开发分支
+      version = redis.get(rkey_chatbot_devver(session.chatbotid()));
+    } else { // 生产环境
+      version = redis.get(rkey_chatbot_prover(session.chatbotid()));
     }
 
-    VLOG(3) << __func__ << " reload: " << reload << ", free pre: " << freepre;
-
-    // 重新加载
-    if(reload) {
-      {
-        std::lock_guard<std::mutex> guard(_bot_lock);
+    if(version.empty()) {
+      VLOG(3) << __func__ << " Error: bot version not available.";
+      throw std::runtime_error("CL:INVALID_BOT_VERSION_INFO" );
+    }
 
-        if(freepre) { // 释放前版本
-          delete bots[session.chatbotid()];
-          bots.erase(session.chatbotid());
-        }
+    VLOG(3) << __func__ << " get version in redis: " << version;
+    _versions->remember(session.chatbotid(), session.branch(), version);
+  }
 
-        bots[session.chatbotid()] = new Bot();
+  BotPtr bot = _bots.get(session.chatbotid(), session.branch());
 
-        if(bots[session.chatbotid()]->init(session.chatbotid(),
-                                           session.branch(),
-                                           version)) {
-          return true;
-        } else {
-          throw std::runtime_error("Can not reload chatbot " + session.chatbotid() + " version " + version );
-        }
-      }
-    }
+  if(bot && bot->getBuildver() == version) {
+    return bot;
+  }
 
-  } else {
-    VLOG(3) << __func__ << " Error: bot version not available.";
-    throw std::runtime_error("CL:INVALID_BOT_VERSION_INFO" );
+  // 新版本在后台加载、预热，完成前旧版本继续服务
+  if(bot && _loader->async()) {
+    _loader->schedule(session.chatbotid(), session.branch(), version);
+    return bot;
   }
 
-  return result;
+  // 本机还没有可用版本，在当前线程加载
+  return _loader->load(session.chatbotid(), session.branch(), version);
 }
 
 
@@ -2604,18 +2648,15 @@ void ServingHandler::chat(Data& _return, const Data& request) {
       if(getSessionFromRedisById(*_redis, request.session.id, session)) {
         VLOG(3) << __func__ << " restore session \n" << FromProtobufToUtf8DebugString(session);
 
-        bool isDevBranch = true;
-
-        if(session.branch() == CL_BOT_BRANCH_DEV) { // 调试版本
-          // keep isDevBranch as it is true
-        } else if(session.branch() == CL_BOT_BRANCH_PRO) { // 生产环境
-          isDevBranch = false;
-        } else {
+        if(session.branch() != CL_BOT_BRANCH_DEV &&
+            session.branch() != CL_BOT_BRANCH_PRO) {
           rc_and_error(_return, 12, "Invalid chat branch.");
           return;
         }
 
-        if(resolveBotByChatbotIDAndBranch(*_redis, isDevBranch ? _bots_dev : _bots_pro, session)) {
+        BotPtr botptr = resolveBotByChatbotIDAndBranch(*_redis, session);
+
+        if(botptr) {
           if(session.resolved()) {
             VLOG(3) << " intent is resolved. \n"
                     << FromProtobufToUtf8DebugString(session);
@@ -2635,7 +2676,7 @@ void ServingHandler::chat(Data& _return, const Data& request) {
            ****************************************************/
 
           // 赋值BOT
-          const Bot& bot =  *((isDevBranch ? _bots_dev : _bots_pro)[session.chatbotid()]);
+          const Bot& bot = *botptr;
           // 应用query改写后的查询条件
           string query(request.message.textMessage);
           // 系统词典的词条信息
@@ -2649,27 +2690,19 @@ void ServingHandler::chat(Data& _return, const Data& request) {
            ****************************************************/
           std::vector<PatternDictMatch> pattern_dict_matches;
 
-          for(const std::pair<string, intent::TDict>& dpp : (*bot.getPatternDicts())) {
-            VLOG(3) << __func__ << " [query-rewrite] pattern dict name: " << dpp.first;
-            intent::TDictPattern* tdp = &dpp.second.dictpattern();
-
-            for(const std::string dp : tdp->patterns()) {
-              VLOG(3) << __func__ << " [query-rewrite] pattern dict name: " << dpp.first << ", pattern: " << dp;
+          // 匹配器只包含 profile 里该意图使用的词典，匹配上的值都需要改写
+          const PatternDictMatcher* pattern_matcher = bot.getPatternMatcher(session.intent_name());
 
-              PatternDictMatch pdm;
+          if(pattern_matcher != NULL) {
+            pattern_matcher->match(query, pattern_dict_matches);
+          }
 
-              if(PatternRegex::match(dp, query, pdm)) {
-                // 匹配上值，根据 profile里是否使用该词典决定是否改写
-                if(bot.hasRelatedPatternDict(dpp.first, session.intent_name())) {
-                  replace_first(query, pdm.val, "#" + dpp.first);
-                  pdm.dictname = dpp.second.name();
-                  pdm.dict_id = dpp.second.id();
-                  pattern_dict_matches.push_back(pdm);
-                }
-              }
-            }
+          for(const PatternDictMatch& pdm : pattern_dict_matches) {
+            VLOG(3) << __func__ << " [query-rewrite] pattern dict name: " << pdm.dictname << ", pattern: " << pdm.regex << ", val: " << pdm.val;
           }
 
+          query = PatternDictMatcher::rewrite(query, pattern_dict_matches);
+
           VLOG(3) << __func__ << " [query-rewrite] post query rewrite by pattern dicts: " << query;
 
           /****************************************************
@@ -2957,6 +2990,7 @@ void ServingHandler::online(Data& _return, const Data& request) {
         // 设置 Redis 信息
         rupdate_chatbot_prover(*_redis, request.chatbotID, request.prover.version);
         rupdate_chatbot_prover_online(*_redis, request.chatbotID);
+        _versions->set(request.chatbotID, CL_BOT_BRANCH_PRO, request.prover.version);
 
         _return.rc = 0;
         _return.__isset.rc = true;
@@ -44,6 +44,9 @@
 #include "subscriber.h" // activemq subscription
 #include "publisher.h"  // activemq publish
 #include "bot.h"        // bot instance
+#include "registry.h"   // bot instances registry
+#include "versions.h"   // bot versions table
+#include "loader.h"     // bot background loader
 #include "pattern.h"    // regex utils
 
 #include "emoji.h"
@@ -55,6 +58,19 @@ DECLARE_string(redis_host);
 DECLARE_string(redis_pass);
 DECLARE_int32(redis_port);
 DECLARE_int32(redis_db);
+DECLARE_int32(redis_pool_size);
+
+// bots flags
+DECLARE_int32(bot_version_reconcile_interval);
+DECLARE_int32(bot_loader_threads);
+DECLARE_int32(bot_warmup_queries);
+DECLARE_int32(bot_memory_budget_mb);
+DECLARE_int32(bot_evict_idle_seconds);
+DECLARE_int32(bot_stats_interval);
+DECLARE_int32(bot_preload_threads);
+DECLARE_int32(bot_load_retry_seconds);
+DECLARE_int32(bot_load_retry_max_seconds);
+DECLARE_double(bot_preload_ready_ratio);
 
 DECLARE_string(workarea);
 DECLARE_string(data);
@@ -182,9 +198,8 @@ class ServingHandler : virtual public ServingIf {
   bool mysql_error(Data& _return, const sql::SQLException &e);
 
  private: // functions
-  int resolveBotByChatbotIDAndBranch(const Redis& redis,
-                                     map<string, Bot* >& bots,
-                                     const intent::TChatSession& session);
+  BotPtr resolveBotByChatbotIDAndBranch(const Redis& redis,
+                                        const intent::TChatSession& session);
 
  private:
   chatopera::mysql::MySQL* _mysql;               // mysql connection
@@ -192,9 +207,9 @@ class ServingHandler : virtual public ServingIf {
   BrokerSubscriber* _brokersub;                  // activemq connection
   BrokerPublisher*  _brokerpub;                  // activemq connection
   Redis*            _redis;                      // Redis
-  map<string, Bot* > _bots_dev;                  // Chat development instances
-  map<string, Bot* > _bots_pro;                  // Chat production instances
-  mutex              _bot_lock;                  // Lock for bots managing
+  BotRegistry        _bots;                      // Chat instances of dev and pro branches
+  BotVersions*       _versions;                  // Bot versions, updated by events
+  BotLoader*         _loader;                    // Build and warm up new bot versions
   sysdicts::Client*  _sysdicts;                  // Client for Sysdicts Service
   sep::Emojis*       _emojis;                    // Emojis Filter
   sep::Punctuations* _punts;                     // Punctuations Filter
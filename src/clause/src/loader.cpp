@@ -0,0 +1,376 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/loader.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-03_14:40:18
+ * @brief
+ *
+ **/
+
+#include "loader.h"
+#include <cmath>
+#include <chrono>
+#include <stdexcept>
+#include "glog/logging.h"
+#include "bot.h"
+#include "versions.h"
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+/**
+ * 持有BOT的加载锁，析构时解锁并归还给BotRegistry
+ */
+class LoadingGuard {
+ public:
+  LoadingGuard(BotRegistry& bots, const std::string& chatbotID, const std::string& branch) :
+    _bots(bots),
+    _chatbotID(chatbotID),
+    _branch(branch),
+    _lock(bots.loadingLock(chatbotID, branch)) {
+    _lock->lock();
+  }
+
+  ~LoadingGuard() {
+    _lock->unlock();
+    _bots.releaseLoadingLock(_chatbotID, _branch, _lock);
+  }
+
+ private:
+  LoadingGuard(const LoadingGuard&);
+  LoadingGuard& operator=(const LoadingGuard&);
+
+  BotRegistry& _bots;
+  const std::string _chatbotID;
+  const std::string _branch;
+  std::shared_ptr<std::mutex> _lock;
+};
+
+BotLoader::BotLoader(BotRegistry& bots) :
+  _bots(bots),
+  _warmup(0),
+  _retry_seconds(10),
+  _retry_max_seconds(600),
+  _stopping(false) {
+};
+
+BotLoader::~BotLoader() {
+  stop();
+};
+
+bool BotLoader::init(int threads, int warmupQueries) {
+  _warmup = warmupQueries > 0 ? warmupQueries : 0;
+
+  for(int i = 0; i < threads; i++) {
+    _workers.push_back(std::thread(&BotLoader::run, this));
+  }
+
+  VLOG(3) << __func__ << " bot loader threads: " << threads << ", warmup queries: " << _warmup;
+  return true;
+};
+
+void BotLoader::setRetryBackoff(int seconds, int maxSeconds) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _retry_seconds = seconds > 0 ? seconds : 0;
+  _retry_max_seconds = maxSeconds > _retry_seconds ? maxSeconds : _retry_seconds;
+};
+
+void BotLoader::stop() {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _stopping = true;
+  }
+  _cond.notify_all();
+
+  for(std::thread& worker : _workers) {
+    if(worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  for(std::thread& preloader : _preloaders) {
+    if(preloader.joinable()) {
+      preloader.join();
+    }
+  }
+
+  _workers.clear();
+  _preloaders.clear();
+};
+
+bool BotLoader::async() const {
+  return !_workers.empty();
+};
+
+size_t BotLoader::pending() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _pending.size();
+};
+
+void BotLoader::schedule(const std::string& chatbotID,
+                         const std::string& branch,
+                         const std::string& version) {
+  if(!async() || version.empty()) {
+    return;
+  }
+
+  BotPtr bot = _bots.find(chatbotID, branch);
+
+  if(bot && bot->getBuildver() == version) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+
+    if(_stopping) {
+      return;
+    }
+
+    if(backingOff(chatbotID, version)) {
+      VLOG(4) << __func__ << " skip recently failed chatbotID: " << chatbotID << ", version: " << version;
+      return;
+    }
+
+    BotKey key(chatbotID, branch);
+    std::map<BotKey, std::string>::iterator it = _pending.find(key);
+
+    if(it != _pending.end()) {
+      it->second = version; // 已在排队，只更新目标版本
+      return;
+    }
+
+    _pending[key] = version;
+    _queue.push_back(key);
+  }
+
+  VLOG(3) << __func__ << " chatbotID: " << chatbotID << ", branch: " << branch << ", version: " << version;
+  _cond.notify_one();
+};
+
+/**
+ * 同一BOT只加载一次，其它BOT不受影响
+ * 加载完成后替换，旧版本在最后一个使用它的请求结束时释放
+ */
+BotPtr BotLoader::load(const std::string& chatbotID,
+                       const std::string& branch,
+                       const std::string& version) {
+  LoadingGuard guard(_bots, chatbotID, branch);
+
+  // 等待期间可能已被其它请求加载
+  BotPtr bot = _bots.find(chatbotID, branch);
+
+  if(bot && bot->getBuildver() == version) {
+    return bot;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+
+    if(backingOff(chatbotID, version)) {
+      throw std::runtime_error("Chatbot " + chatbotID + " version " + version + " failed to load recently");
+    }
+  }
+
+  VLOG(3) << __func__ << " load chatbotID: " << chatbotID << ", branch: " << branch << ", version: " << version;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  BotPtr fresh(new Bot());
+  size_t warmed = 0;
+
+  try {
+    if(!fresh->init(chatbotID, branch, version)) {
+      throw std::runtime_error("Can not reload chatbot " + chatbotID + " version " + version );
+    }
+
+    warmed = fresh->warmup(_warmup);
+  } catch(...) {
+    std::lock_guard<std::mutex> lock(_lock);
+    recordFailure(chatbotID, version);
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    clearFailure(chatbotID);
+  }
+
+  _bots.put(chatbotID, branch, fresh);
+
+  VLOG(3) << __func__ << " loaded chatbotID: " << chatbotID << ", branch: " << branch << ", version: " << version
+          << ", warmup queries: " << warmed << ", cost: " << std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count() << "ms";
+  return fresh;
+};
+
+/**
+ * 线程数限制同时打开的索引、模型文件，避免启动时磁盘IO争抢
+ */
+size_t BotLoader::preload(const std::vector<BotLoadJob>& jobs, int threads, double readyRatio) {
+  struct Progress {
+    std::mutex lock;
+    std::condition_variable cond;
+    size_t next;
+    size_t finished;
+    size_t loaded;
+  };
+
+  std::shared_ptr<Progress> progress = std::make_shared<Progress>();
+  progress->next = 0;
+  progress->finished = 0;
+  progress->loaded = 0;
+
+  if(jobs.empty() || threads <= 0) {
+    return 0;
+  }
+
+  std::shared_ptr<const std::vector<BotLoadJob> > queue = std::make_shared<const std::vector<BotLoadJob> >(jobs);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for(int i = 0; i < threads && i < (int)jobs.size(); i++) {
+    _preloaders.push_back(std::thread([this, progress, queue] {
+      while(true) {
+        size_t index;
+
+        {
+          std::lock_guard<std::mutex> guard(progress->lock);
+
+          if(progress->next >= queue->size()) {
+            return;
+          }
+
+          index = progress->next++;
+        }
+
+        {
+          std::lock_guard<std::mutex> guard(_lock);
+
+          if(_stopping) {
+            return;
+          }
+        }
+
+        const BotLoadJob& job = (*queue)[index];
+        bool loaded = false;
+
+        try {
+          load(job.chatbotID, job.branch, job.version);
+          loaded = true;
+        } catch(std::exception& e) {
+          VLOG(2) << "[preload] chatbotID: " << job.chatbotID << ", branch: " << job.branch
+                  << ", version: " << job.version << " fails, " << e.what();
+        }
+
+        {
+          std::lock_guard<std::mutex> guard(progress->lock);
+          progress->finished++;
+
+          if(loaded) {
+            progress->loaded++;
+          }
+        }
+
+        progress->cond.notify_all();
+      }
+    }));
+  }
+
+  // 达到就绪比例即返回，失败的也计入完成
+  double ratio = readyRatio < 0 ? 0 : (readyRatio > 1 ? 1 : readyRatio);
+  size_t target = (size_t)std::ceil(ratio * jobs.size());
+  std::unique_lock<std::mutex> lock(progress->lock);
+  progress->cond.wait(lock, [progress, target] { return progress->finished >= target; });
+
+  VLOG(2) << __func__ << " bots: " << jobs.size() << ", finished: " << progress->finished
+          << ", loaded: " << progress->loaded << ", threads: " << threads << ", cost: "
+          << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms";
+  return progress->loaded;
+};
+
+/**
+ * 以下在 _lock 内调用
+ */
+bool BotLoader::backingOff(const std::string& chatbotID, const std::string& version) const {
+  std::map<std::string, LoadFailure>::const_iterator it = _failures.find(chatbotID);
+  return it != _failures.end() && it->second.version == version
+         && std::chrono::steady_clock::now() < it->second.retryAt;
+};
+
+/**
+ * 同一版本连续失败时退避时间加倍，新的版本重新计数
+ */
+void BotLoader::recordFailure(const std::string& chatbotID, const std::string& version) {
+  LoadFailure& failure = _failures[chatbotID];
+
+  if(failure.version != version) {
+    failure.version = version;
+    failure.attempts = 0;
+  }
+
+  failure.attempts++;
+  int64_t seconds = _retry_seconds;
+
+  for(int i = 1; i < failure.attempts && seconds < _retry_max_seconds; i++) {
+    seconds *= 2;
+  }
+
+  if(seconds > _retry_max_seconds) {
+    seconds = _retry_max_seconds;
+  }
+
+  failure.retryAt = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+  VLOG(2) << __func__ << " chatbotID: " << chatbotID << ", version: " << version
+          << ", attempts: " << failure.attempts << ", retry after " << seconds << "s";
+};
+
+void BotLoader::clearFailure(const std::string& chatbotID) {
+  _failures.erase(chatbotID);
+};
+
+void BotLoader::run() {
+  while(true) {
+    BotKey key;
+    std::string version;
+
+    {
+      std::unique_lock<std::mutex> lock(_lock);
+      _cond.wait(lock, [this] { return _stopping || !_queue.empty(); });
+
+      if(_stopping) {
+        return;
+      }
+
+      key = _queue.front();
+      _queue.pop_front();
+      version = _pending[key];
+      _pending.erase(key);
+    }
+
+    // 排队期间版本可能又发生变化，以版本表为准
+    std::string current;
+
+    if(BotVersions::getInstance()->get(key.first, key.second, current) && current != version) {
+      VLOG(3) << __func__ << " skip stale version " << version << ", current: " << current;
+      continue;
+    }
+
+    try {
+      load(key.first, key.second, version);
+    } catch(std::exception& e) {
+      VLOG(2) << __func__ << " load chatbotID: " << key.first << ", branch: " << key.second
+              << ", version: " << version << " fails, " << e.what();
+    }
+  }
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/loader.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-03_14:40:18
+ * @brief
+ * Build, warm up and publish bot versions in background threads.
+ **/
+#ifndef __CHATOPERA_BOT_CLAUSE_LOADER_H__
+#define __CHATOPERA_BOT_CLAUSE_LOADER_H__
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <condition_variable>
+
+#include "registry.h"
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+/**
+ * 待加载的BOT版本
+ */
+struct BotLoadJob {
+  std::string chatbotID;
+  std::string branch;
+  std::string version;
+};
+
+/**
+ * BOT加载器
+ * schedule: 交给后台线程加载，加载、预热完成后放入BotRegistry，旧版本在此之前继续服务
+ * load: 在调用线程中加载，用于本机还没有任何版本可用的情况
+ * preload: 启动时用独立的线程并行加载一批BOT，完成指定比例后返回，其余继续在后台加载
+ * 同一BOT同时只有一个加载任务，排队期间到达的新版本替换旧任务
+ */
+class BotLoader {
+ public:
+  explicit BotLoader(BotRegistry& bots);
+  ~BotLoader();
+
+  bool init(int threads, int warmupQueries);
+  // 加载失败后首次重试的间隔，之后每次失败加倍，不超过maxSeconds
+  void setRetryBackoff(int seconds, int maxSeconds);
+  void stop();
+  bool async() const;  // 是否有后台线程
+
+  void schedule(const std::string& chatbotID, const std::string& branch, const std::string& version);
+  // 加载失败时抛出 std::runtime_error
+  BotPtr load(const std::string& chatbotID, const std::string& branch, const std::string& version);
+  size_t pending() const;
+  // 返回时已加载成功的数量
+  size_t preload(const std::vector<BotLoadJob>& jobs, int threads, double readyRatio);
+
+ private:
+  typedef std::pair<std::string, std::string> BotKey;
+
+  BotLoader(const BotLoader&);
+  BotLoader& operator=(const BotLoader&);
+
+  void run();
+  // 该版本最近加载失败，仍在退避期内
+  bool backingOff(const std::string& chatbotID, const std::string& version) const;
+  void recordFailure(const std::string& chatbotID, const std::string& version);
+  void clearFailure(const std::string& chatbotID);
+
+  // 加载失败的版本，按 chatbotID 只保留最近失败的版本
+  struct LoadFailure {
+    std::string version;
+    int attempts;
+    std::chrono::steady_clock::time_point retryAt;
+  };
+
+  BotRegistry& _bots;
+  int _warmup;                                   // 预热样例数
+  std::vector<std::thread> _workers;
+  std::vector<std::thread> _preloaders;          // 启动预加载线程
+  std::deque<BotKey> _queue;                     // 待加载的BOT
+  std::map<BotKey, std::string> _pending;        // 待加载BOT的目标版本
+  std::map<std::string, LoadFailure> _failures;  // chatbotID -> 最近加载失败的版本
+  int _retry_seconds;
+  int _retry_max_seconds;
+  mutable std::mutex _lock;
+  std::condition_variable _cond;
+  bool _stopping;
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,198 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/nerattrs.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-08_11:04:27
+ * @brief
+ *
+ **/
+
+#include "nerattrs.h"
+#include <cstring>
+#include <stdexcept>
+#include "glog/logging.h"
+#include "HashUtils.hpp"
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+/**
+ * 分段计算的FNV-1a，结果与对拼接后的字符串计算相同
+ */
+class FeatureHash {
+ public:
+  FeatureHash() : _hash(chatopera::utils::FNV1A64_INIT) {
+  }
+
+  FeatureHash& operator<<(const char* s) {
+    _hash = chatopera::utils::fnv1a64(_hash, s, strlen(s));
+    return *this;
+  }
+
+  FeatureHash& operator<<(const std::string& s) {
+    _hash = chatopera::utils::fnv1a64(_hash, s.data(), s.size());
+    return *this;
+  }
+
+  uint64_t value() const {
+    return _hash;
+  }
+
+ private:
+  uint64_t _hash;
+};
+
+NerAttributes::NerAttributes() : _mask(0), _size(0) {
+};
+
+NerAttributes::~NerAttributes() {
+};
+
+void NerAttributes::build(const std::vector<std::string>& attributes) {
+  size_t capacity = 16;
+
+  while(capacity < attributes.size() * 2) {
+    capacity <<= 1;
+  }
+
+  Slot empty;
+  empty.hash = 0;
+  empty.aid = -1;
+  _slots.assign(capacity, empty);
+  _mask = capacity - 1;
+  _size = attributes.size();
+
+  for(size_t aid = 0; aid < attributes.size(); aid++) {
+    FeatureHash h;
+    h << attributes[aid];
+    uint64_t i = h.value() & _mask;
+
+    while(_slots[i].aid >= 0) {
+      i = (i + 1) & _mask;
+    }
+
+    _slots[i].hash = h.value();
+    _slots[i].aid = aid;
+  }
+
+  VLOG(3) << __func__ << " attributes: " << _size << ", slots: " << capacity;
+};
+
+int NerAttributes::find(const uint64_t& hash) const {
+  for(uint64_t i = hash & _mask; _slots[i].aid >= 0; i = (i + 1) & _mask) {
+    if(_slots[i].hash == hash) {
+      return _slots[i].aid;
+    }
+  }
+
+  return -1;
+};
+
+size_t NerAttributes::size() const {
+  return _size;
+};
+
+size_t NerAttributes::memoryUsage() const {
+  return _slots.size() * sizeof(Slot);
+};
+
+/**
+ * 特征模板
+ * w[t-2], w[t-1], w[t], w[t+1], w[t+2],
+ * w[t-1]|w[t], w[t]|w[t+1],
+ * pos[t-2], pos[t-1], pos[t], pos[t+1], pos[t+2],
+ * pos[t-2]|pos[t-1], pos[t-1]|pos[t], pos[t]|pos[t+1], pos[t+1]|pos[t+2],
+ * pos[t-2]|pos[t-1]|pos[t], pos[t-1]|pos[t]|pos[t+1], pos[t]|pos[t+1]|pos[t+2]
+ * 训练数据中 w[t+1] 和 pos[t+1] 取的是第二个词，这里保持一致，否则已训练的模型无法匹配
+ */
+void NerAttributes::extract(const std::vector<std::string>& terms,
+                            const std::vector<std::string>& poss,
+                            std::vector<int>& aids,
+                            std::vector<size_t>& offsets) const {
+  if(terms.size() != poss.size()) {
+    throw std::runtime_error("NerAttributes::extract: Invaid labeling data.");
+  }
+
+  aids.clear();
+  offsets.clear();
+  offsets.push_back(0);
+
+  const size_t length = terms.size();
+
+  for(size_t t = 0; t < length; t++) {
+    uint64_t hashes[21];
+    size_t n = 0;
+    const bool pre2 = t >= 2;
+    const bool pre1 = t >= 1;
+    const bool post1 = t + 1 < length;
+    const bool post2 = t + 2 < length;
+
+    if(pre2) {
+      hashes[n++] = (FeatureHash() << "w[t-2]=" << terms[t - 2]).value();
+      hashes[n++] = (FeatureHash() << "pos[t-2]=@" << poss[t - 2]).value();
+      hashes[n++] = (FeatureHash() << "pos[t-2]|pos[t-1]=@" << poss[t - 2] << "|@" << poss[t - 1]).value();
+      hashes[n++] = (FeatureHash() << "pos[t-2]|pos[t-1]|pos[t]=@" << poss[t - 2] << "|@" << poss[t - 1]
+                     << "|@" << poss[t]).value();
+    }
+
+    if(pre1) {
+      hashes[n++] = (FeatureHash() << "w[t-1]=" << terms[t - 1]).value();
+      hashes[n++] = (FeatureHash() << "pos[t-1]=@" << poss[t - 1]).value();
+      hashes[n++] = (FeatureHash() << "w[t-1]|w[t]=" << terms[t - 1] << "|" << terms[t]).value();
+      hashes[n++] = (FeatureHash() << "pos[t-1]|pos[t]=@" << poss[t - 1] << "|@" << poss[t]).value();
+    }
+
+    if(pre1 && post1) {
+      hashes[n++] = (FeatureHash() << "pos[t-1]|pos[t]|pos[t+1]=@" << poss[t - 1] << "|@" << poss[t]
+                     << "|@" << poss[t + 1]).value();
+    }
+
+    hashes[n++] = (FeatureHash() << "w[t]=" << terms[t]).value();
+    hashes[n++] = (FeatureHash() << "pos[t]=@" << poss[t]).value();
+
+    if(post1) {
+      hashes[n++] = (FeatureHash() << "w[t+1]=" << terms[1]).value();
+      hashes[n++] = (FeatureHash() << "pos[t+1]=@" << poss[1]).value();
+      hashes[n++] = (FeatureHash() << "w[t]|w[t+1]=" << terms[t] << "|" << terms[t + 1]).value();
+      hashes[n++] = (FeatureHash() << "pos[t]|pos[t+1]=@" << poss[t] << "|@" << poss[t + 1]).value();
+    }
+
+    if(post2) {
+      hashes[n++] = (FeatureHash() << "w[t+2]=" << terms[t + 2]).value();
+      hashes[n++] = (FeatureHash() << "pos[t+2]=@" << poss[t + 2]).value();
+      hashes[n++] = (FeatureHash() << "pos[t+1]|pos[t+2]=@" << poss[t + 1] << "|@" << poss[t + 2]).value();
+      hashes[n++] = (FeatureHash() << "pos[t]|pos[t+1]|pos[t+2]=@" << poss[t] << "|@" << poss[t + 1]
+                     << "|@" << poss[t + 2]).value();
+    }
+
+    if(t == 0) {
+      hashes[n++] = (FeatureHash() << "__BOS__").value();
+    }
+
+    if(t + 1 == length) {
+      hashes[n++] = (FeatureHash() << "__EOS__").value();
+    }
+
+    for(size_t i = 0; i < n; i++) {
+      int aid = find(hashes[i]);
+
+      if(aid >= 0) {
+        aids.push_back(aid);
+      }
+    }
+
+    offsets.push_back(aids.size());
+  }
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
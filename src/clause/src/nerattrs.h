@@ -0,0 +1,71 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/nerattrs.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-08_11:04:27
+ * @brief
+ * NER feature extraction straight to crfsuite attribute identifiers.
+ **/
+#ifndef __CHATOPERA_BOT_CLAUSE_NERATTRS_H__
+#define __CHATOPERA_BOT_CLAUSE_NERATTRS_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+/**
+ * NER模型的特征属性表
+ * 加载BOT时把模型中所有属性的字符串哈希后放入开放寻址表，
+ * 抽取特征时按模板逐段计算哈希，不拼接字符串，直接得到属性ID。
+ * 特征模板与训练时 SampleGenerator::generateCrfSuiteTraingData 一致。
+ * 使用64位FNV-1a，冲突的概率可以忽略。
+ */
+class NerAttributes {
+ public:
+  NerAttributes();
+  ~NerAttributes();
+
+  // attributes 的下标即属性ID
+  void build(const std::vector<std::string>& attributes);
+
+  // 逐词抽取特征的属性ID，第t个词的属性为 aids[offsets[t], offsets[t+1])
+  void extract(const std::vector<std::string>& terms,
+               const std::vector<std::string>& poss,
+               std::vector<int>& aids,
+               std::vector<size_t>& offsets) const;
+  size_t size() const;
+  size_t memoryUsage() const;
+
+ private:
+  struct Slot {
+    uint64_t hash;
+    int aid;                                  // 空槽为-1
+  };
+
+  NerAttributes(const NerAttributes&);
+  NerAttributes& operator=(const NerAttributes&);
+
+  int find(const uint64_t& hash) const;
+
+  std::vector<Slot> _slots;
+  uint64_t _mask;
+  size_t _size;
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -18,6 +18,7 @@
 #include <glog/logging.h>
 #include "gflags/gflags.h"
 #include <sstream>
+#include <algorithm>
 
 using namespace std;
 using namespace chatopera::redis;
@@ -65,10 +66,13 @@ inline string rkey_chatbot_prover(const string& chatbotID) {
 inline void rdone_chatbot_build_and_devver(const Redis& redis,
     const string& chatbotID,
     const string& version) {
-  // update build status in Redis
-  redis.set(rkey_chatbot_build(chatbotID), CL_CHATBOT_BUILD_DONE);
-  // update dev version number
-  redis.set(rkey_chatbot_devver(chatbotID), version);
+  vector<string> replies;
+  redis.pipeline({
+    // update build status in Redis
+    {"SET", rkey_chatbot_build(chatbotID), CL_CHATBOT_BUILD_DONE},
+    // update dev version number
+    {"SET", rkey_chatbot_devver(chatbotID), version}
+  }, replies);
 };
 
 /**
@@ -86,14 +90,10 @@ inline string rkey_chatbot_session(const string& sessionId) {
 inline bool getSessionFromRedisById(const Redis& redis,
                                     const string& sessionId,
                                     intent::TChatSession& session) {
-  string serialized = redis.get(rkey_chatbot_session(sessionId));
-
-  if(serialized.empty()) {
-    return false;
-  } else {
-    session.ParseFromString(serialized);
-    return true;
-  }
+  // 直接从响应缓冲区解析，避免中间字符串拷贝
+  return redis.get(rkey_chatbot_session(sessionId), [&session](const char* data, size_t len) {
+    return session.ParseFromArray(data, (int)len);
+  });
 }
 
 /**
@@ -114,9 +114,7 @@ inline bool put_session_into_redis_by_id(const Redis& redis,
   string key = rkey_chatbot_session(session.id());
   string serialized;
   session.SerializeToString(&serialized);
-  redis.set(key, serialized);
-  redis.expire(key, CL_CHATSESSION_MAX_IDLE_PERIOD);
-  return true;
+  return redis.setex(key, serialized.data(), serialized.size(), CL_CHATSESSION_MAX_IDLE_PERIOD);
 }
 
 /**
@@ -129,6 +127,58 @@ inline void rupdate_chatbot_prover(const Redis& redis,
   redis.set(rkey_chatbot_prover(chatbotID), version);
 };
 
+/**
+ * 获得所有上线的生产环境版本 (chatbotID, version)
+ * 遍历 pro:*:status，只保留状态为online并且有版本号的BOT
+ */
+inline bool rget_online_chatbot_provers(const Redis& redis,
+                                        vector<pair<string, string> >& provers) {
+  provers.clear();
+  vector<string> keys;
+
+  if(!redis.scan("pro:*:status", keys)) {
+    return false;
+  }
+
+  // SCAN可能返回重复的KEY
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  vector<string> statuses;
+
+  if(!redis.mget(keys, statuses) || statuses.size() != keys.size()) {
+    return false;
+  }
+
+  vector<string> chatbotIDs;
+  vector<string> verkeys;
+
+  for(size_t i = 0; i < keys.size(); i++) {
+    if(statuses[i] != CL_BOT_PRO_STATUS_ONLINE) {
+      continue;
+    }
+
+    // pro:<chatbotID>:status
+    string chatbotID = keys[i].substr(4, keys[i].size() - 4 - 7);
+    chatbotIDs.push_back(chatbotID);
+    verkeys.push_back(rkey_chatbot_prover(chatbotID));
+  }
+
+  vector<string> versions;
+
+  if(!redis.mget(verkeys, versions) || versions.size() != verkeys.size()) {
+    return false;
+  }
+
+  for(size_t i = 0; i < chatbotIDs.size(); i++) {
+    if(!versions[i].empty()) {
+      provers.push_back(make_pair(chatbotIDs[i], versions[i]));
+    }
+  }
+
+  return true;
+};
+
 /**
  * 更新机器人Prod Online 状态
  */
@@ -168,11 +218,19 @@ inline void rdel_chatbot_dev_sessions(const Redis& redis, const string& chatbotI
   string host = rkey_chatbot_branch_session_lis(chatbotID, CL_BOT_BRANCH_DEV);
   vector<string> keys = redis.list(host);
 
+  // 一条DEL命令删除所有session
+  vector<string> argv;
+  argv.reserve(keys.size() + 2);
+  argv.push_back("DEL");
+
   for(const string& key : keys) {
-    redis.del(rkey_chatbot_session(key));
+    argv.push_back(rkey_chatbot_session(key));
   }
 
-  redis.del(host);
+  argv.push_back(host);
+
+  vector<string> replies;
+  redis.pipeline({argv}, replies);
 }
 
 } // namespace clause
@@ -0,0 +1,254 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/recall.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-06_14:26:51
+ * @brief
+ *
+ **/
+
+#include "recall.h"
+#include <cmath>
+#include <algorithm>
+#include "glog/logging.h"
+#include "intent.pb.h"
+#include "charseq.h"
+
+// 与 Xapian::BM25Weight 的默认参数一致
+#define RECALL_BM25_K1 1.0
+#define RECALL_BM25_B 0.5
+#define RECALL_BM25_MIN_NORMLEN 0.5
+// 与 Xapian::Query::OP_ELITE_SET 的默认集合大小一致
+#define RECALL_ELITE_SET_SIZE 30
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+RecallIndex::RecallIndex() {
+};
+
+RecallIndex::~RecallIndex() {
+};
+
+/**
+ * 遍历所有文档，词频和文档长度直接取自xapian，保证打分一致
+ */
+bool RecallIndex::build(const Xapian::Database& db) {
+  _terms.clear();
+  _posting_offsets.clear();
+  _postings.clear();
+  _norms.clear();
+  _sample_intents.clear();
+  _intents.clear();
+  _char_offsets.clear();
+  _chars.clear();
+
+  std::vector<std::vector<Posting> > postings;
+  std::unordered_map<std::string, uint32_t> intents;
+
+  try {
+    const double avlen = db.get_avlength();
+    const double lenFactor = avlen > 0 ? 1.0 / avlen : 0;
+
+    for(Xapian::PostingIterator it = db.postlist_begin(""); it != db.postlist_end(""); ++it) {
+      const uint32_t sample = _sample_intents.size();
+      Xapian::Document doc = db.get_document(*it);
+
+      for(Xapian::TermIterator term = doc.termlist_begin(); term != doc.termlist_end(); ++term) {
+        if(term.get_wdf() == 0) {
+          continue; // 文档ID等布尔词条不参与打分
+        }
+
+        std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> inserted =
+          _terms.insert(std::make_pair(*term, (uint32_t)postings.size()));
+
+        if(inserted.second) {
+          postings.push_back(std::vector<Posting>());
+        }
+
+        Posting posting;
+        posting.sample = sample;
+        posting.wdf = term.get_wdf();
+        postings[inserted.first->second].push_back(posting);
+      }
+
+      double normlen = std::max(db.get_doclength(*it) * lenFactor, RECALL_BM25_MIN_NORMLEN);
+      _norms.push_back(RECALL_BM25_K1 * (normlen * RECALL_BM25_B + (1 - RECALL_BM25_B)));
+
+      intent::Augmented::Sample data;
+      data.ParseFromString(doc.get_data());
+
+      std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> intent =
+        intents.insert(std::make_pair(data.intent_name(), (uint32_t)_intents.size()));
+
+      if(intent.second) {
+        _intents.push_back(data.intent_name());
+      }
+
+      _sample_intents.push_back(intent.first->second);
+
+      // 与 Bot::classify 对候选说法的处理一致：按字符切分后升序
+      const size_t begin = _chars.size();
+      _char_offsets.push_back(begin);
+      distance::AppendCharCodes(data.utterance(), _chars);
+      std::sort(_chars.begin() + begin, _chars.end());
+    }
+  } catch(const Xapian::Error& e) {
+    VLOG(2) << __func__ << " fails to read xapian, " << e.get_msg();
+    return false;
+  }
+
+  _char_offsets.push_back(_chars.size());
+
+  // 压平倒排表
+  size_t total = 0;
+
+  for(const std::vector<Posting>& list : postings) {
+    total += list.size();
+  }
+
+  _postings.reserve(total);
+  _posting_offsets.reserve(postings.size() + 1);
+
+  for(const std::vector<Posting>& list : postings) {
+    _posting_offsets.push_back(_postings.size());
+    _postings.insert(_postings.end(), list.begin(), list.end());
+  }
+
+  _posting_offsets.push_back(_postings.size());
+  _chars.shrink_to_fit();
+  _norms.shrink_to_fit();
+  _sample_intents.shrink_to_fit();
+
+  VLOG(3) << __func__ << " samples: " << size() << ", terms: " << _terms.size()
+          << ", postings: " << _postings.size() << ", intents: " << _intents.size()
+          << ", memory: " << memoryUsage();
+  return true;
+};
+
+/**
+ * 等价于 OP_ELITE_SET(30) 组合的BM25查询
+ * 每次出现的查询词各自计分；超过集合大小时只保留权重最高的词
+ * 得分相同时样例顺序与xapian的文档ID顺序一致
+ */
+void RecallIndex::search(const std::vector<std::string>& terms,
+                         const size_t& depth,
+                         std::vector<uint32_t>& samples) const {
+  samples.clear();
+  const size_t N = size();
+
+  if(N == 0 || depth == 0) {
+    return;
+  }
+
+  std::vector<std::pair<double, uint32_t> > weighted; // (词条权重, 词条ID)
+  weighted.reserve(terms.size());
+
+  for(const std::string& term : terms) {
+    std::unordered_map<std::string, uint32_t>::const_iterator it = _terms.find(term);
+
+    if(it == _terms.end()) {
+      continue;
+    }
+
+    const double n = _posting_offsets[it->second + 1] - _posting_offsets[it->second];
+    double tw = (N - n + 0.5) / (n + 0.5);
+
+    if(tw < 2) {
+      tw = tw * 0.5 + 1;
+    }
+
+    weighted.push_back(std::make_pair(std::log(tw) * (RECALL_BM25_K1 + 1), it->second));
+  }
+
+  if(weighted.size() > RECALL_ELITE_SET_SIZE) {
+    std::stable_sort(weighted.begin(), weighted.end(),
+    [](const std::pair<double, uint32_t>& lhs, const std::pair<double, uint32_t>& rhs) {
+      return lhs.first > rhs.first;
+    });
+    weighted.resize(RECALL_ELITE_SET_SIZE);
+  }
+
+  // 累加器跨请求复用
+  static thread_local std::vector<double> scores;
+  static thread_local std::vector<uint32_t> touched;
+
+  if(scores.size() < N) {
+    scores.resize(N, -1);
+  }
+
+  touched.clear();
+
+  for(const std::pair<double, uint32_t>& term : weighted) {
+    const Posting* p = _postings.data() + _posting_offsets[term.second];
+    const Posting* end = _postings.data() + _posting_offsets[term.second + 1];
+
+    for(; p != end; p++) {
+      double& score = scores[p->sample];
+
+      if(score < 0) {
+        score = 0;
+        touched.push_back(p->sample);
+      }
+
+      score += term.first * (p->wdf / (_norms[p->sample] + p->wdf));
+    }
+  }
+
+  const std::vector<double>& acc = scores;
+  const size_t k = std::min(depth, touched.size());
+  std::partial_sort(touched.begin(), touched.begin() + k, touched.end(), [&acc](uint32_t lhs, uint32_t rhs) {
+    return acc[lhs] > acc[rhs] || (acc[lhs] == acc[rhs] && lhs < rhs);
+  });
+  samples.assign(touched.begin(), touched.begin() + k);
+
+  for(const uint32_t& sample : touched) {
+    scores[sample] = -1;
+  }
+};
+
+const std::string& RecallIndex::getIntentName(const uint32_t& sample) const {
+  return _intents[_sample_intents[sample]];
+};
+
+void RecallIndex::getChars(const uint32_t& sample, const uint32_t*& begin, const uint32_t*& end) const {
+  begin = _chars.data() + _char_offsets[sample];
+  end = _chars.data() + _char_offsets[sample + 1];
+};
+
+size_t RecallIndex::size() const {
+  return _sample_intents.size();
+};
+
+size_t RecallIndex::memoryUsage() const {
+  size_t bytes = _posting_offsets.capacity() * sizeof(uint32_t)
+                 + _postings.capacity() * sizeof(Posting)
+                 + _norms.capacity() * sizeof(double)
+                 + _sample_intents.capacity() * sizeof(uint32_t)
+                 + _char_offsets.capacity() * sizeof(uint32_t)
+                 + _chars.capacity() * sizeof(uint32_t);
+
+  // 哈希表按每个节点的字符串和指针估算
+  for(std::unordered_map<std::string, uint32_t>::const_iterator it = _terms.begin(); it != _terms.end(); it++) {
+    bytes += sizeof(std::string) + it->first.capacity() + 2 * sizeof(void*) + sizeof(uint32_t);
+  }
+
+  for(const std::string& intent : _intents) {
+    bytes += sizeof(std::string) + intent.capacity();
+  }
+
+  return bytes;
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,77 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/recall.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-06_14:26:51
+ * @brief
+ * In-memory inverted index for intent recall.
+ **/
+#ifndef __CHATOPERA_BOT_CLAUSE_RECALL_H__
+#define __CHATOPERA_BOT_CLAUSE_RECALL_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <xapian.h>
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+/**
+ * 意图召回的内存倒排索引
+ * 加载BOT时从训练生成的xapian索引一次性构建：词条映射为整数ID，每个样例只保存
+ * 意图编号和排好序的字符编码（见 distance/charseq.h），对话时不访问磁盘、不解析protobuf
+ * 打分与xapian默认的BM25一致（k1=1, b=0.5, min_normlen=0.5），召回顺序相同
+ */
+class RecallIndex {
+ public:
+  RecallIndex();
+  ~RecallIndex();
+
+  bool build(const Xapian::Database& db);
+
+  // 召回得分最高的depth个样例，按得分降序
+  void search(const std::vector<std::string>& terms,
+              const size_t& depth,
+              std::vector<uint32_t>& samples) const;
+
+  const std::string& getIntentName(const uint32_t& sample) const;
+  // 样例的字符编码，升序
+  void getChars(const uint32_t& sample, const uint32_t*& begin, const uint32_t*& end) const;
+  size_t size() const;
+  size_t memoryUsage() const;
+
+ private:
+  struct Posting {
+    uint32_t sample;
+    uint32_t wdf;
+  };
+
+  RecallIndex(const RecallIndex&);
+  RecallIndex& operator=(const RecallIndex&);
+
+  std::unordered_map<std::string, uint32_t> _terms;  // 词条 -> ID
+  std::vector<uint32_t> _posting_offsets;            // 词条ID -> [offset, next offset)
+  std::vector<Posting> _postings;                    // 按样例升序
+  std::vector<double> _norms;                        // BM25文档长度归一项
+  std::vector<uint32_t> _sample_intents;             // 样例 -> 意图编号
+  std::vector<std::string> _intents;                 // 意图名称
+  std::vector<uint32_t> _char_offsets;               // 样例 -> [offset, next offset)
+  std::vector<uint32_t> _chars;                      // 字符编码
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,248 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/registry.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2019-12-31_15:02:41
+ * @brief
+ *
+ **/
+
+#include "registry.h"
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "glog/logging.h"
+#include "marcos.h"
+#include "bot.h"
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+inline int64_t registry_now_seconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BotRegistry::BotRegistry() :
+  _snapshot(std::make_shared<const BotMap>()),
+  _budget(0),
+  _idle_seconds(0),
+  _bytes(0),
+  _hits(0),
+  _misses(0),
+  _loads(0),
+  _evictions(0),
+  _stopping(false) {
+};
+
+BotRegistry::~BotRegistry() {
+  stop();
+};
+
+void BotRegistry::setBudget(size_t budget, int idleSeconds) {
+  std::lock_guard<std::mutex> guard(_writer_lock);
+  _budget = budget;
+  _idle_seconds = idleSeconds > 0 ? idleSeconds : 0;
+};
+
+/**
+ * 无锁读取，返回的实例在调用方释放前一直有效
+ */
+BotPtr BotRegistry::get(const std::string& chatbotID, const std::string& branch) const {
+  std::shared_ptr<const BotMap> snapshot = std::atomic_load(&_snapshot);
+  BotMap::const_iterator it = snapshot->find(BotKey(chatbotID, branch));
+
+  if(it == snapshot->end()) {
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return BotPtr();
+  }
+
+  _hits.fetch_add(1, std::memory_order_relaxed);
+  it->second.used->store(registry_now_seconds(), std::memory_order_relaxed);
+  return it->second.bot;
+};
+
+BotPtr BotRegistry::find(const std::string& chatbotID, const std::string& branch) const {
+  std::shared_ptr<const BotMap> snapshot = std::atomic_load(&_snapshot);
+  BotMap::const_iterator it = snapshot->find(BotKey(chatbotID, branch));
+  return it == snapshot->end() ? BotPtr() : it->second.bot;
+};
+
+void BotRegistry::put(const std::string& chatbotID, const std::string& branch, const BotPtr& bot) {
+  BotEntry entry;
+  entry.bot = bot;
+  entry.bytes = bot->getFootprint();
+  entry.used = std::make_shared<std::atomic<int64_t> >(registry_now_seconds());
+
+  std::lock_guard<std::mutex> guard(_writer_lock);
+  std::shared_ptr<BotMap> next = std::make_shared<BotMap>(*std::atomic_load(&_snapshot));
+  BotKey key(chatbotID, branch);
+  BotMap::iterator it = next->find(key);
+
+  if(it != next->end()) {
+    _bytes -= it->second.bytes;
+  }
+
+  (*next)[key] = entry;
+  _bytes += entry.bytes;
+  _loads++;
+
+  size_t evicted = evict(*next, key);
+  std::atomic_store(&_snapshot, std::shared_ptr<const BotMap>(next));
+
+  VLOG(2) << __func__ << " chatbotID: " << chatbotID << ", branch: " << branch << ", bytes: " << entry.bytes
+          << ", bots: " << next->size() << ", total bytes: " << _bytes << ", budget: " << _budget
+          << ", hits: " << _hits << ", misses: " << _misses << ", loads: " << _loads
+          << ", evictions: " << _evictions << (evicted > 0 ? ", evicted now: " : "")
+          << (evicted > 0 ? std::to_string(evicted) : "");
+};
+
+/**
+ * 按 (是否pro分支, 最近使用时间) 排序，依次移除空闲的实例
+ * 正在处理请求的实例由请求持有，移除后在请求结束时才析构
+ */
+size_t BotRegistry::evict(BotMap& bots, const BotKey& keep) {
+  if(_budget == 0 || _bytes <= _budget) {
+    return 0;
+  }
+
+  int64_t now = registry_now_seconds();
+  std::vector<std::pair<std::pair<bool, int64_t>, BotKey> > candidates;
+
+  for(BotMap::const_iterator it = bots.begin(); it != bots.end(); it++) {
+    int64_t used = it->second.used->load(std::memory_order_relaxed);
+
+    if(it->first == keep || now - used < _idle_seconds) {
+      continue;
+    }
+
+    candidates.push_back(std::make_pair(std::make_pair(it->first.second == CL_BOT_BRANCH_PRO, used), it->first));
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+  size_t evicted = 0;
+
+  for(size_t i = 0; i < candidates.size() && _bytes > _budget; i++) {
+    BotMap::iterator it = bots.find(candidates[i].second);
+    VLOG(2) << __func__ << " evict chatbotID: " << it->first.first << ", branch: " << it->first.second
+            << ", bytes: " << it->second.bytes << ", idle: " << (now - candidates[i].first.second) << "s";
+    _bytes -= it->second.bytes;
+    bots.erase(it);
+    _evictions++;
+    evicted++;
+  }
+
+  if(_bytes > _budget) {
+    VLOG(2) << __func__ << " still over budget, bytes: " << _bytes << ", budget: " << _budget;
+  }
+
+  return evicted;
+};
+
+bool BotRegistry::erase(const std::string& chatbotID, const std::string& branch) {
+  std::lock_guard<std::mutex> guard(_writer_lock);
+  std::shared_ptr<const BotMap> current = std::atomic_load(&_snapshot);
+  BotMap::const_iterator it = current->find(BotKey(chatbotID, branch));
+
+  if(it == current->end()) {
+    return false;
+  }
+
+  _bytes -= it->second.bytes;
+  std::shared_ptr<BotMap> next = std::make_shared<BotMap>(*current);
+  next->erase(BotKey(chatbotID, branch));
+  std::atomic_store(&_snapshot, std::shared_ptr<const BotMap>(next));
+  return true;
+};
+
+size_t BotRegistry::size() const {
+  return std::atomic_load(&_snapshot)->size();
+};
+
+BotRegistryStats BotRegistry::stats() const {
+  BotRegistryStats stats;
+  stats.bots = size();
+  stats.bytes = _bytes;
+  {
+    std::lock_guard<std::mutex> guard(_writer_lock);
+    stats.budget = _budget;
+  }
+  stats.hits = _hits;
+  stats.misses = _misses;
+  stats.loads = _loads;
+  stats.evictions = _evictions;
+  return stats;
+};
+
+void BotRegistry::report(int intervalSeconds) {
+  if(intervalSeconds > 0 && !_reporter.joinable()) {
+    _stopping = false;
+    _reporter = std::thread(&BotRegistry::run, this, intervalSeconds);
+  }
+};
+
+void BotRegistry::stop() {
+  {
+    std::lock_guard<std::mutex> guard(_stop_lock);
+    _stopping = true;
+  }
+  _stop_cond.notify_all();
+
+  if(_reporter.joinable()) {
+    _reporter.join();
+  }
+};
+
+void BotRegistry::run(int intervalSeconds) {
+  std::unique_lock<std::mutex> lock(_stop_lock);
+
+  while(!_stopping) {
+    if(_stop_cond.wait_for(lock, std::chrono::seconds(intervalSeconds),
+    [this] { return _stopping; })) {
+      break;
+    }
+
+    BotRegistryStats s = stats();
+    LOG(INFO) << "[bot registry] bots: " << s.bots << ", bytes: " << s.bytes << ", budget: " << s.budget
+              << ", hits: " << s.hits << ", misses: " << s.misses << ", loads: " << s.loads
+              << ", evictions: " << s.evictions;
+  }
+};
+
+std::shared_ptr<std::mutex> BotRegistry::loadingLock(const std::string& chatbotID, const std::string& branch) {
+  std::lock_guard<std::mutex> guard(_writer_lock);
+  std::shared_ptr<std::mutex>& lock = _loading[BotKey(chatbotID, branch)];
+
+  if(!lock) {
+    lock = std::make_shared<std::mutex>();
+  }
+
+  return lock;
+};
+
+/**
+ * 引用计数只在 _writer_lock 内增加，计数为1时只剩 _loading 自身引用
+ */
+void BotRegistry::releaseLoadingLock(const std::string& chatbotID, const std::string& branch,
+                                     std::shared_ptr<std::mutex>& lock) {
+  std::lock_guard<std::mutex> guard(_writer_lock);
+  lock.reset();
+  std::map<BotKey, std::shared_ptr<std::mutex> >::iterator it = _loading.find(BotKey(chatbotID, branch));
+
+  if(it != _loading.end() && it->second.use_count() == 1) {
+    _loading.erase(it);
+  }
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
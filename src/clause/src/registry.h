@@ -0,0 +1,123 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/registry.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2019-12-31_15:02:41
+ * @brief
+ * Versioned bot instances shared by chat requests.
+ **/
+#ifndef __CHATOPERA_BOT_CLAUSE_REGISTRY_H__
+#define __CHATOPERA_BOT_CLAUSE_REGISTRY_H__
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <condition_variable>
+#include <string>
+#include <utility>
+#include <stdint.h>
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+class Bot;
+
+typedef std::shared_ptr<Bot> BotPtr;
+
+/**
+ * 运行统计，用于评估节点容量
+ */
+struct BotRegistryStats {
+  size_t bots;          // 已加载的BOT数
+  size_t bytes;         // 估算的内存占用
+  size_t budget;        // 内存预算，0为不限制
+  uint64_t hits;        // 请求时已加载
+  uint64_t misses;      // 请求时未加载
+  uint64_t loads;       // 放入的实例数
+  uint64_t evictions;   // 因超出预算被移除的实例数
+};
+
+/**
+ * 按 (chatbotID, branch) 保存已加载的BOT实例
+ * 读：原子地取得当前快照，不加锁；快照和其中的BOT在读者持有期间不会被释放
+ * 写：复制快照、修改后原子地替换；被替换的BOT在最后一个请求结束后才析构
+ * 同一BOT的加载互斥，不同BOT的加载互不阻塞
+ * 设置内存预算后，放入新实例时按最近使用时间移除空闲的实例，dev分支先于pro分支，
+ * 被移除的BOT在下次请求时重新加载
+ */
+class BotRegistry {
+ public:
+  BotRegistry();
+  ~BotRegistry();
+
+  // budget为0时不限制；空闲不足idleSeconds的实例不会被移除
+  void setBudget(size_t budget, int idleSeconds);
+
+  // 服务请求时读取，计入命中统计并更新最近使用时间
+  BotPtr get(const std::string& chatbotID, const std::string& branch) const;
+  // 加载器等内部读取，不影响统计和淘汰顺序
+  BotPtr find(const std::string& chatbotID, const std::string& branch) const;
+  void put(const std::string& chatbotID, const std::string& branch, const BotPtr& bot);
+  bool erase(const std::string& chatbotID, const std::string& branch);
+  size_t size() const;
+  BotRegistryStats stats() const;
+  // 每隔intervalSeconds秒输出一次统计，0为不输出
+  void report(int intervalSeconds);
+  void stop();
+
+  // 获得该BOT的加载锁，持有期间同一BOT的其它加载请求等待
+  std::shared_ptr<std::mutex> loadingLock(const std::string& chatbotID, const std::string& branch);
+  // 加载结束、解锁后归还，没有其它请求引用时移除
+  void releaseLoadingLock(const std::string& chatbotID, const std::string& branch,
+                          std::shared_ptr<std::mutex>& lock);
+
+ private:
+  typedef std::pair<std::string, std::string> BotKey;
+
+  struct BotEntry {
+    BotPtr bot;
+    size_t bytes;                                   // 估算的内存占用
+    std::shared_ptr<std::atomic<int64_t> > used;    // 最近使用时间，各快照共享
+  };
+
+  typedef std::map<BotKey, BotEntry> BotMap;
+
+  BotRegistry(const BotRegistry&);
+  BotRegistry& operator=(const BotRegistry&);
+
+  // 在写锁内移除空闲实例直到不超过预算，返回移除的数量
+  size_t evict(BotMap& bots, const BotKey& keep);
+  void run(int intervalSeconds);
+
+  std::shared_ptr<const BotMap> _snapshot;                  // 当前快照，只读
+  mutable std::mutex _writer_lock;                          // 串行化快照替换，保护预算设置
+  std::map<BotKey, std::shared_ptr<std::mutex> > _loading;  // 每个BOT的加载锁
+  size_t _budget;                                           // 内存预算，字节
+  int _idle_seconds;                                        // 可移除的最短空闲时间
+  std::atomic<size_t> _bytes;
+  mutable std::atomic<uint64_t> _hits;
+  mutable std::atomic<uint64_t> _misses;
+  std::atomic<uint64_t> _loads;
+  std::atomic<uint64_t> _evictions;
+  std::thread _reporter;                                    // 定期输出统计
+  std::mutex _stop_lock;
+  std::condition_variable _stop_cond;
+  bool _stopping;
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -5,6 +5,7 @@
  **************************************************************************/
 
 #include "subscriber.h"
+#include "versions.h"
 #include "glog/logging.h"
 #include "gflags/gflags.h"
 #include "intent.pb.h"
@@ -127,6 +128,7 @@ void BrokerSubscriber::onMessage(const Message* message) {
       if(publishNewDevVersion(stmt, chatbotID, profile)) {
         // update build status in Redis, update dev version number
         rdone_chatbot_build_and_devver(*_redis, chatbotID, profile.devver().version());
+        BotVersions::getInstance()->set(chatbotID, CL_BOT_BRANCH_DEV, profile.devver().version());
 
         // delete all sessions for this bot in dev branch
         rdel_chatbot_dev_sessions(*_redis, chatbotID);
@@ -13,9 +13,17 @@
  **/
 
 #include "client.h"
+#include "marcos.h"
+#include "SysdictsEntities.hpp"
+
+#ifdef CL_WITH_INPROC_LAC
+#include "ilac.h"
+#endif
 
 DECLARE_string(sysdicts_host);
 DECLARE_int32(sysdicts_port);
+DECLARE_bool(sysdicts_inproc);
+DECLARE_string(sysdicts_lac_conf_dir);
 
 using namespace std;
 
@@ -24,34 +32,241 @@ namespace bot {
 
 namespace sysdicts {
 
+#ifdef CL_WITH_INPROC_LAC
+/**
+ * LAC缓存和结果数组，归 Client 所有，请求期间由一个工作线程独占
+ */
+struct LacBuff {
+  void* buff;
+  tag_t results[CL_BOT_SYSDICT_MAX_RESULT_LEN];
+};
+#endif
 
-
-Client::Client() {
+Client::Client() : _lac_handle(NULL) {
 };
 
 Client::~Client() {
-  _transport->close();
-  delete c;
+  for(Connection* conn : _remote_idle) {
+    closeRemote(conn);
+  }
+
+  _remote_idle.clear();
+
+#ifdef CL_WITH_INPROC_LAC
+
+  // 缓存依赖 _lac_handle，先释放缓存
+  for(LacBuff* local : _lac_idle) {
+    lac_buff_destroy(_lac_handle, local->buff);
+    delete local;
+  }
+
+  _lac_idle.clear();
+
+  if(_lac_handle != NULL) {
+    lac_destroy(_lac_handle);
+  }
+
+#endif
 };
 
 bool Client::init() {
+  if(FLAGS_sysdicts_inproc) {
+#ifdef CL_WITH_INPROC_LAC
+    VLOG(2) << "sysdicts " << __func__ << " in process with config dir: " << FLAGS_sysdicts_lac_conf_dir;
+    _lac_handle = lac_create(FLAGS_sysdicts_lac_conf_dir.c_str());
+
+    if(_lac_handle != NULL) {
+      // 远程服务作为备用，连接失败不影响启动
+      if(!initRemote()) {
+        VLOG(2) << "sysdicts " << __func__ << " remote fallback is unavailable.";
+      }
+
+      return true;
+    }
+
+    VLOG(2) << "sysdicts " << __func__ << " fails to create lac in process, fallback to remote.";
+#else
+    VLOG(2) << "sysdicts " << __func__ << " clause_server is built without CLAUSE_WITH_INPROC_LAC, fallback to remote.";
+#endif
+  }
+
+  return initRemote();
+};
+
+/**
+ * 建立第一个远程连接，检查服务是否可用
+ */
+bool Client::initRemote() {
+  Connection* conn = connectRemote();
+
+  if(conn == NULL) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_pool_lock);
+  _remote_idle.push_back(conn);
+  return true;
+};
+
+Client::Connection* Client::connectRemote() {
+  Connection* conn = new Connection();
+  conn->client = NULL;
+
   try {
     std::shared_ptr<TTransport> socket(new TSocket(FLAGS_sysdicts_host, FLAGS_sysdicts_port));
-    _transport.reset(new TFramedTransport(socket));
-    std::shared_ptr<TProtocol> protocol(new TBinaryProtocol(_transport));
-    _transport->open();
-    c = new ServingClient(protocol);
+    conn->transport.reset(new TFramedTransport(socket));
+    std::shared_ptr<TProtocol> protocol(new TBinaryProtocol(conn->transport));
+    conn->transport->open();
+    conn->client = new ServingClient(protocol);
     VLOG(2) << "sysdicts " << __func__ << " connection successfully.";
-    return true;
+    return conn;
   } catch(std::exception& exception) {
     VLOG(2) << "sysdicts " << __func__ << " exception: " << exception.what();
-    return false;
+    delete conn;
+    return NULL;
   }
 };
 
+void Client::closeRemote(Connection* conn) {
+  try {
+    conn->transport->close();
+  } catch(std::exception& exception) {
+    VLOG(2) << "sysdicts " << __func__ << " exception: " << exception.what();
+  }
+
+  delete conn->client;
+  delete conn;
+};
+
 void Client::label(sysdicts::Data& _return, sysdicts::Data& request) {
-  c->label(_return, request);
+  if(_lac_handle != NULL && labelInProcess(_return, request)) {
+    return;
+  }
+
+  labelRemote(_return, request);
 };
+
+/**
+ * 取一个空闲连接，没有时新建，并发请求各自使用一个连接
+ */
+void Client::labelRemote(sysdicts::Data& _return, sysdicts::Data& request) {
+  Connection* conn = NULL;
+
+  {
+    std::lock_guard<std::mutex> lock(_pool_lock);
+
+    if(!_remote_idle.empty()) {
+      conn = _remote_idle.back();
+      _remote_idle.pop_back();
+    }
+  }
+
+  if(conn == NULL) {
+    conn = connectRemote();
+  }
+
+  if(conn == NULL) {
+    VLOG(2) << "sysdicts " << __func__ << " remote service is unavailable.";
+    return;
+  }
+
+  try {
+    conn->client->label(_return, request);
+  } catch(...) {
+    // 连接状态未知，不再放回
+    closeRemote(conn);
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(_pool_lock);
+  _remote_idle.push_back(conn);
+};
+
+/**
+ * 取一个空闲的LAC缓存，没有时新建，之后复用；失败时返回NULL
+ */
+LacBuff* Client::acquireLacBuff() {
+#ifdef CL_WITH_INPROC_LAC
+  LacBuff* local = NULL;
+
+  {
+    std::lock_guard<std::mutex> lock(_pool_lock);
+
+    if(!_lac_idle.empty()) {
+      local = _lac_idle.back();
+      _lac_idle.pop_back();
+    }
+  }
+
+  if(local != NULL && lac_buff_reset(_lac_handle, local->buff) == 0) {
+    return local;
+  }
+
+  if(local == NULL) {
+    local = new LacBuff();
+  } else {
+    // 清空失败时重新创建
+    lac_buff_destroy(_lac_handle, local->buff);
+  }
+
+  local->buff = lac_buff_create(_lac_handle);
+
+  if(local->buff == NULL) {
+    delete local;
+    return NULL;
+  }
+
+  return local;
+#else
+  return NULL;
+#endif
+};
+
+void Client::releaseLacBuff(LacBuff* local) {
+  std::lock_guard<std::mutex> lock(_pool_lock);
+  _lac_idle.push_back(local);
+};
+
+/**
+ * 在当前线程调用LAC识别命名实体
+ */
+bool Client::labelInProcess(sysdicts::Data& _return, const sysdicts::Data& request) {
+#ifdef CL_WITH_INPROC_LAC
+
+  if(!request.__isset.query) {
+    return false;
+  }
+
+  LacBuff* local = acquireLacBuff();
+
+  if(local == NULL) {
+    VLOG(2) << "sysdicts " << __func__ << " create lac_buff error";
+    return false;
+  }
+
+  int result_num = lac_tagging(_lac_handle,
+                               local->buff,
+                               request.query.c_str(),
+                               local->results,
+                               CL_BOT_SYSDICT_MAX_RESULT_LEN);
+
+  if(result_num < 0) {
+    VLOG(2) << "sysdicts " << __func__ << " tagging failed query: " << request.query;
+    releaseLacBuff(local);
+    return false;
+  }
+
+  set_tags_into_response(_return, request, local->results, result_num);
+  releaseLacBuff(local);
+
+  _return.rc = 0;
+  _return.__isset.rc = true;
+  return true;
+#else
+  return false;
+#endif
+};
+
 } // namespace sysdicts
 } // namespace bot
 } // namespace chatopera
@@ -23,6 +23,8 @@
 #include "serving/server_constants.h"
 #include "serving/server_types.h"
 #include "glog/logging.h"
+#include <mutex>
+#include <vector>
 
 using namespace std;
 using namespace apache::thrift;
@@ -38,6 +40,8 @@ class ServingHandler;
 
 namespace sysdicts {
 
+struct LacBuff;
+
 class Client {
 
   friend class clause::ServingHandler;
@@ -51,8 +55,26 @@ class Client {
   void label(sysdicts::Data& _return, sysdicts::Data& request);
 
  private:
-  std::shared_ptr<TTransport> _transport;
-  ServingClient* c;
+  /**
+   * 到sysdicts服务的连接，ServingClient 不支持多线程同时调用，每次调用独占一个连接
+   */
+  struct Connection {
+    std::shared_ptr<TTransport> transport;
+    ServingClient* client;
+  };
+
+  bool initRemote();
+  bool labelInProcess(sysdicts::Data& _return, const sysdicts::Data& request);
+  void labelRemote(sysdicts::Data& _return, sysdicts::Data& request);
+  Connection* connectRemote();
+  void closeRemote(Connection* conn);
+  LacBuff* acquireLacBuff();
+  void releaseLacBuff(LacBuff* local);
+
+  void* _lac_handle;                    // 进程内LAC，未启用时为NULL
+  std::mutex _pool_lock;
+  std::vector<Connection*> _remote_idle; // 空闲的远程连接，按需新建
+  std::vector<LacBuff*> _lac_idle;       // 空闲的LAC缓存，析构时先于 _lac_handle 释放
 
 };
 
@@ -0,0 +1,268 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/versions.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-02_10:12:36
+ * @brief
+ *
+ **/
+
+#include "versions.h"
+#include <vector>
+#include <chrono>
+#include "glog/logging.h"
+#include "raf.hpp"
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+BotVersions* BotVersions::_instance = NULL;
+
+BotVersions::BotVersions() :
+  _redis(NULL),
+  _interval(0),
+  _snapshot(std::make_shared<const VersionMap>()),
+  _stopping(false) {
+};
+
+BotVersions::~BotVersions() {
+  stop();
+};
+
+BotVersions* BotVersions::getInstance() {
+  if(_instance == NULL) {
+    _instance = new BotVersions();
+  }
+
+  return _instance;
+};
+
+bool BotVersions::init(const chatopera::redis::Redis* redis, int reconcileInterval) {
+  _redis = redis;
+  _interval = reconcileInterval > 0 ? reconcileInterval : 0;
+
+  if(_interval > 0 && !_reconciler.joinable()) {
+    _stopping = false;
+    _reconciler = std::thread(&BotVersions::run, this);
+  }
+
+  VLOG(3) << __func__ << " bot versions reconcile interval: " << _interval << "s";
+  return true;
+};
+
+void BotVersions::stop() {
+  {
+    std::lock_guard<std::mutex> guard(_stop_lock);
+    _stopping = true;
+  }
+  _stop_cond.notify_all();
+
+  if(_reconciler.joinable()) {
+    _reconciler.join();
+  }
+};
+
+bool BotVersions::enabled() const {
+  return _interval > 0;
+};
+
+/**
+ * 通知在 _listener_lock 内进行，替换监听者时等待进行中的通知结束
+ */
+void BotVersions::listen(const Listener& listener) {
+  std::lock_guard<std::mutex> guard(_listener_lock);
+  _listener = listener;
+};
+
+void BotVersions::notify(const BotKey& key, const std::string& version, bool reconciled) const {
+  std::lock_guard<std::mutex> guard(_listener_lock);
+
+  if(_listener) {
+    _listener(key.first, key.second, version, reconciled);
+  }
+};
+
+/**
+ * 无锁读取
+ */
+bool BotVersions::get(const std::string& chatbotID,
+                      const std::string& branch,
+                      std::string& version) const {
+  if(!enabled()) {
+    return false;
+  }
+
+  std::shared_ptr<const VersionMap> snapshot = std::atomic_load(&_snapshot);
+  VersionMap::const_iterator it = snapshot->find(BotKey(chatbotID, branch));
+
+  if(it == snapshot->end()) {
+    return false;
+  }
+
+  version = it->second;
+  return true;
+};
+
+void BotVersions::set(const std::string& chatbotID,
+                      const std::string& branch,
+                      const std::string& version) {
+  // 本地表未启用时仍然通知，事件触发的预加载不依赖本地表
+  if(update(BotKey(chatbotID, branch), version, true) || !enabled()) {
+    notify(BotKey(chatbotID, branch), version, false);
+  }
+};
+
+void BotVersions::remember(const std::string& chatbotID,
+                           const std::string& branch,
+                           const std::string& version) {
+  update(BotKey(chatbotID, branch), version, false);
+};
+
+/**
+ * 返回本地表是否被修改
+ */
+bool BotVersions::update(const BotKey& key, const std::string& version, bool overwrite) {
+  if(!enabled() || version.empty()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(_writer_lock);
+  std::shared_ptr<const VersionMap> current = std::atomic_load(&_snapshot);
+  VersionMap::const_iterator it = current->find(key);
+
+  if(it != current->end() && (!overwrite || it->second == version)) {
+    return false;
+  }
+
+  std::shared_ptr<VersionMap> next = std::make_shared<VersionMap>(*current);
+  (*next)[key] = version;
+  std::atomic_store(&_snapshot, std::shared_ptr<const VersionMap>(next));
+  return true;
+};
+
+bool BotVersions::erase(const std::string& chatbotID, const std::string& branch) {
+  std::lock_guard<std::mutex> guard(_writer_lock);
+  std::shared_ptr<const VersionMap> current = std::atomic_load(&_snapshot);
+
+  if(current->find(BotKey(chatbotID, branch)) == current->end()) {
+    return false;
+  }
+
+  std::shared_ptr<VersionMap> next = std::make_shared<VersionMap>(*current);
+  next->erase(BotKey(chatbotID, branch));
+  std::atomic_store(&_snapshot, std::shared_ptr<const VersionMap>(next));
+  return true;
+};
+
+size_t BotVersions::size() const {
+  return std::atomic_load(&_snapshot)->size();
+};
+
+/**
+ * 一次MGET取回所有已知BOT的版本
+ * 只修正核对期间没有被事件更新过的条目，避免用旧值覆盖新事件
+ * Redis中已不存在的版本从本地表删除，下次请求重新读取Redis
+ */
+size_t BotVersions::reconcile() {
+  if(_redis == NULL) {
+    return 0;
+  }
+
+  std::shared_ptr<const VersionMap> before = std::atomic_load(&_snapshot);
+
+  if(before->empty()) {
+    return 0;
+  }
+
+  std::vector<std::string> keys;
+  keys.reserve(before->size());
+
+  for(VersionMap::const_iterator it = before->begin(); it != before->end(); it++) {
+    if(it->first.second == CL_BOT_BRANCH_DEV) {
+      keys.push_back(rkey_chatbot_devver(it->first.first));
+    } else {
+      keys.push_back(rkey_chatbot_prover(it->first.first));
+    }
+  }
+
+  std::vector<std::string> values;
+
+  if(!_redis->mget(keys, values) || values.size() != keys.size()) {
+    VLOG(2) << __func__ << " mget versions fails, keys: " << keys.size();
+    return 0;
+  }
+
+  std::vector<std::pair<BotKey, std::string> > changes;
+  std::unique_lock<std::mutex> guard(_writer_lock);
+  std::shared_ptr<const VersionMap> current = std::atomic_load(&_snapshot);
+  std::shared_ptr<VersionMap> next;
+  size_t fixed = 0;
+  size_t i = 0;
+
+  for(VersionMap::const_iterator it = before->begin(); it != before->end(); it++, i++) {
+    if(values[i] == it->second) {
+      continue;
+    }
+
+    VersionMap::const_iterator cur = current->find(it->first);
+
+    if(cur == current->end() || cur->second != it->second) {
+      continue; // 核对期间已被事件更新或删除
+    }
+
+    if(!next) {
+      next = std::make_shared<VersionMap>(*current);
+    }
+
+    if(values[i].empty()) {
+      next->erase(it->first);
+    } else {
+      (*next)[it->first] = values[i];
+      changes.push_back(std::make_pair(it->first, values[i]));
+    }
+
+    VLOG(3) << __func__ << " chatbotID: " << it->first.first << ", branch: " << it->first.second
+            << ", version: " << it->second << " -> " << values[i];
+    fixed++;
+  }
+
+  if(next) {
+    std::atomic_store(&_snapshot, std::shared_ptr<const VersionMap>(next));
+  }
+
+  guard.unlock();
+
+  for(const std::pair<BotKey, std::string>& change : changes) {
+    notify(change.first, change.second, true);
+  }
+
+  return fixed;
+};
+
+void BotVersions::run() {
+  std::unique_lock<std::mutex> lock(_stop_lock);
+
+  while(!_stopping) {
+    if(_stop_cond.wait_for(lock, std::chrono::seconds(_interval),
+    [this] { return _stopping; })) {
+      break;
+    }
+
+    lock.unlock();
+    reconcile();
+    lock.lock();
+  }
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
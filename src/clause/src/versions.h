@@ -0,0 +1,99 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/clause/src/versions.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-02_10:12:36
+ * @brief
+ * In-process table of bot versions, updated by events and reconciled with Redis.
+ **/
+#ifndef __CHATOPERA_BOT_CLAUSE_VERSIONS_H__
+#define __CHATOPERA_BOT_CLAUSE_VERSIONS_H__
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <functional>
+#include <condition_variable>
+
+#include "redis.h"
+
+namespace chatopera {
+namespace bot {
+namespace clause {
+
+/**
+ * 按 (chatbotID, branch) 记录当前生效的BOT版本
+ * 训练完成、上线等事件直接更新本地表，聊天请求读取本地表，不再每次访问Redis
+ * 后台线程定期用MGET与Redis核对，弥补丢失的事件（如其它实例处理的消息）
+ * 核对间隔为0时不启用本地表，get总是未命中
+ * 版本变化时通知监听者，reconciled表示变化来自核对而不是事件
+ */
+class BotVersions {
+ public:
+  typedef std::function<void(const std::string& chatbotID,
+                             const std::string& branch,
+                             const std::string& version,
+                             bool reconciled)> Listener;
+
+  static BotVersions* getInstance();
+
+  bool init(const chatopera::redis::Redis* redis, int reconcileInterval);
+  void stop();
+  bool enabled() const;
+  void listen(const Listener& listener);
+
+  // 读取本地版本，未命中时返回false
+  bool get(const std::string& chatbotID, const std::string& branch, std::string& version) const;
+  // 事件通知的新版本，覆盖本地值
+  void set(const std::string& chatbotID, const std::string& branch, const std::string& version);
+  // 从Redis读到的版本，只在本地没有记录时写入，不覆盖并发到达的事件
+  void remember(const std::string& chatbotID, const std::string& branch, const std::string& version);
+  bool erase(const std::string& chatbotID, const std::string& branch);
+  size_t size() const;
+
+  // 与Redis核对一次，返回被修正的条目数
+  size_t reconcile();
+
+ private:
+  typedef std::pair<std::string, std::string> BotKey;
+  typedef std::map<BotKey, std::string> VersionMap;
+
+  BotVersions();
+  ~BotVersions();
+  BotVersions(const BotVersions&);
+  BotVersions& operator=(const BotVersions&);
+
+  void run();
+  bool update(const BotKey& key, const std::string& version, bool overwrite);
+  void notify(const BotKey& key, const std::string& version, bool reconciled) const;
+
+  const chatopera::redis::Redis* _redis;
+  int _interval;                                     // 核对间隔，秒
+  std::shared_ptr<const VersionMap> _snapshot;       // 当前快照，只读
+  std::mutex _writer_lock;                           // 串行化快照替换
+  Listener _listener;                                // 版本变化监听者，在init前设置
+  mutable std::mutex _listener_lock;                 // 保护 _listener
+  std::thread _reconciler;
+  std::mutex _stop_lock;
+  std::condition_variable _stop_cond;
+  bool _stopping;
+
+  static BotVersions* _instance;
+};
+
+} // namespace clause
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,72 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/distance/src/charseq.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-06_11:08:27
+ * @brief
+ * Characters as packed integer codes for similarity comparing.
+ **/
+
+#ifndef __CHATOPERA_BOT_DISTANCE_CHARSEQ_H__
+#define __CHATOPERA_BOT_DISTANCE_CHARSEQ_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace chatopera {
+namespace bot {
+namespace distance {
+
+/**
+ * 按 CharSegment 的规则切分字符，每个字符的字节按大端放入一个uint32
+ * 编码的大小顺序与字符串的字节序一致，排序结果与按字符串排序相同
+ * 超过4字节的非法序列只保留前4字节
+ */
+inline size_t AppendCharCodes(const std::string& text, std::vector<uint32_t>& codes) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+  const size_t size = text.size();
+  size_t count = 0;
+
+  for(size_t i = 0; i < size;) {
+    size_t len = 1;
+
+    if((p[i] & 0xFC) == 0xFC && i + 6 <= size) {
+      len = 6;
+    } else if((p[i] & 0xF8) == 0xF8 && i + 5 <= size) {
+      len = 5;
+    } else if((p[i] & 0xF0) == 0xF0 && i + 4 <= size) {
+      len = 4;
+    } else if((p[i] & 0xE0) == 0xE0 && i + 3 <= size) {
+      len = 3;
+    } else if((p[i] & 0xC0) == 0xC0 && i + 2 <= size) {
+      len = 2;
+    }
+
+    uint32_t code = 0;
+
+    for(size_t k = 0; k < 4; k++) {
+      code = (code << 8) | (k < len ? p[i + k] : 0);
+    }
+
+    codes.push_back(code);
+    i += len;
+    count++;
+  }
+
+  return count;
+}
+
+} // namespace distance
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -14,6 +14,7 @@
 
 
 #include "levenshtein.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -63,6 +64,149 @@ double LevenshteinDistance::score(const vector<string>& lhs, const vector<string
   return 1.0 - result / (double) max(m, n);
 };
 
+/**
+ * 位并行编辑距离（Myers 1999, Hyyrö 2003）
+ * pattern 的每个位置对应Word中的一位，逐个处理text中的字符，O(n)次位运算
+ * Peq 在栈上构建：pattern 的字符排序去重后二分查找，不分配内存
+ */
+template<typename Word>
+static size_t bit_parallel_distance(const uint32_t* pattern, const size_t& m,
+                                    const uint32_t* text, const size_t& n) {
+  struct Peq {
+    uint32_t symbol;
+    Word mask;
+  };
+
+  Peq peq[sizeof(Word) * 8];
+
+  for(size_t i = 0; i < m; i++) {
+    peq[i].symbol = pattern[i];
+    peq[i].mask = Word(1) << i;
+  }
+
+  std::sort(peq, peq + m, [](const Peq & lhs, const Peq & rhs) {
+    return lhs.symbol < rhs.symbol;
+  });
+
+  size_t symbols = 0;
+
+  for(size_t i = 0; i < m; i++) {
+    if(symbols > 0 && peq[symbols - 1].symbol == peq[i].symbol) {
+      peq[symbols - 1].mask |= peq[i].mask;
+    } else {
+      peq[symbols++] = peq[i];
+    }
+  }
+
+  const Word last = Word(1) << (m - 1);
+  Word pv = ~Word(0);
+  Word mv = 0;
+  size_t score = m;
+
+  for(size_t j = 0; j < n; j++) {
+    // 二分查找text字符在pattern中出现的位置
+    size_t lo = 0, hi = symbols;
+
+    while(lo < hi) {
+      size_t mid = (lo + hi) >> 1;
+
+      if(peq[mid].symbol < text[j]) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    const Word eq = (lo < symbols && peq[lo].symbol == text[j]) ? peq[lo].mask : Word(0);
+    const Word xv = eq | mv;
+    const Word xh = (((eq & pv) + pv) ^ pv) | eq;
+    Word ph = mv | ~(xh | pv);
+    Word mh = pv & xh;
+
+    if(ph & last) {
+      score++;
+    } else if(mh & last) {
+      score--;
+    }
+
+    // 第0行的水平差值恒为+1，求全局编辑距离
+    ph = (ph << 1) | Word(1);
+    mh = mh << 1;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+  }
+
+  return score;
+}
+
+/**
+ * 较短的序列作为pattern，不超过64（支持__int128时128）用位并行，更长的逐行计算
+ */
+size_t LevenshteinDistance::distance(const uint32_t* lhs, const size_t& m, const uint32_t* rhs, const size_t& n) {
+  if(m == 0 || n == 0) {
+    return max(m, n);
+  }
+
+  const uint32_t* pattern = m <= n ? lhs : rhs;
+  const uint32_t* text = m <= n ? rhs : lhs;
+  const size_t plen = min(m, n);
+  const size_t tlen = max(m, n);
+
+  if(plen <= 64) {
+    return bit_parallel_distance<uint64_t>(pattern, plen, text, tlen);
+  }
+
+#ifdef __SIZEOF_INT128__
+
+  if(plen <= 128) {
+    return bit_parallel_distance<unsigned __int128>(pattern, plen, text, tlen);
+  }
+
+#endif
+
+  return distanceByRow(lhs, m, rhs, n);
+};
+
+/**
+ * 动态规划，只保留一行代价
+ */
+size_t LevenshteinDistance::distanceByRow(const uint32_t* lhs, const size_t& m, const uint32_t* rhs, const size_t& n) {
+  if(m == 0 || n == 0) {
+    return max(m, n);
+  }
+
+  vector<size_t> costs(n + 1);
+
+  for( size_t k = 0; k <= n; k++ ) costs[k] = k;
+
+  for (size_t i = 0; i < m; ++i ) {
+    costs[0] = i + 1;
+    size_t corner = i;
+
+    for (size_t j = 0; j < n; ++j ) {
+      size_t upper = costs[j + 1];
+
+      if( lhs[i] == rhs[j] ) {
+        costs[j + 1] = corner;
+      } else {
+        size_t t(upper < corner ? upper : corner);
+        costs[j + 1] = (costs[j] < t ? costs[j] : t) + 1;
+      }
+
+      corner = upper;
+    }
+  }
+
+  return costs[n];
+};
+
+double LevenshteinDistance::score(const uint32_t* lhs, const size_t& m, const uint32_t* rhs, const size_t& n) {
+  if (m == 0 || n == 0)
+    return 0.0;
+
+  return 1.0 - distance(lhs, m, rhs, n) / (double) max(m, n);
+};
+
 } // namespace distance
 } // namespace bot
 } // namespace chatopera
@@ -18,6 +18,7 @@
 
 #include <string>
 #include <vector>
+#include <stdint.h>
 
 using namespace std;
 
@@ -29,6 +30,11 @@ class LevenshteinDistance {
  public: // methods
   LevenshteinDistance();
   static double score(const vector<string>& lhs, const vector<string>& rhs);
+  static double score(const uint32_t* lhs, const size_t& m, const uint32_t* rhs, const size_t& n);
+  // 编辑距离，短序列用位并行计算，不分配内存
+  static size_t distance(const uint32_t* lhs, const size_t& m, const uint32_t* rhs, const size_t& n);
+  // 逐行动态规划，用于超长序列和校验
+  static size_t distanceByRow(const uint32_t* lhs, const size_t& m, const uint32_t* rhs, const size_t& n);
 };
 
 } // namespace distance
@@ -37,15 +37,24 @@ double Similarity::compare(const vector<string>& lhs, const vector<string>& rhs)
 
   // sort string vectors
   std::sort(x.rbegin(), x.rend(), [] (const string & lhs, const string & rhs) {
-    return lhs.compare(rhs) >= 0;
+    return lhs.compare(rhs) > 0;
   });
 
   std::sort(y.rbegin(), y.rend(), [] (const string & lhs, const string & rhs) {
-    return lhs.compare(rhs) >= 0;
+    return lhs.compare(rhs) > 0;
   });
 
-  double overlap = WordOverlap::score(x, y);
-  double levenshteinDistance = LevenshteinDistance::score(x, y);
+  return combine(WordOverlap::score(x, y), LevenshteinDistance::score(x, y));
+};
+
+double Similarity::compare(const uint32_t* lhs, const size_t& m, const uint32_t* rhs, const size_t& n) {
+  return combine(WordOverlap::score(lhs, m, rhs, n), LevenshteinDistance::score(lhs, m, rhs, n));
+};
+
+/**
+ * 合并重合度和编辑距离
+ */
+double Similarity::combine(const double& overlap, const double& levenshteinDistance) {
   VLOG(4) << __func__ << " compare overlap: " << overlap << ", levenshteinDistance: " << levenshteinDistance;
   double result = 0.0;
 
@@ -61,6 +70,76 @@ double Similarity::compare(const vector<string>& lhs, const vector<string>& rhs)
   return std::min(result, 1.0);
 };
 
+/**
+ * 带剪枝的最优候选
+ * 编辑距离 >= max(m, n) - 公共元素个数，由重合度得到编辑距离相似度的上界，
+ * combine 对编辑距离单调不减，因此 combine(overlap, 上界) 是得分的上界。
+ * 按上界从高到低计算编辑距离，上界低于当前最优或阈值时结束。
+ */
+int Similarity::best(const uint32_t* lhs, const size_t& m,
+                     const vector<pair<const uint32_t*, const uint32_t*> >& candidates,
+                     const double& threshold, double& score) {
+  struct Bound {
+    size_t index;
+    double overlap;
+    double upper;
+  };
+
+  vector<Bound> bounds;
+  bounds.reserve(candidates.size());
+
+  for(size_t i = 0; i < candidates.size(); i++) {
+    const uint32_t* rhs = candidates[i].first;
+    const size_t n = candidates[i].second - rhs;
+
+    Bound bound;
+    bound.index = i;
+    bound.overlap = 0.0;
+    bound.upper = combine(0.0, 0.0);
+
+    if(m > 0 && n > 0) {
+      const size_t common = WordOverlap::intersection(lhs, m, rhs, n);
+      bound.overlap = (double) common / (double) std::min(m, n);
+      bound.upper = combine(bound.overlap, (double) common / (double) std::max(m, n));
+    }
+
+    if(bound.upper >= threshold) {
+      bounds.push_back(bound);
+    }
+  }
+
+  std::stable_sort(bounds.begin(), bounds.end(), [](const Bound & lhs, const Bound & rhs) {
+    return lhs.upper > rhs.upper;
+  });
+
+  int result = -1;
+  size_t evaluated = 0;
+
+  for(const Bound& bound : bounds) {
+    if(result >= 0 && (bound.upper < score || (bound.upper == score && bound.index > (size_t) result))) {
+      break;
+    }
+
+    const uint32_t* rhs = candidates[bound.index].first;
+    const size_t n = candidates[bound.index].second - rhs;
+    double current = combine(bound.overlap, LevenshteinDistance::score(lhs, m, rhs, n));
+    evaluated++;
+
+    if(current < threshold) {
+      continue;
+    }
+
+    if(result < 0 || current > score || (current == score && bound.index < (size_t) result)) {
+      result = bound.index;
+      score = current;
+    }
+  }
+
+  VLOG(3) << __func__ << " candidates: " << candidates.size() << ", bounded: " << bounds.size()
+          << ", evaluated: " << evaluated;
+  return result;
+};
+
 /**
  * 排序接口
  */
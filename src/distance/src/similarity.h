@@ -23,6 +23,7 @@
 
 #include "levenshtein.h"
 #include "wordoverlap.h"
+#include "charseq.h"
 
 using namespace std;
 using namespace boost::algorithm;
@@ -38,6 +39,13 @@ class Similarity {
 
  public: // functions
   double compare(const vector<string>& lhs, const vector<string>& rhs);
+  // 字符编码见 charseq.h，输入需已升序排列，结果与字符串版本相同
+  double compare(const uint32_t* lhs, const size_t& m, const uint32_t* rhs, const size_t& n);
+  static double combine(const double& overlap, const double& levenshteinDistance);
+  // 找出得分最高且不低于threshold的候选，返回下标，没有时返回-1；同分取靠前的候选
+  int    best(const uint32_t* lhs, const size_t& m,
+              const vector<pair<const uint32_t*, const uint32_t*> >& candidates,
+              const double& threshold, double& score);
   bool   sort(const std::vector<std::string>& post,
               const vector<pair<string, vector<string> > >& relevants,
               vector<pair<string, double> >& scores);
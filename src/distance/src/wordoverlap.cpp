@@ -40,6 +40,36 @@ double WordOverlap::score(const vector<string>& lhs, const vector<string>& rhs)
   return size_lhs >= size_rhs ? ((double)intersection.size() / (double) size_rhs) : ((double) intersection.size() / (double) size_lhs);
 };
 
+/**
+ * 有序编码序列的重合度，与字符串版本相同，双指针求交集不分配内存
+ */
+double WordOverlap::score(const uint32_t* lhs, const size_t& size_lhs, const uint32_t* rhs, const size_t& size_rhs) {
+  if (size_lhs == 0 || size_rhs == 0) {
+    return 0.0;
+  }
+
+  size_t intersection = WordOverlap::intersection(lhs, size_lhs, rhs, size_rhs);
+  return size_lhs >= size_rhs ? ((double)intersection / (double) size_rhs) : ((double) intersection / (double) size_lhs);
+};
+
+size_t WordOverlap::intersection(const uint32_t* lhs, const size_t& size_lhs, const uint32_t* rhs, const size_t& size_rhs) {
+  size_t intersection = 0;
+
+  for(size_t i = 0, j = 0; i < size_lhs && j < size_rhs;) {
+    if(lhs[i] < rhs[j]) {
+      i++;
+    } else if(rhs[j] < lhs[i]) {
+      j++;
+    } else {
+      intersection++;
+      i++;
+      j++;
+    }
+  }
+
+  return intersection;
+};
+
 double WordOverlap::score(const set<string>& lhs, const set<string>& rhs) {
   unsigned int size_lhs = lhs.size();
   unsigned int size_rhs = rhs.size();
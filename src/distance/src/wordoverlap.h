@@ -20,6 +20,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 #include "StringUtils.hpp"
 
@@ -36,6 +37,9 @@ class WordOverlap {
 
  public: // functions
   static double score(const vector<string> & lhs, const vector<string>& rhs);
+  static double score(const uint32_t* lhs, const size_t& size_lhs, const uint32_t* rhs, const size_t& size_rhs);
+  // 两个升序序列的公共元素个数（多重集合交集）
+  static size_t intersection(const uint32_t* lhs, const size_t& size_lhs, const uint32_t* rhs, const size_t& size_rhs);
   static double score(const set<string> & lhs, const set<string>& rhs);
 };
 
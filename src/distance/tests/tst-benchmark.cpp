@@ -0,0 +1,132 @@
+/*
+ * distance kernels benchmark.
+ *
+ * @author   hain
+ * @email    hain@chatopera.com
+ */
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include "similarity.h"
+
+using namespace std;
+using namespace chatopera::bot::distance;
+
+static const std::vector<std::string> BENCH_LINES = {
+  "我想明天下午去上海虹桥火车站",
+  "帮我订一张后天从广州到深圳的高铁票",
+  "请问北京大学第三医院几点开门",
+  "下个月五号之前把报告发给王经理",
+  "杭州西湖边的酒店今晚还有房间吗",
+  "查一下明天北京的天气",
+  "我要退货",
+  "你们的客服电话是多少，我的订单一直没有发货，能帮我看看吗"
+};
+
+static const int BENCH_ROUNDS = 2000;
+
+/**
+ * 字符串版本与字符编码版本的相似度计算耗时
+ */
+TEST(DistanceTest, COMPARE_THROUGHPUT) {
+  vector<vector<string> > chars;
+  vector<vector<uint32_t> > codes;
+
+  for(const string& line : BENCH_LINES) {
+    vector<uint32_t> c;
+    AppendCharCodes(line, c);
+    vector<string> s;
+
+    for(const uint32_t& code : c) {
+      string ch;
+
+      for(int shift = 24; shift >= 0; shift -= 8) {
+        char b = (code >> shift) & 0xFF;
+
+        if(b != 0) ch.push_back(b);
+      }
+
+      s.push_back(ch);
+    }
+
+    std::sort(c.begin(), c.end());
+    chars.push_back(s);
+    codes.push_back(c);
+  }
+
+  Similarity similarity;
+  double checksum[2] = {0.0, 0.0};
+  auto start = std::chrono::steady_clock::now();
+
+  for(int round = 0; round < BENCH_ROUNDS; round++) {
+    for(size_t i = 0; i < chars.size(); i++) {
+      for(size_t j = 0; j < chars.size(); j++) {
+        checksum[0] += similarity.compare(chars[i], chars[j]);
+      }
+    }
+  }
+
+  double strings = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+
+  for(int round = 0; round < BENCH_ROUNDS; round++) {
+    for(size_t i = 0; i < codes.size(); i++) {
+      for(size_t j = 0; j < codes.size(); j++) {
+        checksum[1] += similarity.compare(codes[i].data(), codes[i].size(),
+                                          codes[j].data(), codes[j].size());
+      }
+    }
+  }
+
+  double packed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_DOUBLE_EQ(checksum[0], checksum[1]);
+
+  std::cout << "compare pairs: " << BENCH_ROUNDS * chars.size() * chars.size()
+            << ", strings: " << strings << "ms"
+            << ", packed: " << packed << "ms" << std::endl;
+}
+
+/**
+ * 逐行动态规划与位并行编辑距离的耗时
+ */
+TEST(DistanceTest, LEVENSHTEIN_THROUGHPUT) {
+  vector<vector<uint32_t> > codes(BENCH_LINES.size());
+
+  for(size_t i = 0; i < BENCH_LINES.size(); i++) {
+    AppendCharCodes(BENCH_LINES[i], codes[i]);
+  }
+
+  size_t checksum[2] = {0, 0};
+  auto start = std::chrono::steady_clock::now();
+
+  for(int round = 0; round < BENCH_ROUNDS; round++) {
+    for(const vector<uint32_t>& lhs : codes) {
+      for(const vector<uint32_t>& rhs : codes) {
+        checksum[0] += LevenshteinDistance::distanceByRow(lhs.data(), lhs.size(), rhs.data(), rhs.size());
+      }
+    }
+  }
+
+  double rows = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+
+  for(int round = 0; round < BENCH_ROUNDS; round++) {
+    for(const vector<uint32_t>& lhs : codes) {
+      for(const vector<uint32_t>& rhs : codes) {
+        checksum[1] += LevenshteinDistance::distance(lhs.data(), lhs.size(), rhs.data(), rhs.size());
+      }
+    }
+  }
+
+  double bits = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_EQ(checksum[0], checksum[1]);
+
+  std::cout << "levenshtein pairs: " << BENCH_ROUNDS * codes.size() * codes.size()
+            << ", dynamic programming: " << rows << "ms"
+            << ", bit parallel: " << bits << "ms" << std::endl;
+}
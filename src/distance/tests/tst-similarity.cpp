@@ -0,0 +1,136 @@
+/*
+ * distance kernels consistency.
+ *
+ * @author   hain
+ * @email    hain@chatopera.com
+ */
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include "similarity.h"
+
+using namespace std;
+using namespace chatopera::bot::distance;
+
+static const std::vector<std::string> CHAR_POOL = {
+  "我", "你", "好", "的", "天", "气", "北", "京", "a", "b", "Z", "1", "?", "\xc3\xa9"
+};
+
+/**
+ * 随机生成字符序列，同时返回字符串和字符编码两种表示
+ */
+static void randomChars(std::mt19937& rng, const size_t& size,
+                        vector<string>& chars, vector<uint32_t>& codes) {
+  chars.clear();
+  codes.clear();
+
+  for(size_t i = 0; i < size; i++) {
+    const string& c = CHAR_POOL[rng() % CHAR_POOL.size()];
+    chars.push_back(c);
+    AppendCharCodes(c, codes);
+  }
+}
+
+/**
+ * 位并行编辑距离与逐行动态规划一致，覆盖64和128位以及更长的序列
+ */
+TEST(DistanceTest, BIT_PARALLEL_LEVENSHTEIN) {
+  std::mt19937 rng(20191231);
+  const size_t sizes[] = {0, 1, 2, 7, 31, 63, 64, 65, 100, 127, 128, 129, 200};
+  vector<string> chars;
+  vector<uint32_t> lhs, rhs;
+
+  for(const size_t& m : sizes) {
+    for(const size_t& n : sizes) {
+      for(int round = 0; round < 5; round++) {
+        randomChars(rng, m, chars, lhs);
+        randomChars(rng, n, chars, rhs);
+        EXPECT_EQ(LevenshteinDistance::distance(lhs.data(), m, rhs.data(), n),
+                  LevenshteinDistance::distanceByRow(lhs.data(), m, rhs.data(), n))
+            << "m: " << m << ", n: " << n;
+      }
+    }
+  }
+
+  vector<uint32_t> x = {1, 2, 3, 4, 5};
+  vector<uint32_t> y = {1, 3, 4, 6, 5, 7};
+  EXPECT_EQ(LevenshteinDistance::distance(x.data(), x.size(), y.data(), y.size()), 3);
+  EXPECT_EQ(LevenshteinDistance::distance(y.data(), y.size(), x.data(), x.size()), 3);
+}
+
+/**
+ * 字符编码版本的相似度与字符串版本相同
+ */
+TEST(DistanceTest, PACKED_COMPARE) {
+  std::mt19937 rng(20200101);
+  Similarity similarity;
+  vector<string> lchars, rchars;
+  vector<uint32_t> lhs, rhs;
+
+  for(int round = 0; round < 5000; round++) {
+    randomChars(rng, rng() % 40, lchars, lhs);
+    randomChars(rng, rng() % 40, rchars, rhs);
+    std::sort(lhs.begin(), lhs.end());
+    std::sort(rhs.begin(), rhs.end());
+    EXPECT_DOUBLE_EQ(similarity.compare(lchars, rchars),
+                     similarity.compare(lhs.data(), lhs.size(), rhs.data(), rhs.size()));
+  }
+}
+
+/**
+ * 剪枝后的最优候选与逐个比较的结果相同
+ */
+TEST(DistanceTest, BEST_CANDIDATE) {
+  std::mt19937 rng(20200102);
+  Similarity similarity;
+  vector<string> chars;
+  vector<uint32_t> lhs;
+
+  for(int round = 0; round < 500; round++) {
+    randomChars(rng, 1 + rng() % 12, chars, lhs);
+    std::sort(lhs.begin(), lhs.end());
+
+    vector<vector<uint32_t> > samples(rng() % 40);
+    vector<pair<const uint32_t*, const uint32_t*> > candidates;
+
+    for(vector<uint32_t>& sample : samples) {
+      // 一半的候选由查询改写得到，保证有高分的近似重复
+      if(rng() % 2 == 0) {
+        sample = lhs;
+
+        if(!sample.empty() && rng() % 2 == 0) sample.pop_back();
+
+        if(rng() % 2 == 0) AppendCharCodes(CHAR_POOL[rng() % CHAR_POOL.size()], sample);
+      } else {
+        randomChars(rng, rng() % 16, chars, sample);
+      }
+
+      std::sort(sample.begin(), sample.end());
+      candidates.push_back(make_pair(sample.data(), sample.data() + sample.size()));
+    }
+
+    const double threshold = (rng() % 10) / 10.0;
+    int expected = -1;
+    double expectedScore = 0.0;
+
+    for(size_t i = 0; i < samples.size(); i++) {
+      double score = similarity.compare(lhs.data(), lhs.size(), samples[i].data(), samples[i].size());
+
+      if(score >= threshold && (expected < 0 || score > expectedScore)) {
+        expected = i;
+        expectedScore = score;
+      }
+    }
+
+    double score = 0.0;
+    EXPECT_EQ(similarity.best(lhs.data(), lhs.size(), candidates, threshold, score), expected);
+
+    if(expected >= 0) {
+      EXPECT_DOUBLE_EQ(score, expectedScore);
+    }
+  }
+}
@@ -545,7 +545,7 @@ inline bool appendNerTrainingData(const Augmented::Sample& sample, ofstream& f)
   const signed int length = (sample.terms_size() - 1);
 
   // 标识位
-  signed int curr, pre2, pre1, post1, post2;
+  signed int curr = 0, pre2, pre1, post1, post2;
 
   google::protobuf::RepeatedPtrField<std::basic_string<char> >::const_iterator term = sample.terms().begin();
   google::protobuf::RepeatedPtrField<std::basic_string<char> >::const_iterator pos = sample.poss().begin();
@@ -21,6 +21,9 @@
 #include "StringUtils.hpp"
 #include "FileUtils.hpp"
 #include "crfsuite.hpp"
+#include "linear.h"
+#include "MembershipTable.hpp"
+#include "DictwordsAutomaton.hpp"
 #include "tsl/serialize.hpp"
 #include "leveldb/db.h"
 #include "leveldb/write_batch.h"
@@ -295,11 +298,14 @@ void Trainer::train(const string payload) {
   const std::string versiondir(botdir + "/" + ver);
   const std::string indexdir(versiondir + "/xapian");
   const std::string dictfile(versiondir + "/dictwords.trie.bin");
+  const std::string dictautomatonfile(versiondir + "/" + CL_DICTWORDS_AUTOMATON);
   const std::string dictdb(versiondir + "/leveldb");
+  const std::string dictmembersfile(versiondir + "/" + CL_DICTWORDS_MEMBERSHIP);
   const std::string dictdir(versiondir + "/jieba");
   const std::string customdictfile(dictdir + "/user.dict.utf8");
   const std::string nertrainfile(versiondir + "/crfsuite.train.txt");
   const std::string nermodelfile(versiondir + "/crfsuite.ner.model");
+  const std::string linearfile(versiondir + "/" + CL_INTENT_LINEAR_MODEL);
   const fs::path profileJsonFile(versiondir + "/profile.json");
   const fs::path profileStringifyFile(versiondir + "/profile.pbs");
   const fs::path augmentedfile(versiondir + "/augmented.json");
@@ -347,11 +353,20 @@ void Trainer::train(const string payload) {
 
   // 创建分词器
   VLOG(3) << __func__ << " start to init tokenizer ...";
-  cppjieba::Jieba* tokenizer = new cppjieba::Jieba( dictdir + "/jieba.dict.utf8",
-      dictdir + "/hmm_model.utf8",
-      customdictfile,
-      dictdir + "/idf.utf8",
-      dictdir + "/stop_words.utf8");
+  // 基础词典在各次训练间共享，只加载本次的用户词典
+  std::shared_ptr<const cppjieba::JiebaBase> tokenizer_base =
+    cppjieba::JiebaBase::Get(tokenizer_dict_default + "/jieba.dict.utf8",
+                             tokenizer_dict_default + "/hmm_model.utf8",
+                             tokenizer_dict_default + "/idf.utf8",
+                             tokenizer_dict_default + "/stop_words.utf8");
+  cppjieba::Jieba* tokenizer = new cppjieba::Jieba(tokenizer_base, customdictfile);
+
+  // 在词表目录输出预编译的二进制词典，加载机器人时免去解析文本
+  if(!tokenizer_base->Save(dictdir + "/" + cppjieba::JIEBA_BINARY_FILE,
+                           dictdir + "/jieba.dict.utf8",
+                           dictdir + "/hmm_model.utf8")) {
+    VLOG(2) << __func__ << " fail to save binary dict into " << dictdir;
+  }
   VLOG(3) << __func__ << " init tokenizer done.";
 
   // 保存到tokenizers
@@ -452,12 +467,50 @@ void Trainer::train(const string payload) {
   }
 
   /**
-   * dump dictwords to HAT-Trie data
+   * 线性分类器，特征来自与索引相同的分词结果
+   */
+  {
+    vector<string> labels;
+    map<string, uint32_t> labelIndexes;
+    vector<classifier::LinearSample> samples;
+
+    for(const Augmented::IntentTrainingSample& its : augmented.itss()) {
+      for(const Augmented::Sample& sample : its.tss()) {
+        if(labelIndexes.find(sample.intent_name()) == labelIndexes.end()) {
+          labelIndexes[sample.intent_name()] = labels.size();
+          labels.push_back(sample.intent_name());
+        }
+
+        vector<string> terms(sample.terms().begin(), sample.terms().end());
+        classifier::LinearSample ls;
+        ls.first = labelIndexes[sample.intent_name()];
+        classifier::HashedFeatures(terms, CL_INTENT_LINEAR_BUCKETS, ls.second);
+        samples.push_back(ls);
+      }
+    }
+
+    classifier::LinearModel linear;
+    linear.train(labels, samples, CL_INTENT_LINEAR_BUCKETS);
+
+    if(linear.save(linearfile)) {
+      VLOG(3) << __func__ << " linear classifier is generated at " << linearfile;
+    } else {
+      VLOG(2) << __func__ << " fail to save linear classifier " << linearfile;
+    }
+  }
+
+  /**
+   * dump dictwords to HAT-Trie data, 兼容没有AC自动机的服务
+   * dump dictwords to Aho-Corasick automaton
+   * dump dictwords to membership table
    * dump dictwords to LevelDB
-   * trie: 用于前缀查找
-   * leveldb: 用于验证一个词是否属于某词典
+   * trie, automaton: 用于前缀查找，服务映射自动机文件
+   * membership table: 用于验证一个词是否属于某词典
+   * leveldb: 同上，兼容没有成员表的服务
    */
   const tsl::htrie_map<char, set<string> > dictwords;
+  chatopera::utils::DictwordsAutomatonBuilder dictautomaton;
+  chatopera::utils::MembershipTableBuilder dictmembers;
 
   leveldb::DB* db;
   leveldb::Options options;
@@ -480,6 +533,8 @@ void Trainer::train(const string payload) {
         stringstream ss;
         ss << tdict.name() << '\001' << dictword.word();
         batch.Put(ss.str(), dictword.word());
+        dictautomaton.add(dictword.word(), tdict.name());
+        dictmembers.add(tdict.name(), dictword.word(), dictword.word());
       }
 
       if(!dictword.synonyms().empty()) {
@@ -494,6 +549,8 @@ void Trainer::train(const string payload) {
             stringstream ss;
             ss << tdict.name() << '\001' << word;
             batch.Put(ss.str(), dictword.word());
+            dictautomaton.add(word, tdict.name());
+            dictmembers.add(tdict.name(), word, dictword.word());
           }
         }
       }
@@ -516,6 +573,14 @@ void Trainer::train(const string payload) {
     oa << dictwords;
   }
 
+  // write Aho-Corasick automaton, 加载时直接映射
+  CHECK(dictautomaton.save(dictautomatonfile)) << "fail to dump dictwords automaton " << dictautomatonfile;
+  VLOG(3) << __func__ << " dump " << dictautomaton.size() << " dict words to automaton: " << dictautomatonfile;
+
+  // write membership table
+  CHECK(dictmembers.save(dictmembersfile)) << "fail to dump membership table " << dictmembersfile;
+  VLOG(3) << __func__ << " dump " << dictmembers.size() << " dict words to membership table: " << dictmembersfile;
+
   // write leveldb
   leveldb::WriteOptions write_options;
   write_options.sync = true; // async is much 10x faster then sync, but for safe reason, use sync.
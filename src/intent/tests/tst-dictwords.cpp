@@ -0,0 +1,266 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/intent/tests/tst-dictwords.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-21_15:37:02
+ * @brief
+ * 训练生成的自定义词典AC自动机
+ **/
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include <set>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include "DictwordsAutomaton.hpp"
+
+using namespace std;
+using namespace chatopera::utils;
+
+static const string DICTWORDS_FILE = "/tmp/intent_test.dictwords.bin";
+
+static string readAll(const string& path) {
+  ifstream ifs(path.c_str(), ios::binary);
+  return string((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+}
+
+static void writeAll(const string& path, const string& bytes) {
+  ofstream ofs(path.c_str(), ios::binary | ios::trunc);
+  ofs.write(bytes.data(), bytes.size());
+}
+
+static void setUint32(string& bytes, const size_t& offset, const uint32_t& value) {
+  memcpy(&bytes[offset], &value, sizeof(uint32_t));
+}
+
+TEST(IntentTest, DICTWORDS) {
+  DictwordsAutomatonBuilder builder;
+  builder.add("北京", "city");
+  builder.add("北京", "food");
+  builder.add("北京烤鸭", "food");
+  builder.add("京", "province");
+  builder.add("上海", "city");
+  builder.add("", "city");
+  EXPECT_EQ(builder.size(), (size_t) 4);
+  ASSERT_TRUE(builder.save(DICTWORDS_FILE));
+
+  DictwordsAutomaton dictwords;
+  ASSERT_TRUE(dictwords.open(DICTWORDS_FILE));
+  EXPECT_TRUE(dictwords.isOpen());
+  EXPECT_EQ(dictwords.size(), (size_t) 4);
+
+  // 按begin升序，begin相同时按长度降序
+  vector<DictwordsMatch> matches;
+  const string text = "去北京烤鸭店还是上海";
+  dictwords.match(text, matches);
+  ASSERT_EQ(matches.size(), (size_t) 4);
+  EXPECT_EQ(dictwords.getWord(matches[0].word), "北京烤鸭");
+  EXPECT_EQ(dictwords.getWord(matches[1].word), "北京");
+  EXPECT_EQ(dictwords.getWord(matches[2].word), "京");
+  EXPECT_EQ(dictwords.getWord(matches[3].word), "上海");
+  EXPECT_EQ(text.substr(matches[3].begin, matches[3].end - matches[3].begin), "上海");
+
+  EXPECT_TRUE(dictwords.belongTo(matches[1].word, "city"));
+  EXPECT_TRUE(dictwords.belongTo(matches[1].word, "food"));
+  EXPECT_FALSE(dictwords.belongTo(matches[0].word, "city"));
+  EXPECT_FALSE(dictwords.belongTo(matches[0].word, "unknown"));
+  vector<string> dictnames = dictwords.getDictnames(matches[1].word);
+  ASSERT_EQ(dictnames.size(), (size_t) 2);
+  EXPECT_EQ(dictnames[0], "city");
+  EXPECT_EQ(dictnames[1], "food");
+
+  // 同一位置只看最长的词条
+  string word;
+  EXPECT_TRUE(dictwords.extract(matches, "food", word));
+  EXPECT_EQ(word, "北京烤鸭");
+  EXPECT_TRUE(dictwords.extract(matches, "city", word));
+  EXPECT_EQ(word, "上海");
+  EXPECT_TRUE(dictwords.extract(matches, "province", word));
+  EXPECT_EQ(word, "京");
+  EXPECT_FALSE(dictwords.extract(matches, "unknown", word));
+
+  // 与文件内容相同的内存副本
+  DictwordsAutomaton copied;
+  string bytes;
+  ASSERT_TRUE(builder.save(bytes));
+  EXPECT_EQ(bytes, readAll(DICTWORDS_FILE));
+  ASSERT_TRUE(copied.assign(bytes));
+  vector<DictwordsMatch> copiedMatches;
+  copied.match(text, copiedMatches);
+  EXPECT_EQ(copiedMatches.size(), matches.size());
+
+  dictwords.close();
+  EXPECT_FALSE(dictwords.isOpen());
+  dictwords.match(text, matches);
+  EXPECT_TRUE(matches.empty());
+  remove(DICTWORDS_FILE.c_str());
+}
+
+TEST(IntentTest, DICTWORDS_RANDOM) {
+  srand(20200121);
+
+  for(int round = 0; round < 20; round++) {
+    DictwordsAutomatonBuilder builder;
+    set<string> words;
+
+    for(int i = 0; i < 50; i++) {
+      string word;
+
+      for(int k = rand() % 4; k >= 0; k--) {
+        word.push_back("abc\xe4"[rand() % 4]);
+      }
+
+      words.insert(word);
+      builder.add(word, "dict" + to_string(rand() % 70));
+    }
+
+    string bytes;
+    DictwordsAutomaton dictwords;
+    ASSERT_TRUE(builder.save(bytes));
+    ASSERT_TRUE(dictwords.assign(bytes));
+    ASSERT_EQ(dictwords.size(), words.size());
+
+    for(int t = 0; t < 20; t++) {
+      string text;
+
+      for(int k = rand() % 30; k >= 0; k--) {
+        text.push_back("abcd\xe4"[rand() % 5]);
+      }
+
+      // 逐个位置、逐个长度比较
+      set<pair<size_t, size_t> > expected, actual;
+
+      for(size_t begin = 0; begin < text.size(); begin++) {
+        for(size_t end = begin + 1; end <= text.size(); end++) {
+          if(words.count(text.substr(begin, end - begin)) > 0) {
+            expected.insert(make_pair(begin, end));
+          }
+        }
+      }
+
+      vector<DictwordsMatch> matches;
+      dictwords.match(text, matches);
+
+      for(const DictwordsMatch& m : matches) {
+        EXPECT_EQ(dictwords.getWord(m.word), text.substr(m.begin, m.end - m.begin));
+        actual.insert(make_pair(m.begin, m.end));
+      }
+
+      EXPECT_EQ(actual, expected) << text;
+      EXPECT_EQ(actual.size(), matches.size());
+    }
+  }
+}
+
+TEST(IntentTest, DICTWORDS_EMPTY) {
+  DictwordsAutomatonBuilder builder;
+  ASSERT_TRUE(builder.save(DICTWORDS_FILE));
+
+  DictwordsAutomaton dictwords;
+  ASSERT_TRUE(dictwords.open(DICTWORDS_FILE));
+  EXPECT_EQ(dictwords.size(), (size_t) 0);
+  vector<DictwordsMatch> matches;
+  dictwords.match("北京", matches);
+  EXPECT_TRUE(matches.empty());
+  remove(DICTWORDS_FILE.c_str());
+}
+
+TEST(IntentTest, DICTWORDS_CORRUPTED) {
+  DictwordsAutomatonBuilder builder;
+  builder.add("ab", "x");
+  builder.add("abc", "x");
+  builder.add("bc", "y");
+  builder.add("c", "y");
+  string bytes;
+  ASSERT_TRUE(builder.save(bytes));
+  DictwordsAutomaton dictwords;
+  ASSERT_TRUE(dictwords.assign(bytes));
+
+  // 截断的文件
+  writeAll(DICTWORDS_FILE, bytes.substr(0, bytes.size() - 1));
+  EXPECT_FALSE(dictwords.open(DICTWORDS_FILE));
+  EXPECT_FALSE(dictwords.isOpen());
+  writeAll(DICTWORDS_FILE, bytes.substr(0, 8));
+  EXPECT_FALSE(dictwords.open(DICTWORDS_FILE));
+  remove(DICTWORDS_FILE.c_str());
+
+  // 错误的magic
+  string bad = bytes;
+  bad[0] ^= 0xFF;
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 各段的位置：头部64字节，位图 4 * 1 个uint64_t，根转移256项，
+  // 按层次遍历的状态 0 a b c ab bc abc，边 6 条
+  const size_t N = 7, E = 6, W = 4;
+  const size_t root = 64 + W * 8;
+  const size_t edgeOffsets = root + 256 * 4;
+  const size_t targets = edgeOffsets + (N + 1) * 4;
+  const size_t fails = targets + E * 4;
+  const size_t outputs = fails + N * 4;
+  const size_t outputLinks = outputs + N * 4;
+  const size_t wordOffsets = outputLinks + N * 4;
+  const size_t dictOffsets = wordOffsets + (W + 1) * 4;
+  const size_t labels = dictOffsets + 3 * 4;
+
+  // 中间的边偏移越界，首尾仍然正确
+  bad = bytes;
+  setUint32(bad, edgeOffsets + 4, 1000);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 边指向父状态
+  bad = bytes;
+  setUint32(bad, targets + 4 * 3, 1);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 两条边指向同一个状态
+  bad = bytes;
+  setUint32(bad, targets + 4 * 4, 4);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 失配指针成环
+  bad = bytes;
+  setUint32(bad, fails + 4 * 3, 3);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 输出链指向不是词条结尾的状态
+  bad = bytes;
+  setUint32(bad, outputLinks + 4 * 6, 1);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 词条ID越界
+  bad = bytes;
+  setUint32(bad, outputs + 4 * 2, W);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 词条长度与状态深度不一致
+  bad = bytes;
+  setUint32(bad, wordOffsets + 4 * 1, 1);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 中间的词典名称偏移越界
+  bad = bytes;
+  setUint32(bad, dictOffsets + 4, 1000);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 根转移越界
+  bad = bytes;
+  setUint32(bad, root + 4 * 'a', N);
+  EXPECT_FALSE(dictwords.assign(bad));
+
+  // 同一状态的出边不是升序
+  bad = bytes;
+  bad[labels] = bad[labels + 1];
+  EXPECT_FALSE(dictwords.assign(bad));
+}
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,131 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/intent/tests/tst-members.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-22_16:08:41
+ * @brief
+ * 训练生成的词典成员表
+ **/
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include <string>
+#include <fstream>
+#include <stdio.h>
+#include "MembershipTable.hpp"
+
+using namespace std;
+using namespace chatopera::utils;
+
+static const string MEMBERS_FILE = "/tmp/intent_test.members.bin";
+
+static string readAll(const string& path) {
+  ifstream ifs(path.c_str(), ios::binary);
+  return string((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+}
+
+static void writeAll(const string& path, const string& bytes) {
+  ofstream ofs(path.c_str(), ios::binary | ios::trunc);
+  ofs.write(bytes.data(), bytes.size());
+}
+
+TEST(IntentTest, MEMBERS) {
+  MembershipTableBuilder builder;
+  builder.add("city", "北京", "北京");
+  builder.add("city", "帝都", "北京");
+  builder.add("city", "上海", "上海");
+  builder.add("food", "北京", "北京烤鸭");
+  builder.add("city", "上海", "魔都"); // 后加入的覆盖先加入的
+  EXPECT_EQ(builder.size(), (size_t) 4);
+  ASSERT_TRUE(builder.save(MEMBERS_FILE));
+
+  MembershipTable members;
+  ASSERT_TRUE(members.open(MEMBERS_FILE));
+  EXPECT_TRUE(members.isOpen());
+  EXPECT_EQ(members.size(), (size_t) 4);
+
+  EXPECT_TRUE(members.contains("city", "北京"));
+  EXPECT_TRUE(members.contains("city", "帝都"));
+  EXPECT_TRUE(members.contains("food", "北京"));
+  EXPECT_FALSE(members.contains("food", "帝都"));
+  EXPECT_FALSE(members.contains("city", "广州"));
+  EXPECT_FALSE(members.contains("cit", "y\001北京"));
+
+  string canonical;
+  EXPECT_TRUE(members.find("city", "帝都", canonical));
+  EXPECT_EQ(canonical, "北京");
+  EXPECT_TRUE(members.find("city", "上海", canonical));
+  EXPECT_EQ(canonical, "魔都");
+  EXPECT_TRUE(members.find("food", "北京", canonical));
+  EXPECT_EQ(canonical, "北京烤鸭");
+  EXPECT_FALSE(members.find("food", "上海", canonical));
+
+  members.close();
+  EXPECT_FALSE(members.isOpen());
+  EXPECT_FALSE(members.contains("city", "北京"));
+  remove(MEMBERS_FILE.c_str());
+}
+
+TEST(IntentTest, MEMBERS_EMPTY) {
+  MembershipTableBuilder builder;
+  ASSERT_TRUE(builder.save(MEMBERS_FILE));
+
+  MembershipTable members;
+  ASSERT_TRUE(members.open(MEMBERS_FILE));
+  EXPECT_EQ(members.size(), (size_t) 0);
+  EXPECT_FALSE(members.contains("city", "北京"));
+  remove(MEMBERS_FILE.c_str());
+}
+
+TEST(IntentTest, MEMBERS_CORRUPTED) {
+  MembershipTableBuilder builder;
+  builder.add("city", "北京", "北京");
+  builder.add("city", "上海", "上海");
+  ASSERT_TRUE(builder.save(MEMBERS_FILE));
+  const string bytes = readAll(MEMBERS_FILE);
+  MembershipTable members;
+
+  // 截断的文件
+  writeAll(MEMBERS_FILE, bytes.substr(0, bytes.size() - 1));
+  EXPECT_FALSE(members.open(MEMBERS_FILE));
+  EXPECT_FALSE(members.isOpen());
+
+  writeAll(MEMBERS_FILE, bytes.substr(0, 8));
+  EXPECT_FALSE(members.open(MEMBERS_FILE));
+
+  // 错误的magic
+  string bad = bytes;
+  bad[0] ^= 0xFF;
+  writeAll(MEMBERS_FILE, bad);
+  EXPECT_FALSE(members.open(MEMBERS_FILE));
+  EXPECT_FALSE(members.contains("city", "北京"));
+
+  // 没有空槽的表，查找不到时也会结束
+  MembershipTable::Slot full;
+  full.hash = 0;
+  full.key = 0;
+  full.value = 0;
+  string pool(sizeof(uint32_t), '\0');
+  string table;
+  table.append(bytes.data(), 4 + 4);                        // magic, format
+  uint64_t slots = 2, entries = 1, poolSize = pool.size();
+  table.append(reinterpret_cast<const char*>(&slots), sizeof(slots));
+  table.append(reinterpret_cast<const char*>(&entries), sizeof(entries));
+  table.append(reinterpret_cast<const char*>(&poolSize), sizeof(poolSize));
+  table.append(reinterpret_cast<const char*>(&full), sizeof(full));
+  table.append(reinterpret_cast<const char*>(&full), sizeof(full));
+  table.append(pool);
+  writeAll(MEMBERS_FILE, table);
+  ASSERT_TRUE(members.open(MEMBERS_FILE));
+  EXPECT_FALSE(members.contains("city", "广州"));
+  remove(MEMBERS_FILE.c_str());
+}
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -10,10 +10,12 @@
 #include <stdint.h>
 #include <cmath>
 #include <limits>
+#include <memory>
 #include "glog/logging.h"
 #include "StringUtils.hpp"
 #include "Unicode.hpp"
 #include "Trie.hpp"
+#include "MmapFile.hpp"
 
 namespace cppjieba {
 
@@ -36,10 +38,96 @@ class DictTrie {
     Init(dict_path, user_dict_paths, user_word_weight_opt);
   }
 
+  /**
+   * 叠加在共享的基础词典之上，只加载用户词典。
+   * 用户词的权重按基础词典计算，与把两者放进同一个词典的结果一致。
+   */
+  DictTrie(const std::shared_ptr<const DictTrie>& base, const string& user_dict_paths = "")
+    : base_(base) {
+    InitOverlay(user_dict_paths);
+  }
+
   ~DictTrie() {
     delete trie_;
   }
 
+  /**
+   * 从二进制文件恢复完整词典，内容由Save写出；格式不对时返回NULL
+   */
+  static DictTrie* Load(chatopera::utils::MmapReader& reader,
+                        UserWordWeightOption user_word_weight_opt = WordWeightMedian) {
+    DictTrie* dict = new DictTrie();
+
+    if (!dict->LoadBinary(reader, user_word_weight_opt)) {
+      delete dict;
+      return NULL;
+    }
+
+    return dict;
+  }
+
+  /**
+   * 写出词条表、权重统计和前缀树。只支持完整词典，
+   * 叠加层和运行时插入过用户词的词典返回false
+   */
+  bool Save(ostream& os) const {
+    if (base_ || !active_node_infos_.empty()) {
+      return false;
+    }
+
+    uint32_t unitCount = static_node_infos_.size();
+    vector<uint32_t> wordOffsets(unitCount + 1, 0);
+    vector<Rune> runes;
+    vector<double> weights(unitCount);
+    vector<uint32_t> tagIds(unitCount);
+    vector<string> tags;
+    unordered_map<string, uint32_t> tagIndex;
+
+    for (uint32_t i = 0; i < unitCount; i++) {
+      const DictUnit& unit = static_node_infos_[i];
+      runes.insert(runes.end(), unit.word.begin(), unit.word.end());
+      wordOffsets[i + 1] = runes.size();
+      weights[i] = unit.weight;
+
+      unordered_map<string, uint32_t>::const_iterator it = tagIndex.find(unit.tag);
+
+      if (it == tagIndex.end()) {
+        it = tagIndex.insert(make_pair(unit.tag, uint32_t(tags.size()))).first;
+        tags.push_back(unit.tag);
+      }
+
+      tagIds[i] = it->second;
+    }
+
+    chatopera::utils::writeBinary(os, freq_sum_);
+    chatopera::utils::writeBinary(os, min_weight_);
+    chatopera::utils::writeBinary(os, max_weight_);
+    chatopera::utils::writeBinary(os, median_weight_);
+    chatopera::utils::writeBinary(os, unitCount);
+    chatopera::utils::writeBinary(os, wordOffsets.data(), unitCount + 1);
+    uint32_t runeCount = runes.size();
+    chatopera::utils::writeBinary(os, runeCount);
+    chatopera::utils::writeBinary(os, runes.data(), runeCount);
+    chatopera::utils::writeBinary(os, weights.data(), unitCount);
+    chatopera::utils::writeBinary(os, tagIds.data(), unitCount);
+
+    uint32_t tagCount = tags.size();
+    chatopera::utils::writeBinary(os, tagCount);
+
+    for (uint32_t i = 0; i < tagCount; i++) {
+      uint32_t len = tags[i].size();
+      chatopera::utils::writeBinary(os, len);
+      chatopera::utils::writeBinary(os, tags[i].data(), len);
+    }
+
+    vector<Rune> singles(user_dict_single_chinese_word_.begin(), user_dict_single_chinese_word_.end());
+    uint32_t singleCount = singles.size();
+    chatopera::utils::writeBinary(os, singleCount);
+    chatopera::utils::writeBinary(os, singles.data(), singleCount);
+
+    return trie_->Save(os, static_node_infos_.data(), unitCount) && os.good();
+  }
+
   bool InsertUserWord(const string& word, const string& tag = UNKNOWN_TAG) {
     DictUnit node_info;
 
@@ -66,14 +154,25 @@ class DictTrie {
   }
 
   const DictUnit* Find(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
-    return trie_->Find(begin, end);
+    const DictUnit* unit = trie_->Find(begin, end);
+
+    if (unit == NULL && base_) {
+      unit = base_->Find(begin, end);
+    }
+
+    return unit;
   }
 
   void Find(RuneStrArray::const_iterator begin,
             RuneStrArray::const_iterator end,
             vector<struct Dag>&res,
             size_t max_word_len = MAX_WORD_LENGTH) const {
-    trie_->Find(begin, end, res, max_word_len);
+    if (base_) {
+      base_->Find(begin, end, res, max_word_len);
+      trie_->Merge(begin, end, res, max_word_len);
+    } else {
+      trie_->Find(begin, end, res, max_word_len);
+    }
   }
 
   bool Find(const string& word) {
@@ -94,13 +193,20 @@ class DictTrie {
   }
 
   bool IsUserDictSingleChineseWord(const Rune& word) const {
-    return IsIn(user_dict_single_chinese_word_, word);
+    return IsIn(user_dict_single_chinese_word_, word)
+           || (base_ && base_->IsUserDictSingleChineseWord(word));
   }
 
   double GetMinWeight() const {
     return min_weight_;
   }
 
+  /** 本词典自身占用的堆内存字节数，不含共享的基础词典 */
+  size_t MemoryUsage() const {
+    return trie_->MemoryUsage()
+           + (static_node_infos_.capacity() + active_node_infos_.size()) * sizeof(DictUnit);
+  }
+
   void InserUserDictNode(const string& line) {
     vector<string> buf;
     DictUnit node_info;
@@ -179,8 +285,96 @@ class DictTrie {
     CreateTrie(static_node_infos_);
   }
 
+  DictTrie()
+    : trie_(NULL) {
+  }
+
+  bool LoadBinary(chatopera::utils::MmapReader& reader, UserWordWeightOption user_word_weight_opt) {
+    uint32_t unitCount = 0, runeCount = 0, tagCount = 0, singleCount = 0;
+
+    if (!reader.read(freq_sum_) || !reader.read(min_weight_)
+        || !reader.read(max_weight_) || !reader.read(median_weight_)
+        || !reader.read(unitCount) || unitCount == 0) {
+      return false;
+    }
+
+    vector<uint32_t> wordOffsets(unitCount + 1);
+    vector<double> weights(unitCount);
+    vector<uint32_t> tagIds(unitCount);
+
+    if (!reader.read(wordOffsets.data(), unitCount + 1) || !reader.read(runeCount)) {
+      return false;
+    }
+
+    vector<Rune> runes(runeCount);
+
+    if (!reader.read(runes.data(), runeCount)
+        || !reader.read(weights.data(), unitCount)
+        || !reader.read(tagIds.data(), unitCount)
+        || !reader.read(tagCount)) {
+      return false;
+    }
+
+    vector<string> tags(tagCount);
+
+    for (uint32_t i = 0; i < tagCount; i++) {
+      uint32_t len = 0;
+      const char* p = NULL;
+
+      if (!reader.read(len) || (p = reader.skip(len)) == NULL) {
+        return false;
+      }
+
+      tags[i].assign(p, len);
+    }
+
+    static_node_infos_.resize(unitCount);
+
+    for (uint32_t i = 0; i < unitCount; i++) {
+      if (wordOffsets[i] > wordOffsets[i + 1] || wordOffsets[i + 1] > runeCount || tagIds[i] >= tagCount) {
+        return false;
+      }
+
+      DictUnit& unit = static_node_infos_[i];
+      unit.word = Unicode(runes.data() + wordOffsets[i], runes.data() + wordOffsets[i + 1]);
+      unit.weight = weights[i];
+      unit.tag = tags[tagIds[i]];
+    }
+
+    if (!reader.read(singleCount)) {
+      return false;
+    }
+
+    vector<Rune> singles(singleCount);
+
+    if (!reader.read(singles.data(), singleCount)) {
+      return false;
+    }
+
+    user_dict_single_chinese_word_.insert(singles.begin(), singles.end());
+    SetUserWordDefaultWeight(user_word_weight_opt);
+
+    trie_ = new Trie();
+    return trie_->Load(reader, static_node_infos_.data(), unitCount);
+  }
+
+  void InitOverlay(const string& user_dict_paths) {
+    freq_sum_ = base_->freq_sum_;
+    min_weight_ = base_->min_weight_;
+    max_weight_ = base_->max_weight_;
+    median_weight_ = base_->median_weight_;
+    user_word_default_weight_ = base_->user_word_default_weight_;
+
+    if (user_dict_paths.size()) {
+      LoadUserDict(user_dict_paths);
+    }
+
+    Shrink(static_node_infos_);
+    CreateTrie(static_node_infos_);
+  }
+
   void CreateTrie(const vector<DictUnit>& dictUnits) {
-    assert(dictUnits.size());
+    assert(base_ || dictUnits.size());
     vector<Unicode> words;
     vector<const DictUnit*> valuePointers;
 
@@ -239,7 +433,10 @@ class DictTrie {
     min_weight_ = x[0].weight;
     max_weight_ = x[x.size() - 1].weight;
     median_weight_ = x[x.size() / 2].weight;
+    SetUserWordDefaultWeight(option);
+  }
 
+  void SetUserWordDefaultWeight(UserWordWeightOption option) {
     switch (option) {
       case WordWeightMin:
         user_word_default_weight_ = min_weight_;
@@ -279,6 +476,7 @@ class DictTrie {
     vector<DictUnit>(units.begin(), units.end()).swap(units);
   }
 
+  std::shared_ptr<const DictTrie> base_; // 共享的基础词典，为空时本身即完整词典
   vector<DictUnit> static_node_infos_;
   deque<DictUnit> active_node_infos_; // must not be vector
   Trie * trie_;
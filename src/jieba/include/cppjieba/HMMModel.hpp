@@ -18,6 +18,77 @@ struct HMMModel {
   enum {B = 0, E = 1, M = 2, S = 3, STATUS_SUM = 4};
 
   HMMModel(const string& modelPath) {
+    Init();
+    LoadModel(modelPath);
+  }
+  ~HMMModel() {
+  }
+
+  /**
+   * 从二进制文件恢复，内容由Save写出；格式不对时返回NULL
+   */
+  static HMMModel* Load(chatopera::utils::MmapReader& reader) {
+    HMMModel* model = new HMMModel();
+
+    if (!reader.read(&model->startProb[0], STATUS_SUM)
+        || !reader.read(&model->transProb[0][0], STATUS_SUM * STATUS_SUM)) {
+      delete model;
+      return NULL;
+    }
+
+    for (size_t i = 0; i < model->emitProbVec.size(); i++) {
+      uint32_t count = 0;
+
+      if (!reader.read(count)) {
+        delete model;
+        return NULL;
+      }
+
+      vector<Rune> runes(count);
+      vector<double> probs(count);
+
+      if (!reader.read(runes.data(), count) || !reader.read(probs.data(), count)) {
+        delete model;
+        return NULL;
+      }
+
+      EmitProbMap& mp = *model->emitProbVec[i];
+      mp.reserve(count);
+
+      for (uint32_t k = 0; k < count; k++) {
+        mp[runes[k]] = probs[k];
+      }
+    }
+
+    return model;
+  }
+
+  bool Save(ostream& os) const {
+    chatopera::utils::writeBinary(os, &startProb[0], STATUS_SUM);
+    chatopera::utils::writeBinary(os, &transProb[0][0], STATUS_SUM * STATUS_SUM);
+
+    for (size_t i = 0; i < emitProbVec.size(); i++) {
+      const EmitProbMap& mp = *emitProbVec[i];
+      vector<Rune> runes;
+      vector<double> probs;
+      runes.reserve(mp.size());
+      probs.reserve(mp.size());
+
+      for (EmitProbMap::const_iterator it = mp.begin(); it != mp.end(); ++it) {
+        runes.push_back(it->first);
+        probs.push_back(it->second);
+      }
+
+      uint32_t count = runes.size();
+      chatopera::utils::writeBinary(os, count);
+      chatopera::utils::writeBinary(os, runes.data(), count);
+      chatopera::utils::writeBinary(os, probs.data(), count);
+    }
+
+    return os.good();
+  }
+
+  void Init() {
     memset(startProb, 0, sizeof(startProb));
     memset(transProb, 0, sizeof(transProb));
     statMap[0] = 'B';
@@ -28,9 +99,6 @@ struct HMMModel {
     emitProbVec.push_back(&emitProbE);
     emitProbVec.push_back(&emitProbM);
     emitProbVec.push_back(&emitProbS);
-    LoadModel(modelPath);
-  }
-  ~HMMModel() {
   }
   void LoadModel(const string& filePath) {
     ifstream ifile(filePath.c_str());
@@ -137,6 +205,13 @@ struct HMMModel {
   EmitProbMap emitProbM;
   EmitProbMap emitProbS;
   vector<EmitProbMap* > emitProbVec;
+
+ private:
+  HMMModel() {
+    Init();
+  }
+  HMMModel(const HMMModel&);
+  HMMModel& operator=(const HMMModel&);
 }; // struct HMMModel
 
 } // namespace cppjieba
@@ -1,11 +1,244 @@
 #ifndef CPPJIEAB_JIEBA_H
 #define CPPJIEAB_JIEBA_H
 
+#include <map>
+#include <mutex>
 #include "QuerySegment.hpp"
 #include "KeywordExtractor.hpp"
 
 namespace cppjieba {
 
+const char JIEBA_BINARY_MAGIC[8] = {'C', 'L', 'J', 'I', 'E', 'B', 'A', '2'};
+const char* const JIEBA_BINARY_FILE = "jieba.bin";
+
+/**
+ * 不含用户词的基础词典、HMM模型和关键词表，只读。
+ * 同一份文件在进程内只加载一次，由所有引用它的Jieba共享，
+ * 最后一个引用释放时回收。
+ */
+class JiebaBase {
+ public:
+  /**
+   * binary_path非空且与文本词典匹配时，从预编译的二进制文件加载词典和HMM模型，
+   * 否则解析文本文件
+   */
+  JiebaBase(const string& dict_path,
+            const string& model_path,
+            const string& idfPath,
+            const string& stopWordPath,
+            const string& binary_path = "")
+    : keyword_dict(new KeywordDict(idfPath, stopWordPath)) {
+    if (binary_path.empty() || !LoadBinary(binary_path, dict_path, model_path)) {
+      dict_trie.reset(new DictTrie(dict_path));
+      model.reset(new HMMModel(model_path));
+    }
+  }
+
+  /**
+   * 按文件内容获取共享的基础词典，尚未加载或已被回收时重新加载。
+   * 各个版本目录下内容相同的拷贝共用一份。
+   * 文件的路径、大小和修改时间未变时沿用上次算出的内容校验和，只在未见过时读取文件
+   */
+  static std::shared_ptr<const JiebaBase> Get(const string& dict_path,
+                                              const string& model_path,
+                                              const string& idfPath,
+                                              const string& stopWordPath,
+                                              const string& binary_path = "") {
+    static std::mutex lock;
+    static std::map<string, std::weak_ptr<const JiebaBase> > cache;  // 内容 -> 基础词典
+    static std::map<string, string> fingerprints;                    // 文件状态 -> 内容
+
+    const string stat = StatKey(dict_path) + "|" + StatKey(model_path) + "|"
+                        + StatKey(idfPath) + "|" + StatKey(stopWordPath) + "|"
+                        + StatKey(binary_path);
+    string key;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      std::map<string, string>::const_iterator it = fingerprints.find(stat);
+
+      if (it != fingerprints.end()) {
+        key = it->second;
+      }
+    }
+
+    if (key.empty()) {
+      key = Fingerprint(dict_path) + "|" + Fingerprint(model_path) + "|"
+            + Fingerprint(idfPath) + "|" + Fingerprint(stopWordPath) + "|"
+            + BinaryFingerprint(binary_path);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::shared_ptr<const JiebaBase> base = cache[key].lock();
+
+    if (!base) {
+      Prune(cache, fingerprints);
+      base = std::make_shared<const JiebaBase>(dict_path, model_path, idfPath, stopWordPath, binary_path);
+      cache[key] = base;
+    }
+
+    fingerprints[stat] = key;
+    return base;
+  }
+
+  /**
+   * 把词典和HMM模型写成二进制文件，记录文本文件的大小和校验和，加载时据此判断是否过期。
+   * 先写临时文件再改名，加载方不会读到写了一半的文件
+   */
+  bool Save(const string& binary_path,
+            const string& dict_path,
+            const string& model_path) const {
+    const string tmp_path = binary_path + ".tmp";
+    {
+      ofstream ofs(tmp_path.c_str(), ios::binary | ios::trunc);
+
+      if (!ofs.is_open()) {
+        return false;
+      }
+
+      BinaryHeader header;
+      memcpy(header.magic, JIEBA_BINARY_MAGIC, sizeof(header.magic));
+      header.dict_size = chatopera::utils::fileSize(dict_path);
+      header.dict_checksum = chatopera::utils::fileChecksum(dict_path);
+      header.model_size = chatopera::utils::fileSize(model_path);
+      header.model_checksum = chatopera::utils::fileChecksum(model_path);
+      chatopera::utils::writeBinary(ofs, header);
+
+      if (!dict_trie->Save(ofs) || !model->Save(ofs)) {
+        ofs.close();
+        remove(tmp_path.c_str());
+        return false;
+      }
+    }
+
+    return rename(tmp_path.c_str(), binary_path.c_str()) == 0;
+  }
+
+  std::shared_ptr<const DictTrie> dict_trie;
+  std::shared_ptr<const HMMModel> model;
+  std::shared_ptr<const KeywordDict> keyword_dict;
+
+ private:
+  struct BinaryHeader {
+    char magic[sizeof(JIEBA_BINARY_MAGIC)];
+    int64_t dict_size;                 // 编译时文本词典的大小和校验和
+    uint64_t dict_checksum;
+    int64_t model_size;                // 编译时HMM模型的大小和校验和
+    uint64_t model_checksum;
+  };
+
+  static bool ReadHeader(chatopera::utils::MmapReader& reader, BinaryHeader& header) {
+    return reader.read(header) && memcmp(header.magic, JIEBA_BINARY_MAGIC, sizeof(header.magic)) == 0;
+  }
+
+  /**
+   * 二进制文件编译自哪份文本，未指定或格式不对时为空。
+   * 同样的文本，经由二进制文件加载和直接解析的缓存分开
+   */
+  static string BinaryFingerprint(const string& binary_path) {
+    chatopera::utils::MmapFile file;
+    BinaryHeader header;
+
+    if (binary_path.empty() || !file.open(binary_path)) {
+      return "";
+    }
+
+    chatopera::utils::MmapReader reader(file);
+
+    if (!ReadHeader(reader, header)) {
+      return "";
+    }
+
+    return std::to_string(header.dict_size) + ":" + std::to_string(header.dict_checksum) + ":"
+           + std::to_string(header.model_size) + ":" + std::to_string(header.model_checksum);
+  }
+
+  /** 路径、文件大小和修改时间 */
+  static string StatKey(const string& path) {
+    return path + ":" + std::to_string(chatopera::utils::fileSize(path)) + ":"
+           + std::to_string(chatopera::utils::fileModified(path));
+  }
+
+  /** 移除已被回收的基础词典，以及指向它们的文件状态 */
+  static void Prune(std::map<string, std::weak_ptr<const JiebaBase> >& cache,
+                    std::map<string, string>& fingerprints) {
+    for (std::map<string, std::weak_ptr<const JiebaBase> >::iterator it = cache.begin(); it != cache.end();) {
+      if (it->second.expired()) {
+        cache.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+
+    for (std::map<string, string>::iterator it = fingerprints.begin(); it != fingerprints.end();) {
+      if (cache.find(it->second) == cache.end()) {
+        fingerprints.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  /** 文件大小和内容校验和，文件不存在时按路径区分 */
+  static string Fingerprint(const string& path) {
+    long long size = chatopera::utils::fileSize(path);
+
+    if (size < 0) {
+      return path;
+    }
+
+    return std::to_string(size) + ":" + std::to_string(chatopera::utils::fileChecksum(path));
+  }
+
+  bool LoadBinary(const string& binary_path,
+                  const string& dict_path,
+                  const string& model_path) {
+    chatopera::utils::MmapFile file;
+
+    if (!file.open(binary_path)) {
+      return false;
+    }
+
+    chatopera::utils::MmapReader reader(file);
+    BinaryHeader header;
+
+    if (!ReadHeader(reader, header)) {
+      VLOG(2) << "illegal binary dict " << binary_path;
+      return false;
+    }
+
+    // 文本文件缺失或内容与编译时不同，二进制文件都不可信，按过期处理
+    if (!MatchText(dict_path, header.dict_size, header.dict_checksum)
+        || !MatchText(model_path, header.model_size, header.model_checksum)) {
+      VLOG(2) << "stale binary dict " << binary_path;
+      return false;
+    }
+
+    DictTrie* dict = DictTrie::Load(reader);
+    HMMModel* hmm = dict == NULL ? NULL : HMMModel::Load(reader);
+
+    if (hmm == NULL) {
+      VLOG(2) << "corrupted binary dict " << binary_path;
+      delete dict;
+      return false;
+    }
+
+    dict_trie.reset(dict);
+    model.reset(hmm);
+    return true;
+  }
+
+  static bool MatchText(const string& path, const int64_t& size, const uint64_t& checksum) {
+    long long current = chatopera::utils::fileSize(path);
+
+    if (current < 0) {
+      VLOG(2) << "missing text dict " << path;
+      return false;
+    }
+
+    return current == size && chatopera::utils::fileChecksum(path) == checksum;
+  }
+}; // class JiebaBase
+
 class Jieba {
  public:
   Jieba(const string& dict_path, 
@@ -14,13 +247,27 @@ class Jieba {
         const string& idfPath, 
         const string& stopWordPath) 
     : dict_trie_(dict_path, user_dict_path),
-      model_(model_path),
+      model_(new HMMModel(model_path)),
+      mp_seg_(&dict_trie_),
+      hmm_seg_(model_.get()),
+      mix_seg_(&dict_trie_, model_.get()),
+      full_seg_(&dict_trie_),
+      query_seg_(&dict_trie_, model_.get()),
+      extractor(&dict_trie_, model_.get(), idfPath, stopWordPath) {
+  }
+  /**
+   * 基于共享的基础词典，本身只保存用户词典
+   */
+  Jieba(const std::shared_ptr<const JiebaBase>& base,
+        const string& user_dict_path)
+    : dict_trie_(base->dict_trie, user_dict_path),
+      model_(base->model),
       mp_seg_(&dict_trie_),
-      hmm_seg_(&model_),
-      mix_seg_(&dict_trie_, &model_),
+      hmm_seg_(model_.get()),
+      mix_seg_(&dict_trie_, model_.get()),
       full_seg_(&dict_trie_),
-      query_seg_(&dict_trie_, &model_),
-      extractor(&dict_trie_, &model_, idfPath, stopWordPath) {
+      query_seg_(&dict_trie_, model_.get()),
+      extractor(&dict_trie_, model_.get(), base->keyword_dict) {
   }
   ~Jieba() {
   }
@@ -95,7 +342,7 @@ class Jieba {
   } 
   
   const HMMModel* GetHMMModel() const {
-    return &model_;
+    return model_.get();
   }
 
   void LoadUserDict(const vector<string>& buf)  {
@@ -112,7 +359,7 @@ class Jieba {
 
  private:
   DictTrie dict_trie_;
-  HMMModel model_;
+  std::shared_ptr<const HMMModel> model_;
   
   // They share the same dict trie and model
   MPSegment mp_seg_;
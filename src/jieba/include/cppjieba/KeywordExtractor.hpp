@@ -3,6 +3,7 @@
 
 #include <cmath>
 #include <set>
+#include <memory>
 #include "glog/logging.h"
 #include "MixSegment.hpp"
 
@@ -11,6 +12,66 @@ namespace cppjieba {
 using namespace limonp;
 using namespace std;
 
+/**
+ * 关键词提取用的IDF和停用词表，只读，可在多个KeywordExtractor间共享
+ */
+struct KeywordDict {
+  KeywordDict(const string& idfPath, const string& stopWordPath) {
+    LoadIdfDict(idfPath);
+    LoadStopWordDict(stopWordPath);
+  }
+
+  void LoadIdfDict(const string& idfPath) {
+    ifstream ifs(idfPath.c_str());
+    CHECK(ifs.is_open()) << "open " << idfPath << " failed";
+    string line ;
+    vector<string> buf;
+    double idf = 0.0;
+    double idfSum = 0.0;
+    size_t lineno = 0;
+
+    for (; getline(ifs, line); lineno++) {
+      buf.clear();
+
+      if (line.empty()) {
+        VLOG(2) << "lineno: " << lineno << " empty. skipped.";
+        continue;
+      }
+
+      Split(line, buf, " ");
+
+      if (buf.size() != 2) {
+        VLOG(2) << "line: " << line << ", lineno: " << lineno << " empty. skipped.";
+        continue;
+      }
+
+      idf = atof(buf[1].c_str());
+      idfMap[buf[0]] = idf;
+      idfSum += idf;
+
+    }
+
+    assert(lineno);
+    idfAverage = idfSum / lineno;
+    assert(idfAverage > 0.0);
+  }
+  void LoadStopWordDict(const string& filePath) {
+    ifstream ifs(filePath.c_str());
+    CHECK(ifs.is_open()) << "open " << filePath << " failed";
+    string line ;
+
+    while (getline(ifs, line)) {
+      stopWords.insert(line);
+    }
+
+    assert(stopWords.size());
+  }
+
+  unordered_map<string, double> idfMap;
+  double idfAverage;
+  unordered_set<string> stopWords;
+}; // struct KeywordDict
+
 /*utf8*/
 class KeywordExtractor {
  public:
@@ -25,17 +86,21 @@ class KeywordExtractor {
                    const string& idfPath,
                    const string& stopWordPath,
                    const string& userDict = "")
-    : segment_(dictPath, hmmFilePath, userDict) {
-    LoadIdfDict(idfPath);
-    LoadStopWordDict(stopWordPath);
+    : segment_(dictPath, hmmFilePath, userDict),
+      dict_(new KeywordDict(idfPath, stopWordPath)) {
   }
   KeywordExtractor(const DictTrie* dictTrie,
                    const HMMModel* model,
                    const string& idfPath,
                    const string& stopWordPath)
-    : segment_(dictTrie, model) {
-    LoadIdfDict(idfPath);
-    LoadStopWordDict(stopWordPath);
+    : segment_(dictTrie, model),
+      dict_(new KeywordDict(idfPath, stopWordPath)) {
+  }
+  KeywordExtractor(const DictTrie* dictTrie,
+                   const HMMModel* model,
+                   const std::shared_ptr<const KeywordDict>& dict)
+    : segment_(dictTrie, model),
+      dict_(dict) {
   }
   ~KeywordExtractor() {
   }
@@ -69,7 +134,7 @@ class KeywordExtractor {
       size_t t = offset;
       offset += words[i].size();
 
-      if (IsSingleWord(words[i]) || stopWords_.find(words[i]) != stopWords_.end()) {
+      if (IsSingleWord(words[i]) || dict_->stopWords.find(words[i]) != dict_->stopWords.end()) {
         continue;
       }
 
@@ -86,12 +151,12 @@ class KeywordExtractor {
     keywords.reserve(wordmap.size());
 
     for (map<string, Word>::iterator itr = wordmap.begin(); itr != wordmap.end(); ++itr) {
-      unordered_map<string, double>::const_iterator cit = idfMap_.find(itr->first);
+      unordered_map<string, double>::const_iterator cit = dict_->idfMap.find(itr->first);
 
-      if (cit != idfMap_.end()) {
+      if (cit != dict_->idfMap.end()) {
         itr->second.weight *= cit->second;
       } else {
-        itr->second.weight *= idfAverage_;
+        itr->second.weight *= dict_->idfAverage;
       }
 
       itr->second.word = itr->first;
@@ -103,61 +168,12 @@ class KeywordExtractor {
     keywords.resize(topN);
   }
  private:
-  void LoadIdfDict(const string& idfPath) {
-    ifstream ifs(idfPath.c_str());
-    CHECK(ifs.is_open()) << "open " << idfPath << " failed";
-    string line ;
-    vector<string> buf;
-    double idf = 0.0;
-    double idfSum = 0.0;
-    size_t lineno = 0;
-
-    for (; getline(ifs, line); lineno++) {
-      buf.clear();
-
-      if (line.empty()) {
-        VLOG(2) << "lineno: " << lineno << " empty. skipped.";
-        continue;
-      }
-
-      Split(line, buf, " ");
-
-      if (buf.size() != 2) {
-        VLOG(2) << "line: " << line << ", lineno: " << lineno << " empty. skipped.";
-        continue;
-      }
-
-      idf = atof(buf[1].c_str());
-      idfMap_[buf[0]] = idf;
-      idfSum += idf;
-
-    }
-
-    assert(lineno);
-    idfAverage_ = idfSum / lineno;
-    assert(idfAverage_ > 0.0);
-  }
-  void LoadStopWordDict(const string& filePath) {
-    ifstream ifs(filePath.c_str());
-    CHECK(ifs.is_open()) << "open " << filePath << " failed";
-    string line ;
-
-    while (getline(ifs, line)) {
-      stopWords_.insert(line);
-    }
-
-    assert(stopWords_.size());
-  }
-
   static bool Compare(const Word& lhs, const Word& rhs) {
     return lhs.weight > rhs.weight;
   }
 
   MixSegment segment_;
-  unordered_map<string, double> idfMap_;
-  double idfAverage_;
-
-  unordered_set<string> stopWords_;
+  std::shared_ptr<const KeywordDict> dict_;
 }; // class KeywordExtractor
 
 inline ostream& operator << (ostream& os, const KeywordExtractor::Word& word) {
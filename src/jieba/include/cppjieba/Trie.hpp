@@ -3,7 +3,11 @@
 
 #include <vector>
 #include <queue>
+#include <algorithm>
+#include <cassert>
+#include <stdint.h>
 #include "StdExtension.hpp"
+#include "MmapFile.hpp"
 #include "Unicode.hpp"
 
 namespace cppjieba {
@@ -11,6 +15,10 @@ namespace cppjieba {
 using namespace std;
 
 const size_t MAX_WORD_LENGTH = 512;
+const uint32_t TRIE_NPOS = 0xFFFFFFFF;
+const uint32_t TRIE_ROOT = 0;
+const uint32_t TRIE_PAGE_BITS = 8;
+const uint32_t TRIE_PAGE_SIZE = 1 << TRIE_PAGE_BITS;
 
 struct DictUnit {
   Unicode word;
@@ -38,24 +46,33 @@ struct Dag {
 
 typedef Rune TrieKey;
 
-class TrieNode {
- public :
-  TrieNode(): next(NULL), ptValue(NULL) {
+/**
+ * 扁平化的前缀树节点，子节点按键有序地连续存放在Trie的数组中，
+ * 位于 [childBegin, childBegin + childCount)
+ */
+struct TrieNode {
+  TrieNode(): childBegin(0), childCount(0), ptValue(NULL) {
   }
- public:
-  typedef unordered_map<TrieKey, TrieNode*> NextMap;
-  NextMap *next;
+  uint32_t childBegin;
+  uint32_t childCount;
   const DictUnit *ptValue;
-};
+}; // struct TrieNode
 
+/**
+ * Sorted-child-array trie. Nodes live in one vector, children of a node are
+ * stored contiguously and sorted by rune, so a lookup is a short scan or a
+ * binary search over a small array instead of a hash map per node.
+ */
 class Trie {
  public:
   Trie(const vector<Unicode>& keys, const vector<const DictUnit*>& valuePointers)
-    : root_(new TrieNode) {
+    : nodes_(1) {
     CreateTrie(keys, valuePointers);
   }
+  Trie()
+    : nodes_(1) {
+  }
   ~Trie() {
-    DeleteNode(root_);
   }
 
   const DictUnit* Find(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end) const {
@@ -63,101 +80,353 @@ class Trie {
       return NULL;
     }
 
-    const TrieNode* ptNode = root_;
-    TrieNode::NextMap::const_iterator citer;
-
-    for (RuneStrArray::const_iterator it = begin; it != end; it++) {
-      if (NULL == ptNode->next) {
-        return NULL;
-      }
-
-      citer = ptNode->next->find(it->rune);
+    uint32_t node = FindRootChild(begin->rune);
 
-      if (ptNode->next->end() == citer) {
-        return NULL;
-      }
+    for (RuneStrArray::const_iterator it = begin + 1; it != end && TRIE_NPOS != node; it++) {
+      node = FindChild(node, it->rune);
+    }
 
-      ptNode = citer->second;
+    if (TRIE_NPOS == node) {
+      return NULL;
     }
 
-    return ptNode->ptValue;
+    return nodes_[node].ptValue;
   }
 
   void Find(RuneStrArray::const_iterator begin,
             RuneStrArray::const_iterator end,
             vector<struct Dag>&res,
             size_t max_word_len = MAX_WORD_LENGTH) const {
-    assert(root_ != NULL);
     res.resize(end - begin);
 
-    const TrieNode *ptNode = NULL;
-    TrieNode::NextMap::const_iterator citer;
+    uint32_t node = TRIE_NPOS;
 
     for (size_t i = 0; i < size_t(end - begin); i++) {
       res[i].runestr = *(begin + i);
+      node = FindRootChild(res[i].runestr.rune);
 
-      if (root_->next != NULL && root_->next->end() != (citer = root_->next->find(res[i].runestr.rune))) {
-        ptNode = citer->second;
-      } else {
-        ptNode = NULL;
-      }
-
-      if (ptNode != NULL) {
-        res[i].nexts.push_back(pair<size_t, const DictUnit*>(i, ptNode->ptValue));
+      if (node != TRIE_NPOS) {
+        res[i].nexts.push_back(pair<size_t, const DictUnit*>(i, nodes_[node].ptValue));
       } else {
         res[i].nexts.push_back(pair<size_t, const DictUnit*>(i, static_cast<const DictUnit*>(NULL)));
       }
 
       for (size_t j = i + 1; j < size_t(end - begin) && (j - i + 1) <= max_word_len; j++) {
-        if (ptNode == NULL || ptNode->next == NULL) {
+        if (node == TRIE_NPOS) {
           break;
         }
 
-        citer = ptNode->next->find((begin + j)->rune);
+        node = FindChild(node, (begin + j)->rune);
 
-        if (ptNode->next->end() == citer) {
+        if (node == TRIE_NPOS) {
           break;
         }
 
-        ptNode = citer->second;
+        if (NULL != nodes_[node].ptValue) {
+          res[i].nexts.push_back(pair<size_t, const DictUnit*>(j, nodes_[node].ptValue));
+        }
+      }
+    }
+  }
+
+  /**
+   * 把本树作为上层覆盖到已有的DAG上：res须是下层词典对同一区间的Find结果，
+   * 本树中的词条按结束位置插入，结束位置相同时替换下层的词条。
+   */
+  void Merge(RuneStrArray::const_iterator begin,
+             RuneStrArray::const_iterator end,
+             vector<struct Dag>&res,
+             size_t max_word_len = MAX_WORD_LENGTH) const {
+    assert(res.size() == size_t(end - begin));
 
-        if (NULL != ptNode->ptValue) {
-          res[i].nexts.push_back(pair<size_t, const DictUnit*>(j, ptNode->ptValue));
+    for (size_t i = 0; i < size_t(end - begin); i++) {
+      uint32_t node = FindRootChild((begin + i)->rune);
+
+      for (size_t j = i; node != TRIE_NPOS; ) {
+        if (NULL != nodes_[node].ptValue) {
+          MergeNext(res[i].nexts, j, nodes_[node].ptValue);
+        }
+
+        if (++j >= size_t(end - begin) || (j - i + 1) > max_word_len) {
+          break;
         }
+
+        node = FindChild(node, (begin + j)->rune);
       }
     }
   }
 
+  /**
+   * 构建后插入新词条（用户词）。缺少子节点时，把该节点的子节点区间整体
+   * 搬到数组末尾并插入新键，旧区间废弃；用户词数量少，浪费可忽略。
+   */
   void InsertNode(const Unicode& key, const DictUnit* ptValue) {
     if (key.begin() == key.end()) {
       return;
     }
 
-    TrieNode::NextMap::const_iterator kmIter;
-    TrieNode *ptNode = root_;
+    uint32_t node = TRIE_ROOT;
 
     for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
-      if (NULL == ptNode->next) {
-        ptNode->next = new TrieNode::NextMap;
+      uint32_t next = FindChild(node, *citer);
+
+      if (TRIE_NPOS == next) {
+        next = AppendChild(node, *citer);
+
+        if (TRIE_ROOT == node) {
+          IndexRootChild(*citer, next);
+        }
       }
 
-      kmIter = ptNode->next->find(*citer);
+      node = next;
+    }
 
-      if (ptNode->next->end() == kmIter) {
-        TrieNode *nextNode = new TrieNode;
+    nodes_[node].ptValue = ptValue;
+  }
 
-        ptNode->next->insert(make_pair(*citer, nextNode));
-        ptNode = nextNode;
-      } else {
-        ptNode = kmIter->second;
+  /**
+   * 写出前缀树，词条以其在units中的下标保存；
+   * 词条不在units中（运行时插入的用户词）时返回false
+   */
+  bool Save(ostream& os, const DictUnit* units, size_t unitCount) const {
+    vector<uint32_t> childBegins(nodes_.size()), childCounts(nodes_.size()), values(nodes_.size());
+
+    for (size_t i = 0; i < nodes_.size(); i++) {
+      childBegins[i] = nodes_[i].childBegin;
+      childCounts[i] = nodes_[i].childCount;
+      values[i] = TRIE_NPOS;
+
+      if (nodes_[i].ptValue != NULL) {
+        if (nodes_[i].ptValue < units || nodes_[i].ptValue >= units + unitCount) {
+          return false;
+        }
+
+        values[i] = nodes_[i].ptValue - units;
       }
     }
 
-    assert(ptNode != NULL);
-    ptNode->ptValue = ptValue;
+    uint32_t nodeCount = nodes_.size();
+    uint32_t childCount = childKeys_.size();
+    chatopera::utils::writeBinary(os, nodeCount);
+    chatopera::utils::writeBinary(os, childBegins.data(), nodeCount);
+    chatopera::utils::writeBinary(os, childCounts.data(), nodeCount);
+    chatopera::utils::writeBinary(os, values.data(), nodeCount);
+    chatopera::utils::writeBinary(os, childCount);
+    chatopera::utils::writeBinary(os, childKeys_.data(), childCount);
+    chatopera::utils::writeBinary(os, childNodes_.data(), childCount);
+    return os.good();
+  }
+
+  /**
+   * 从Save的结果恢复，只做整块拷贝和下标到指针的转换
+   */
+  bool Load(chatopera::utils::MmapReader& reader, const DictUnit* units, size_t unitCount) {
+    uint32_t nodeCount = 0, childCount = 0;
+
+    if (!reader.read(nodeCount) || nodeCount == 0) {
+      return false;
+    }
+
+    const char* childBegins = reader.skip(sizeof(uint32_t) * nodeCount);
+    const char* childCounts = reader.skip(sizeof(uint32_t) * nodeCount);
+    const char* values = reader.skip(sizeof(uint32_t) * nodeCount);
+
+    if (values == NULL || !reader.read(childCount)) {
+      return false;
+    }
+
+    childKeys_.resize(childCount);
+    childNodes_.resize(childCount);
+
+    if (!reader.read(childKeys_.data(), childCount) || !reader.read(childNodes_.data(), childCount)) {
+      return false;
+    }
+
+    nodes_.resize(nodeCount);
+
+    for (uint32_t i = 0; i < nodeCount; i++) {
+      uint32_t value = 0;
+      memcpy(&nodes_[i].childBegin, childBegins + sizeof(uint32_t) * i, sizeof(uint32_t));
+      memcpy(&nodes_[i].childCount, childCounts + sizeof(uint32_t) * i, sizeof(uint32_t));
+      memcpy(&value, values + sizeof(uint32_t) * i, sizeof(uint32_t));
+
+      if (size_t(nodes_[i].childBegin) + nodes_[i].childCount > childCount
+          || (value != TRIE_NPOS && value >= unitCount)) {
+        return false;
+      }
+
+      nodes_[i].ptValue = value == TRIE_NPOS ? NULL : units + value;
+    }
+
+    for (uint32_t i = 0; i < childCount; i++) {
+      if (childNodes_[i] >= nodeCount) {
+        return false;
+      }
+    }
+
+    rootPages_.clear();
+    rootSlots_.clear();
+    BuildRootIndex();
+    return true;
+  }
+
+  size_t NodeCount() const {
+    return nodes_.size();
+  }
+
+  /** 占用的堆内存字节数（不含DictUnit） */
+  size_t MemoryUsage() const {
+    return nodes_.capacity() * sizeof(TrieNode)
+           + childKeys_.capacity() * sizeof(TrieKey)
+           + childNodes_.capacity() * sizeof(uint32_t)
+           + rootPages_.capacity() * sizeof(uint32_t)
+           + rootSlots_.capacity() * sizeof(uint32_t);
   }
 
  private:
+  /**
+   * 根节点的子节点最多(常用汉字数千个)，每个位置的DAG都从这里开始，
+   * 用按页分配的直接索引代替二分查找
+   */
+  uint32_t FindRootChild(TrieKey key) const {
+    uint32_t page = key >> TRIE_PAGE_BITS;
+
+    if (page >= rootPages_.size() || rootPages_[page] == TRIE_NPOS) {
+      return TRIE_NPOS;
+    }
+
+    return rootSlots_[rootPages_[page] + (key & (TRIE_PAGE_SIZE - 1))];
+  }
+
+  void IndexRootChild(TrieKey key, uint32_t child) {
+    uint32_t page = key >> TRIE_PAGE_BITS;
+
+    if (page >= rootPages_.size()) {
+      rootPages_.resize(page + 1, TRIE_NPOS);
+    }
+
+    if (rootPages_[page] == TRIE_NPOS) {
+      rootPages_[page] = rootSlots_.size();
+      rootSlots_.resize(rootSlots_.size() + TRIE_PAGE_SIZE, TRIE_NPOS);
+    }
+
+    rootSlots_[rootPages_[page] + (key & (TRIE_PAGE_SIZE - 1))] = child;
+  }
+
+  void BuildRootIndex() {
+    const TrieNode& root = nodes_[TRIE_ROOT];
+
+    for (uint32_t i = root.childBegin; i < root.childBegin + root.childCount; i++) {
+      IndexRootChild(childKeys_[i], childNodes_[i]);
+    }
+
+    rootPages_.shrink_to_fit();
+    rootSlots_.shrink_to_fit();
+  }
+
+  uint32_t FindChild(uint32_t node, TrieKey key) const {
+    const TrieNode& n = nodes_[node];
+
+    if (n.childCount == 0) {
+      return TRIE_NPOS;
+    }
+
+    const TrieKey* first = childKeys_.data() + n.childBegin;
+    const TrieKey* last = first + n.childCount;
+
+    if (n.childCount <= 8) {
+      for (const TrieKey* it = first; it != last; ++it) {
+        if (*it == key) {
+          return childNodes_[n.childBegin + (it - first)];
+        }
+      }
+
+      return TRIE_NPOS;
+    }
+
+    const TrieKey* it = std::lower_bound(first, last, key);
+
+    if (it == last || *it != key) {
+      return TRIE_NPOS;
+    }
+
+    return childNodes_[n.childBegin + (it - first)];
+  }
+
+  static void MergeNext(limonp::LocalVector<pair<size_t, const DictUnit*> >& nexts,
+                        size_t pos,
+                        const DictUnit* ptValue) {
+    size_t k = 0;
+
+    while (k < nexts.size() && nexts[k].first < pos) {
+      k++;
+    }
+
+    if (k < nexts.size() && nexts[k].first == pos) {
+      nexts[k].second = ptValue;
+      return;
+    }
+
+    nexts.push_back(pair<size_t, const DictUnit*>(pos, ptValue));
+
+    for (size_t m = nexts.size() - 1; m > k; m--) {
+      nexts[m] = nexts[m - 1];
+    }
+
+    nexts[k] = pair<size_t, const DictUnit*>(pos, ptValue);
+  }
+
+  uint32_t AppendChild(uint32_t node, TrieKey key) {
+    uint32_t child = nodes_.size();
+    nodes_.push_back(TrieNode());
+
+    uint32_t begin = nodes_[node].childBegin;
+    uint32_t count = nodes_[node].childCount;
+    uint32_t newBegin = childKeys_.size();
+    bool inserted = false;
+
+    for (uint32_t i = 0; i < count; i++) {
+      if (!inserted && key < childKeys_[begin + i]) {
+        childKeys_.push_back(key);
+        childNodes_.push_back(child);
+        inserted = true;
+      }
+
+      childKeys_.push_back(childKeys_[begin + i]);
+      childNodes_.push_back(childNodes_[begin + i]);
+    }
+
+    if (!inserted) {
+      childKeys_.push_back(key);
+      childNodes_.push_back(child);
+    }
+
+    nodes_[node].childBegin = newBegin;
+    nodes_[node].childCount = count + 1;
+    return child;
+  }
+
+  struct KeyLess {
+    explicit KeyLess(const vector<Unicode>& keys): keys_(keys) {
+    }
+    bool operator()(size_t a, size_t b) const {
+      return std::lexicographical_compare(keys_[a].begin(), keys_[a].end(),
+                                          keys_[b].begin(), keys_[b].end());
+    }
+    const vector<Unicode>& keys_;
+  }; // struct KeyLess
+
+  struct Pending {
+    uint32_t node;
+    size_t lo;
+    size_t hi;
+    size_t depth;
+  }; // struct Pending
+
+  /**
+   * 对键排序后按层构建，兄弟节点连续存放。
+   * 重复的键以最后出现的为准，与逐个插入的结果一致。
+   */
   void CreateTrie(const vector<Unicode>& keys, const vector<const DictUnit*>& valuePointers) {
     if (valuePointers.empty() || keys.empty()) {
       return;
@@ -165,28 +434,66 @@ class Trie {
 
     assert(keys.size() == valuePointers.size());
 
+    vector<size_t> order;
+    order.reserve(keys.size());
+
     for (size_t i = 0; i < keys.size(); i++) {
-      InsertNode(keys[i], valuePointers[i]);
+      if (keys[i].size() > 0) {
+        order.push_back(i);
+      }
     }
-  }
 
-  void DeleteNode(TrieNode* node) {
-    if (NULL == node) {
-      return;
-    }
+    std::stable_sort(order.begin(), order.end(), KeyLess(keys));
+
+    std::queue<Pending> pending;
+    Pending root = {TRIE_ROOT, 0, order.size(), 0};
+    pending.push(root);
+
+    while (!pending.empty()) {
+      Pending cur = pending.front();
+      pending.pop();
 
-    if (NULL != node->next) {
-      for (TrieNode::NextMap::iterator it = node->next->begin(); it != node->next->end(); ++it) {
-        DeleteNode(it->second);
+      size_t lo = cur.lo;
+
+      // 长度等于当前深度的键排在最前，即落在本节点上
+      while (lo < cur.hi && keys[order[lo]].size() == cur.depth) {
+        nodes_[cur.node].ptValue = valuePointers[order[lo]];
+        lo++;
       }
 
-      delete node->next;
+      nodes_[cur.node].childBegin = childKeys_.size();
+
+      while (lo < cur.hi) {
+        TrieKey key = keys[order[lo]][cur.depth];
+        size_t hi = lo + 1;
+
+        while (hi < cur.hi && keys[order[hi]][cur.depth] == key) {
+          hi++;
+        }
+
+        uint32_t child = nodes_.size();
+        nodes_.push_back(TrieNode());
+        childKeys_.push_back(key);
+        childNodes_.push_back(child);
+        nodes_[cur.node].childCount++;
+
+        Pending next = {child, lo, hi, cur.depth + 1};
+        pending.push(next);
+        lo = hi;
+      }
     }
 
-    delete node;
+    nodes_.shrink_to_fit();
+    childKeys_.shrink_to_fit();
+    childNodes_.shrink_to_fit();
+    BuildRootIndex();
   }
 
-  TrieNode* root_;
+  vector<TrieNode> nodes_;
+  vector<TrieKey> childKeys_;    // 子节点的键，每个节点的区间内有序
+  vector<uint32_t> childNodes_;  // 与childKeys_对应的子节点下标
+  vector<uint32_t> rootPages_;   // rune高位 -> rootSlots_中的页起点
+  vector<uint32_t> rootSlots_;   // 根节点子节点的直接索引
 }; // class Trie
 } // namespace cppjieba
 
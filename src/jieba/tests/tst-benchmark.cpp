@@ -0,0 +1,347 @@
+#include <fstream>
+#include <chrono>
+#include <unordered_map>
+#include <malloc.h>
+#include "cppjieba/DictTrie.hpp"
+#include "cppjieba/MPSegment.hpp"
+#include "gtest/gtest.h"
+
+using namespace cppjieba;
+
+static const char* const BENCH_DICT_FILE = "../../../../var/test/jieba/testdata/extra_dict/jieba.dict.small.utf8";
+static const char* const BENCH_TEXT_FILE = "../../../../var/test/jieba/testdata/weicheng.utf8";
+
+/**
+ * 原unordered_map节点的前缀树，用于对照
+ */
+class LegacyTrieNode {
+ public :
+  LegacyTrieNode(): next(NULL), ptValue(NULL) {
+  }
+ public:
+  typedef unordered_map<TrieKey, LegacyTrieNode*> NextMap;
+  NextMap *next;
+  const DictUnit *ptValue;
+};
+
+class LegacyTrie {
+ public:
+  LegacyTrie(const vector<Unicode>& keys, const vector<const DictUnit*>& valuePointers)
+    : root_(new LegacyTrieNode) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      InsertNode(keys[i], valuePointers[i]);
+    }
+  }
+  ~LegacyTrie() {
+    DeleteNode(root_);
+  }
+
+  void Find(RuneStrArray::const_iterator begin,
+            RuneStrArray::const_iterator end,
+            vector<struct Dag>&res,
+            size_t max_word_len = MAX_WORD_LENGTH) const {
+    res.resize(end - begin);
+
+    const LegacyTrieNode *ptNode = NULL;
+    LegacyTrieNode::NextMap::const_iterator citer;
+
+    for (size_t i = 0; i < size_t(end - begin); i++) {
+      res[i].runestr = *(begin + i);
+
+      if (root_->next != NULL && root_->next->end() != (citer = root_->next->find(res[i].runestr.rune))) {
+        ptNode = citer->second;
+      } else {
+        ptNode = NULL;
+      }
+
+      if (ptNode != NULL) {
+        res[i].nexts.push_back(pair<size_t, const DictUnit*>(i, ptNode->ptValue));
+      } else {
+        res[i].nexts.push_back(pair<size_t, const DictUnit*>(i, static_cast<const DictUnit*>(NULL)));
+      }
+
+      for (size_t j = i + 1; j < size_t(end - begin) && (j - i + 1) <= max_word_len; j++) {
+        if (ptNode == NULL || ptNode->next == NULL) {
+          break;
+        }
+
+        citer = ptNode->next->find((begin + j)->rune);
+
+        if (ptNode->next->end() == citer) {
+          break;
+        }
+
+        ptNode = citer->second;
+
+        if (NULL != ptNode->ptValue) {
+          res[i].nexts.push_back(pair<size_t, const DictUnit*>(j, ptNode->ptValue));
+        }
+      }
+    }
+  }
+
+  void InsertNode(const Unicode& key, const DictUnit* ptValue) {
+    if (key.begin() == key.end()) {
+      return;
+    }
+
+    LegacyTrieNode *ptNode = root_;
+
+    for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
+      if (NULL == ptNode->next) {
+        ptNode->next = new LegacyTrieNode::NextMap;
+      }
+
+      LegacyTrieNode::NextMap::const_iterator kmIter = ptNode->next->find(*citer);
+
+      if (ptNode->next->end() == kmIter) {
+        LegacyTrieNode *nextNode = new LegacyTrieNode;
+        ptNode->next->insert(make_pair(*citer, nextNode));
+        ptNode = nextNode;
+      } else {
+        ptNode = kmIter->second;
+      }
+    }
+
+    ptNode->ptValue = ptValue;
+  }
+
+ private:
+  void DeleteNode(LegacyTrieNode* node) {
+    if (NULL != node->next) {
+      for (LegacyTrieNode::NextMap::iterator it = node->next->begin(); it != node->next->end(); ++it) {
+        DeleteNode(it->second);
+      }
+
+      delete node->next;
+    }
+
+    delete node;
+  }
+
+  LegacyTrieNode* root_;
+}; // class LegacyTrie
+
+/**
+ * 读取词典中的词条，作为两种前缀树的输入
+ */
+static void LoadBenchDict(vector<DictUnit>& units) {
+  ifstream ifs(BENCH_DICT_FILE);
+  string line;
+
+  while (getline(ifs, line)) {
+    vector<string> buf;
+    Split(line, buf, " ");
+
+    if (buf.empty()) {
+      continue;
+    }
+
+    DictUnit unit;
+
+    if (!DecodeRunesInString(buf[0], unit.word)) {
+      continue;
+    }
+
+    unit.weight = 0.0;
+    units.push_back(unit);
+  }
+}
+
+static void LoadBenchText(vector<RuneStrArray>& sentences) {
+  ifstream ifs(BENCH_TEXT_FILE);
+  string line;
+
+  while (getline(ifs, line)) {
+    RuneStrArray runes;
+
+    if (!line.empty() && DecodeRunesInString(line, runes)) {
+      sentences.push_back(runes);
+    }
+  }
+}
+
+/** 已分配的堆内存(bytes)，含malloc的额外开销 */
+static size_t HeapBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  // glibc 2.33 起 mallinfo 已废弃，且字段为int，超过2GB时溢出
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  struct mallinfo info = mallinfo();
+  return size_t(unsigned(info.uordblks)) + size_t(unsigned(info.hblkhd));
+#endif
+}
+
+TEST(JiebaTest, TrieBenchEquivalence) {
+  vector<DictUnit> units;
+  LoadBenchDict(units);
+  ASSERT_GT(units.size(), 0u);
+
+  vector<Unicode> keys;
+  vector<const DictUnit*> values;
+
+  for (size_t i = 0; i < units.size(); i++) {
+    keys.push_back(units[i].word);
+    values.push_back(&units[i]);
+  }
+
+  Trie trie(keys, values);
+  LegacyTrie legacy(keys, values);
+
+  // 构建后插入的词条两边都要能找到
+  DictUnit inserted;
+  ASSERT_TRUE(DecodeRunesInString("男默女泪", inserted.word));
+  trie.InsertNode(inserted.word, &inserted);
+  legacy.InsertNode(inserted.word, &inserted);
+
+  vector<RuneStrArray> sentences;
+  LoadBenchText(sentences);
+  RuneStrArray extra;
+  ASSERT_TRUE(DecodeRunesInString("看得我男默女泪", extra));
+  sentences.push_back(extra);
+
+  for (size_t s = 0; s < sentences.size(); s++) {
+    vector<Dag> expected, actual;
+    legacy.Find(sentences[s].begin(), sentences[s].end(), expected);
+    trie.Find(sentences[s].begin(), sentences[s].end(), actual);
+    ASSERT_EQ(expected.size(), actual.size());
+
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_EQ(expected[i].nexts.size(), actual[i].nexts.size());
+
+      for (size_t k = 0; k < expected[i].nexts.size(); k++) {
+        ASSERT_EQ(expected[i].nexts[k].first, actual[i].nexts[k].first);
+        ASSERT_EQ(expected[i].nexts[k].second, actual[i].nexts[k].second);
+      }
+    }
+  }
+}
+
+/**
+ * 构建DAG(MPSegment的主要开销)的吞吐量，以及两种前缀树占用的内存
+ */
+TEST(JiebaTest, TrieBenchThroughputAndMemory) {
+  vector<DictUnit> units;
+  LoadBenchDict(units);
+  ASSERT_GT(units.size(), 0u);
+
+  vector<Unicode> keys;
+  vector<const DictUnit*> values;
+
+  for (size_t i = 0; i < units.size(); i++) {
+    keys.push_back(units[i].word);
+    values.push_back(&units[i]);
+  }
+
+  vector<RuneStrArray> sentences;
+  LoadBenchText(sentences);
+  ASSERT_GT(sentences.size(), 0u);
+
+  size_t before = HeapBytes();
+  LegacyTrie* legacy = new LegacyTrie(keys, values);
+  size_t legacyBytes = HeapBytes() - before;
+
+  before = HeapBytes();
+  Trie* trie = new Trie(keys, values);
+  size_t trieBytes = HeapBytes() - before;
+
+  const int rounds = 20;
+  size_t runes = 0;
+  vector<Dag> dags;
+
+  auto begin = std::chrono::steady_clock::now();
+
+  for (int r = 0; r < rounds; r++) {
+    for (size_t s = 0; s < sentences.size(); s++) {
+      dags.clear();
+      legacy->Find(sentences[s].begin(), sentences[s].end(), dags);
+      runes += sentences[s].size();
+    }
+  }
+
+  double legacySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  begin = std::chrono::steady_clock::now();
+
+  for (int r = 0; r < rounds; r++) {
+    for (size_t s = 0; s < sentences.size(); s++) {
+      dags.clear();
+      trie->Find(sentences[s].begin(), sentences[s].end(), dags);
+    }
+  }
+
+  double trieSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  std::cout << "words " << keys.size() << ", nodes " << trie->NodeCount() << std::endl;
+  std::cout << "legacy trie: " << (runes / legacySeconds) << " runes/sec, heap "
+            << legacyBytes / 1024 << " KB" << std::endl;
+  std::cout << "flat trie:   " << (runes / trieSeconds) << " runes/sec, heap "
+            << trieBytes / 1024 << " KB" << std::endl;
+
+  delete trie;
+  delete legacy;
+}
+
+/**
+ * 基于DictTrie的整句切分吞吐量
+ */
+TEST(JiebaTest, TrieBenchSegment) {
+  DictTrie dict(BENCH_DICT_FILE);
+  MPSegment segment(&dict);
+
+  vector<string> lines;
+  ifstream ifs(BENCH_TEXT_FILE);
+  string line;
+  size_t bytes = 0;
+
+  while (getline(ifs, line)) {
+    lines.push_back(line);
+    bytes += line.size();
+  }
+
+  ASSERT_GT(lines.size(), 0u);
+
+  const int rounds = 20;
+  vector<string> words;
+  auto begin = std::chrono::steady_clock::now();
+
+  for (int r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < lines.size(); i++) {
+      segment.Cut(lines[i], words);
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  std::cout << "MPSegment: " << (bytes * rounds / seconds / 1024) << " KB/sec" << std::endl;
+}
+
+/**
+ * 文本词典与二进制词典的加载耗时
+ */
+TEST(JiebaTest, TrieBenchLoadBinary) {
+  const string binFile = "jieba.dict.bench.bin";
+  auto begin = std::chrono::steady_clock::now();
+  DictTrie* text = new DictTrie(BENCH_DICT_FILE);
+  double textSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  {
+    ofstream ofs(binFile.c_str(), ios::binary | ios::trunc);
+    ASSERT_TRUE(text->Save(ofs));
+  }
+
+  begin = std::chrono::steady_clock::now();
+  chatopera::utils::MmapFile file;
+  ASSERT_TRUE(file.open(binFile));
+  chatopera::utils::MmapReader reader(file);
+  DictTrie* binary = DictTrie::Load(reader);
+  double binarySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  ASSERT_TRUE(binary != NULL);
+
+  std::cout << "load text dict: " << textSeconds * 1000 << " ms, binary dict: "
+            << binarySeconds * 1000 << " ms" << std::endl;
+
+  delete binary;
+  delete text;
+  remove(binFile.c_str());
+}
@@ -137,3 +137,152 @@ TEST(JiebaTest, InsertUserWord) {
     ASSERT_EQ(res, "[{\"word\": \"iPhone6\", \"offset\": [6], \"weight\": 11.7392}, {\"word\": \"\xE4\xB8\x80\xE9\x83\xA8\", \"offset\": [0], \"weight\": 6.47592}]");
   }
 }
+
+TEST(JiebaTest, SharedBase) {
+  std::shared_ptr<const JiebaBase> base = JiebaBase::Get(DICT_PATH,
+                                          HMM_PATH,
+                                          IDF_PATH,
+                                          STOP_WORD_PATH);
+  // 同一份文件只加载一次
+  ASSERT_EQ(base.get(), JiebaBase::Get(DICT_PATH, HMM_PATH, IDF_PATH, STOP_WORD_PATH).get());
+
+  cppjieba::Jieba shared(base, USER_DICT_PATH);
+  cppjieba::Jieba plain(DICT_PATH,
+                        HMM_PATH,
+                        USER_DICT_PATH,
+                        IDF_PATH,
+                        STOP_WORD_PATH);
+  ASSERT_EQ(shared.GetHMMModel(), base->model.get());
+
+  const char* sentences[] = {"他来到了网易杭研大厦", "我来自北京邮电大学。", "南京市长江大桥", "男默女泪"};
+  vector<string> expected, actual;
+
+  for (size_t i = 0; i < sizeof(sentences) / sizeof(sentences[0]); i++) {
+    plain.Cut(sentences[i], expected);
+    shared.Cut(sentences[i], actual);
+    ASSERT_EQ(expected, actual);
+    plain.CutForSearch(sentences[i], expected);
+    shared.CutForSearch(sentences[i], actual);
+    ASSERT_EQ(expected, actual);
+  }
+
+  // 用户词只进入本分词器，不影响共享的基础词典
+  ASSERT_TRUE(shared.InsertUserWord("男默女泪"));
+  string result;
+  shared.Cut("男默女泪", actual);
+  result << actual;
+  ASSERT_EQ("[\"男默女泪\"]", result);
+
+  cppjieba::Jieba other(base, USER_DICT_PATH);
+  other.Cut("男默女泪", actual);
+  result << actual;
+  ASSERT_EQ("[\"男默\", \"女泪\"]", result);
+}
+
+/**
+ * 不同目录下内容相同的词典共用一份
+ */
+TEST(JiebaTest, SharedBaseByContent) {
+  const char* sources[] = {DICT_PATH, HMM_PATH, IDF_PATH, STOP_WORD_PATH};
+  vector<string> copies;
+
+  for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+    copies.push_back(string("jieba.copy.") + std::to_string(i));
+    ifstream ifs(sources[i], ios::binary);
+    ofstream ofs(copies[i].c_str(), ios::binary | ios::trunc);
+    ofs << ifs.rdbuf();
+  }
+
+  std::shared_ptr<const JiebaBase> base = JiebaBase::Get(DICT_PATH,
+                                          HMM_PATH,
+                                          IDF_PATH,
+                                          STOP_WORD_PATH);
+  ASSERT_EQ(base.get(), JiebaBase::Get(copies[0], copies[1], copies[2], copies[3]).get());
+
+  for (size_t i = 0; i < copies.size(); i++) {
+    remove(copies[i].c_str());
+  }
+}
+
+/**
+ * 文件状态未变时沿用缓存，改动后重新加载
+ */
+TEST(JiebaTest, SharedBaseReloadOnChange) {
+  const string dictFile = "jieba.changed.utf8";
+  {
+    ifstream ifs(DICT_PATH, ios::binary);
+    ofstream ofs(dictFile.c_str(), ios::binary | ios::trunc);
+    ofs << ifs.rdbuf();
+  }
+
+  std::shared_ptr<const JiebaBase> base = JiebaBase::Get(dictFile, HMM_PATH, IDF_PATH, STOP_WORD_PATH);
+  ASSERT_EQ(base.get(), JiebaBase::Get(dictFile, HMM_PATH, IDF_PATH, STOP_WORD_PATH).get());
+  ASSERT_EQ(base.get(), JiebaBase::Get(DICT_PATH, HMM_PATH, IDF_PATH, STOP_WORD_PATH).get());
+
+  {
+    ofstream ofs(dictFile.c_str(), ios::binary | ios::app);
+    ofs << "男默女泪 3 n\n";
+  }
+
+  std::shared_ptr<const JiebaBase> changed = JiebaBase::Get(dictFile, HMM_PATH, IDF_PATH, STOP_WORD_PATH);
+  ASSERT_NE(base.get(), changed.get());
+
+  remove(dictFile.c_str());
+}
+
+TEST(JiebaTest, SharedBaseBinary) {
+  const string binFile = "jieba.test.bin";
+  JiebaBase text(DICT_PATH, HMM_PATH, IDF_PATH, STOP_WORD_PATH);
+  ASSERT_TRUE(text.Save(binFile, DICT_PATH, HMM_PATH));
+
+  std::shared_ptr<const JiebaBase> binary = std::make_shared<const JiebaBase>(DICT_PATH,
+      HMM_PATH,
+      IDF_PATH,
+      STOP_WORD_PATH,
+      binFile);
+  std::shared_ptr<const JiebaBase> plain = std::make_shared<const JiebaBase>(DICT_PATH,
+      HMM_PATH,
+      IDF_PATH,
+      STOP_WORD_PATH);
+
+  cppjieba::Jieba expectedJieba(plain, USER_DICT_PATH);
+  cppjieba::Jieba actualJieba(binary, USER_DICT_PATH);
+  const char* sentences[] = {"他来到了网易杭研大厦", "我来自北京邮电大学。", "南京市长江大桥"};
+  vector<string> expected, actual;
+
+  for (size_t i = 0; i < sizeof(sentences) / sizeof(sentences[0]); i++) {
+    expectedJieba.Cut(sentences[i], expected);
+    actualJieba.Cut(sentences[i], actual);
+    ASSERT_EQ(expected, actual);
+  }
+
+  remove(binFile.c_str());
+}
+
+/**
+ * 文本词典改动后大小不变，二进制文件也要按过期处理
+ */
+TEST(JiebaTest, SharedBaseStaleBinary) {
+  const string binFile = "jieba.test.bin";
+  const string dictFile = "jieba.stale.utf8";
+  JiebaBase text(DICT_PATH, HMM_PATH, IDF_PATH, STOP_WORD_PATH);
+  ASSERT_TRUE(text.Save(binFile, DICT_PATH, HMM_PATH));
+
+  // 修改第一个词条的词频，文件大小不变
+  ifstream ifs(DICT_PATH, ios::binary);
+  string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  size_t pos = content.find(' ');
+  ASSERT_NE(pos, string::npos);
+  content[pos + 1] = content[pos + 1] == '9' ? '8' : '9';
+  ofstream ofs(dictFile.c_str(), ios::binary | ios::trunc);
+  ofs << content;
+  ofs.close();
+
+  JiebaBase stale(dictFile, HMM_PATH, IDF_PATH, STOP_WORD_PATH, binFile);
+  JiebaBase plain(dictFile, HMM_PATH, IDF_PATH, STOP_WORD_PATH);
+  ASSERT_NE(text.dict_trie->GetMinWeight(), plain.dict_trie->GetMinWeight());
+  ASSERT_EQ(plain.dict_trie->GetMinWeight(), stale.dict_trie->GetMinWeight());
+
+  remove(dictFile.c_str());
+  remove(binFile.c_str());
+}
@@ -196,6 +196,33 @@ TEST(JiebaTest, HMMSegmentTest) {
   }
 }
 
+TEST(JiebaTest, HMMModelBinary) {
+  HMMModel text(HMM_PATH);
+  const string binFile = "hmm_model.test.bin";
+  {
+    ofstream ofs(binFile.c_str(), ios::binary | ios::trunc);
+    ASSERT_TRUE(text.Save(ofs));
+  }
+
+  chatopera::utils::MmapFile file;
+  ASSERT_TRUE(file.open(binFile));
+  chatopera::utils::MmapReader reader(file);
+  HMMModel* binary = HMMModel::Load(reader);
+  ASSERT_TRUE(binary != NULL);
+  ASSERT_EQ(reader.remaining(), 0u);
+
+  HMMSegment expectedSeg(&text);
+  HMMSegment actualSeg(binary);
+  const char* str = "我来自北京邮电大学。。。学号123456";
+  vector<string> expected, actual;
+  expectedSeg.Cut(str, expected);
+  actualSeg.Cut(str, actual);
+  ASSERT_EQ(expected, actual);
+
+  delete binary;
+  remove(binFile.c_str());
+}
+
 TEST(JiebaTest, FullSegment1) {
   FullSegment segment("../../../../var/test/jieba/testdata/extra_dict/jieba.dict.small.utf8");
   vector<string> words;
@@ -182,3 +182,127 @@ TEST(JiebaTest, DictTrieTestDag) {
     }
   }
 }
+
+TEST(JiebaTest, TrieTestInsertNode) {
+  vector<Unicode> keys;
+  vector<DictUnit> units(4);
+  vector<const DictUnit*> values;
+  const char* words[] = {"北京", "北京大学", "南京", "南京市"};
+
+  for (size_t i = 0; i < units.size(); i++) {
+    ASSERT_TRUE(DecodeRunesInString(words[i], units[i].word));
+    keys.push_back(units[i].word);
+    values.push_back(&units[i]);
+  }
+
+  Trie trie(keys, values);
+
+  // 新的首字、已有节点下的新分支、已有路径上的新词条
+  const char* inserted[] = {"上海", "北京邮电大学", "北", "南京市长"};
+  DictUnit insertedUnits[4];
+
+  for (size_t i = 0; i < 4; i++) {
+    ASSERT_TRUE(DecodeRunesInString(inserted[i], insertedUnits[i].word));
+    trie.InsertNode(insertedUnits[i].word, &insertedUnits[i]);
+  }
+
+  for (size_t i = 0; i < 4; i++) {
+    cppjieba::RuneStrArray unicode;
+    ASSERT_TRUE(DecodeRunesInString(words[i], unicode));
+    ASSERT_EQ(trie.Find(unicode.begin(), unicode.end()), &units[i]);
+    ASSERT_TRUE(DecodeRunesInString(inserted[i], unicode));
+    ASSERT_EQ(trie.Find(unicode.begin(), unicode.end()), &insertedUnits[i]);
+  }
+
+  cppjieba::RuneStrArray unicode;
+  ASSERT_TRUE(DecodeRunesInString("北京邮电", unicode));
+  ASSERT_TRUE(trie.Find(unicode.begin(), unicode.end()) == NULL);
+}
+
+TEST(JiebaTest, DictTrieTestOverlay) {
+  const char* userDict = "../../../../var/test/jieba/testdata/userdict.utf8";
+  DictTrie combined(DICT_FILE, userDict);
+  std::shared_ptr<const DictTrie> base(new DictTrie(DICT_FILE));
+  DictTrie overlay(base, userDict);
+
+  ASSERT_EQ(combined.GetMinWeight(), overlay.GetMinWeight());
+  // 覆盖层只统计自己的用户词条
+  ASSERT_GT(overlay.MemoryUsage(), 0u);
+  ASSERT_LT(overlay.MemoryUsage() * 10, combined.MemoryUsage());
+
+  const char* words[] = {"云计算", "韩玉鉴赏", "清华大学", "北京邮电大学", "长江大桥", "来到"};
+
+  for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+    cppjieba::RuneStrArray unicode;
+    ASSERT_TRUE(DecodeRunesInString(words[i], unicode));
+    const DictUnit* expected = combined.Find(unicode.begin(), unicode.end());
+    const DictUnit* actual = overlay.Find(unicode.begin(), unicode.end());
+    ASSERT_EQ(expected == NULL, actual == NULL);
+
+    if (expected != NULL) {
+      ASSERT_EQ(expected->word.size(), actual->word.size());
+      ASSERT_EQ(expected->weight, actual->weight);
+      ASSERT_EQ(expected->tag, actual->tag);
+    }
+
+    vector<struct Dag> expectedDags, actualDags;
+    combined.Find(unicode.begin(), unicode.end(), expectedDags);
+    overlay.Find(unicode.begin(), unicode.end(), actualDags);
+    ASSERT_EQ(expectedDags.size(), actualDags.size());
+
+    for (size_t k = 0; k < expectedDags.size(); k++) {
+      ASSERT_EQ(expectedDags[k].nexts.size(), actualDags[k].nexts.size());
+
+      for (size_t n = 0; n < expectedDags[k].nexts.size(); n++) {
+        ASSERT_EQ(expectedDags[k].nexts[n].first, actualDags[k].nexts[n].first);
+        ASSERT_EQ(expectedDags[k].nexts[n].second == NULL, actualDags[k].nexts[n].second == NULL);
+      }
+    }
+  }
+
+  MPSegment expectedSeg(&combined);
+  MPSegment actualSeg(&overlay);
+  vector<string> expected, actual;
+  expectedSeg.Cut("我在清华大学学习云计算，韩玉鉴赏长江大桥", expected);
+  actualSeg.Cut("我在清华大学学习云计算，韩玉鉴赏长江大桥", actual);
+  ASSERT_EQ(expected, actual);
+}
+
+TEST(JiebaTest, DictTrieTestBinary) {
+  DictTrie text(DICT_FILE, "../../../../var/test/jieba/testdata/userdict.utf8");
+  const string binFile = "jieba.dict.test.bin";
+  {
+    ofstream ofs(binFile.c_str(), ios::binary | ios::trunc);
+    ASSERT_TRUE(text.Save(ofs));
+  }
+
+  chatopera::utils::MmapFile file;
+  ASSERT_TRUE(file.open(binFile));
+  chatopera::utils::MmapReader reader(file);
+  DictTrie* binary = DictTrie::Load(reader);
+  ASSERT_TRUE(binary != NULL);
+  ASSERT_EQ(reader.remaining(), 0u);
+  ASSERT_EQ(text.GetMinWeight(), binary->GetMinWeight());
+
+  const char* sentence = "我在清华大学学习云计算，韩玉鉴赏长江大桥";
+  MPSegment expectedSeg(&text);
+  MPSegment actualSeg(binary);
+  vector<string> expected, actual;
+  expectedSeg.Cut(sentence, expected);
+  actualSeg.Cut(sentence, actual);
+  ASSERT_EQ(expected, actual);
+
+  cppjieba::RuneStrArray unicode;
+  ASSERT_TRUE(DecodeRunesInString("云计算", unicode));
+  const DictUnit* unit = binary->Find(unicode.begin(), unicode.end());
+  ASSERT_TRUE(unit != NULL);
+  ASSERT_EQ(unit->weight, text.Find(unicode.begin(), unicode.end())->weight);
+  ASSERT_EQ(unit->tag, text.Find(unicode.begin(), unicode.end())->tag);
+
+  // 截断的文件不能被加载
+  chatopera::utils::MmapReader truncated(file.data(), file.size() / 2);
+  ASSERT_TRUE(DictTrie::Load(truncated) == NULL);
+
+  delete binary;
+  remove(binFile.c_str());
+}
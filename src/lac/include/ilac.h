@@ -54,6 +54,15 @@ void lac_destroy(void* lac_handle);
 ///
 void* lac_buff_create(void* lac_handle);
 
+///
+/// \brief lac_buff_reset, clear thread variables so the buff can be reused
+///     by the next query without being created again
+/// \param lac_handle, the Lac handle
+/// \param lac_buff, the struct of thread variables to reset
+/// \return 0 when succeeded, or _FAILED
+///
+int lac_buff_reset(void* lac_handle, void* lac_buff);
+
 ///
 /// \brief lac_buff_destroy, destroy thread variables
 /// \param lac_handle, the Lac handle
@@ -73,6 +82,22 @@ void lac_buff_destroy(void* lac_handle, void* lac_buff);
 int lac_tagging(void* lac_handle, void* lac_buff,
                 const char* query, tag_t* results, int max_result_num);
 
+///
+/// \brief lac_tagging_batch, tag several queries, the sentences of all queries
+///     are packed into one multi-sequence LoDTensor and go through the model once
+/// \param lac_buff, the struct of thread variables
+/// \param queries, queries to tag
+/// \param query_num, number of queries
+/// \param results, tagged results, the results of the i-th query start at
+///     results + i * max_result_num, so it holds query_num * max_result_num items
+/// \param result_nums, number of tagged results of each query
+/// \param max_result_num, limit of tagged results of each query
+/// \return 0 when succeeded, or _FAILED
+///
+int lac_tagging_batch(void* lac_handle, void* lac_buff,
+                      const char** queries, int query_num,
+                      tag_t* results, int* result_nums, int max_result_num);
+
 #ifdef __cplusplus
 }
 #endif
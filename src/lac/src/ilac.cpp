@@ -50,9 +50,19 @@ void* lac_buff_create(void* lac_handle) {
   return lac_buff;
 }
 
+int lac_buff_reset(void* lac_handle, void* lac_buff) {
+  if (lac_handle == NULL || lac_buff == NULL) {
+    std::cerr << "lac_buff_reset: lac_handle or lac_buff is null" << std::endl;
+    return _FAILED;
+  }
+
+  return ((Lac*) lac_handle)->reset_buff(lac_buff);
+}
+
 void lac_buff_destroy(void* lac_handle, void* lac_buff) {
-  if (lac_handle == NULL && lac_buff != NULL) {
+  if (lac_handle != NULL && lac_buff != NULL) {
     ((Lac*) lac_handle)->destroy_buff(lac_buff);
+    delete (lac_buff_t*) lac_buff;
   }
 }
 
@@ -68,3 +78,15 @@ int lac_tagging(void* lac_handle, void* lac_buff,
 
   return result_num;
 }
+
+int lac_tagging_batch(void* lac_handle, void* lac_buff,
+                      const char** queries, int query_num,
+                      tag_t* results, int* result_nums, int max_result_num) {
+  if (lac_handle == NULL) {
+    std::cerr << "lac_tagging_batch: lac_handle is null" << std::endl;
+    return _FAILED;
+  }
+
+  return ((Lac*) lac_handle)->tagging_batch(queries, query_num, lac_buff,
+         (lac::tag_t *)results, result_nums, max_result_num);
+}
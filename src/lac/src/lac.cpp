@@ -247,6 +247,98 @@ int Lac::tagging(const char* query, void* buff, tag_t* results,
   return results_num;
 }
 
+RVAL Lac::tagging_batch(const char** queries, int query_num, void* buff,
+                        tag_t* results, int* result_nums, int max_result_num) {
+  if (queries == NULL || buff == NULL || results == NULL || result_nums == NULL) {
+    std::cerr << "queries, lac buff, results or result_nums is NULL" << std::endl;
+    return _FAILED;
+  }
+
+  if (max_result_num <= 0 || query_num < 0) {
+    std::cerr << "result_num or query_num is not positive" << std::endl;
+    return _FAILED;
+  }
+
+  // split every query into sentences
+  std::vector<std::vector<std::string> > norm_char_vectors(query_num);
+  std::vector<std::vector<int> > origin_char_offsets(query_num);
+  std::vector<std::vector<std::string> > sents;
+  std::vector<int> sent_query;   /* query index of each sentence */
+  std::vector<int> sent_start;   /* start char of each sentence in query */
+
+  for (int q = 0; q < query_num; ++q) {
+    result_nums[q] = 0;
+
+    if (queries[q] == NULL ||
+        string_normal(queries[q], norm_char_vectors[q], origin_char_offsets[q]) != _SUCCESS) {
+      std::cerr << "query normalize failed" << std::endl;
+      return _FAILED;
+    }
+
+    int start = 0;
+    int tcnt = 0;
+
+    while ((tcnt = seg_sent_iter(norm_char_vectors[q], start)) > 0) {
+      sents.push_back(std::vector<std::string>(norm_char_vectors[q].begin() + start,
+                      norm_char_vectors[q].begin() + start + tcnt));
+      sent_query.push_back(q);
+      sent_start.push_back(start);
+      start += tcnt;
+    }
+  }
+
+  lac_buff_t* lac_buff = (lac_buff_t*) buff;
+  std::vector<std::vector<int> > sent_outputs;
+
+  if (_main_tagger) {
+    reset_buff(buff);
+
+    if (_main_tagger->predict_batch(sents, sent_outputs, lac_buff) != _SUCCESS) {
+      std::cerr << "_main_tagger predict_batch failed" << std::endl;
+      return _FAILED;
+    }
+  }
+
+  for (size_t i = 0; i < sents.size(); ++i) {
+    int q = sent_query[i];
+    int start = sent_start[i];
+    int tcnt = sents[i].size();
+
+    reset_buff(buff);
+    lac_buff->sent_char_vector.swap(sents[i]);
+    lac_buff->sent_offset_vector.assign(origin_char_offsets[q].begin() + start,
+                                        origin_char_offsets[q].begin() + start + tcnt + 1);
+
+    if (_main_tagger) {
+      if (_main_tagger->tagging_with_output(lac_buff, sent_outputs[i], max_result_num) != _SUCCESS) {
+        std::cerr << "_main_tagger tagging failed" << std::endl;
+        return _FAILED;
+      }
+    }
+
+    if (_customization_tagger && _customization_tagger->has_customized_words()) {
+      if (_customization_tagger->tagging(lac_buff, max_result_num) != _SUCCESS) {
+        std::cerr << "_customization_tagger tagging failed" << std::endl;
+        return _FAILED;
+      }
+    } else {
+      lac_buff->customization_tagger_result_num = 0;
+    }
+
+    int results_num = merge_result(lac_buff, results + q * max_result_num,
+                                   result_nums[q], max_result_num);
+
+    if (results_num < 0 || results_num > max_result_num) {
+      std::cerr << "merge failed" << std::endl;
+      return _FAILED;
+    }
+
+    result_nums[q] = results_num;
+  }
+
+  return _SUCCESS;
+}
+
 RVAL Lac::load_q2b_dic(const std::string &q2b_dic_path) {
   std::ifstream  fin;
   fin.open(q2b_dic_path.c_str());
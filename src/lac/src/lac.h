@@ -65,6 +65,21 @@ class Lac {
   /// \return number of tagged results, or _FAILED
   ///
   int tagging(const char* query, void* buff, tag_t* results, int max_result_num);
+
+  ///
+  /// \brief tagging_batch, tag several queries, the sentences of all queries
+  ///         go through the model in one forward pass
+  /// \param queries, queries to tag
+  /// \param query_num, number of queries
+  /// \param buff, pointer of the struct of therad variables
+  /// \param results, tagged results, results of the i-th query start at
+  ///         results + i * max_result_num
+  /// \param result_nums, number of tagged results of each query
+  /// \param max_result_num, limit of tagged results of each query
+  /// \return _SUCCESS or _FAILED
+  ///
+  RVAL tagging_batch(const char** queries, int query_num, void* buff,
+                     tag_t* results, int* result_nums, int max_result_num);
  private:
 
   MainTagger *_main_tagger; /* model tagger */
@@ -161,6 +161,95 @@ RVAL MainTagger::tagging(lac_buff_t *buff, int max_result_num) {
   return _SUCCESS;
 }
 
+RVAL MainTagger::tagging_with_output(lac_buff_t *buff,
+                                     const std::vector<int> &model_output_vector,
+                                     int max_result_num) const {
+  if (buff == NULL || buff->main_tagger_results == NULL || max_result_num < 0) {
+    std::cerr << "tagging parameter error" << std::endl;
+    return _FAILED;
+  }
+
+  int result_num = adapt_result(model_output_vector,
+                                buff->main_tagger_results, max_result_num, buff->sent_offset_vector);
+
+  if (result_num < 0) {
+    std::cerr << "adapt result failed" << std::endl;
+    return _FAILED;
+  }
+
+  buff->main_tagger_result_num = result_num;
+
+  return _SUCCESS;
+}
+
+RVAL MainTagger::predict_batch(const std::vector<std::vector<std::string> > &sents,
+                               std::vector<std::vector<int> > &sent_outputs,
+                               lac_buff_t *buff) {
+  if (buff == NULL) {
+    std::cerr << "predict_batch parameter error" << std::endl;
+    return _FAILED;
+  }
+
+  sent_outputs.clear();
+  sent_outputs.resize(sents.size());
+
+  if (sents.empty()) {
+    return _SUCCESS;
+  }
+
+  // all sentences share one input vector, lod records the border of each sentence
+  std::vector<int> &word_model_input_vector = buff->word_model_input_vector;
+  word_model_input_vector.clear();
+  std::vector<size_t> lod_level_0;
+  lod_level_0.push_back(0);
+
+  for (size_t i = 0; i < sents.size(); ++i) {
+    if (extract_feature(sents[i], word_model_input_vector) < _SUCCESS) {
+      std::cerr << "extract_feature failed" << std::endl;
+      return _FAILED;
+    }
+
+    lod_level_0.push_back(word_model_input_vector.size());
+  }
+
+  paddle::framework::LoDTensor tensor_word;
+  paddle::framework::LoDTensor tensor_output;
+
+  paddle::framework::LoD lod;
+  lod.push_back(lod_level_0);
+  tensor_word.set_lod(lod);
+
+  paddle::framework::DDim dims = {(long)word_model_input_vector.size(), 1};
+  int64_t *input_ptr_word = tensor_word.mutable_data<int64_t>(dims, paddle::platform::CPUPlace());
+
+  for (int i = 0; i < tensor_word.numel(); ++i) {
+    input_ptr_word[i] = word_model_input_vector[i];
+  }
+
+  std::map<std::string, const paddle::framework::LoDTensor*> &feed_targets = buff->feed_targets;
+  std::map<std::string, paddle::framework::LoDTensor*> &fetch_targets = buff->fetch_targets;
+
+  feed_targets["word"] = &tensor_word;
+  fetch_targets["crf_decoding_0.tmp_0"] = &tensor_output;
+
+  _executor->RunPreparedContext(buff->ctx.get(), _scope, &feed_targets,
+                                &fetch_targets, true, true, buff->feed_holder_name,
+                                buff->fetch_holder_name);
+
+  if ((size_t) tensor_output.numel() != word_model_input_vector.size()) {
+    std::cerr << "predict_batch output size mismatch" << std::endl;
+    return _FAILED;
+  }
+
+  const int64_t *output = tensor_output.data<int64_t>();
+
+  for (size_t i = 0; i < sents.size(); ++i) {
+    sent_outputs[i].assign(output + lod_level_0[i], output + lod_level_0[i + 1]);
+  }
+
+  return _SUCCESS;
+}
+
 RVAL MainTagger::load_word_dic(const std::string &word_dic_path) {
   std::ifstream  fin;
   fin.open(word_dic_path.c_str());
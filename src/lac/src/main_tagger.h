@@ -68,6 +68,28 @@ class MainTagger {
   ///
   RVAL tagging(lac_buff_t *buff, int max_result_num);
 
+  ///
+  /// \brief predict_batch, run the model once for several sentences packed
+  ///         into one multi-sequence LoDTensor
+  /// \param sents, sentences in the form of character vector
+  /// \param sent_outputs, the model output of each sentence
+  /// \param buff, pointer of struct of therad variables
+  /// \return _SUCCESS or _FAILED
+  ///
+  RVAL predict_batch(const std::vector<std::vector<std::string> > &sents,
+                     std::vector<std::vector<int> > &sent_outputs, lac_buff_t *buff);
+
+  ///
+  /// \brief tagging_with_output, tag lac tags of the sentence in buff using
+  ///         the model output computed by predict_batch
+  /// \param buff, pointer of struct of therad variables
+  /// \param model_output_vector, the model output of the sentence
+  /// \param max_result_num, limit of tagged results
+  /// \return _SUCCESS or _FAILED
+  ///
+  RVAL tagging_with_output(lac_buff_t *buff, const std::vector<int> &model_output_vector,
+                           int max_result_num) const;
+
  private:
   std::map<std::string, int> _word_dic; /* character to its index in model */
   int _word_dic_oov; /* oov index in model */
@@ -0,0 +1,106 @@
+/*
+ * lac batch tagging benchmark.
+ *
+ * @author   hain
+ * @email    hain@chatopera.com
+ */
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include "ilac.h"
+
+using namespace std;
+
+static const int BENCH_MAX_RESULT = 100;
+
+static const std::vector<std::string> BENCH_LINES = {
+  "9月2日开始，北京中小学正式开学。",
+  "公交集团将启用新版行车时刻表，在早晚高峰时段增发3500车次。",
+  "我想明天下午去上海虹桥火车站",
+  "帮我订一张后天从广州到深圳的高铁票",
+  "李雷和韩梅梅周末在颐和园见面",
+  "请问北京大学第三医院几点开门",
+  "下个月五号之前把报告发给王经理",
+  "杭州西湖边的酒店今晚还有房间吗"
+};
+
+/**
+ * 批量标注结果与逐条标注一致
+ */
+TEST(LacTest, BATCH_CONSISTENCY) {
+  void* handle = lac_create("../../../../var/test/lac/conf");
+  ASSERT_TRUE(handle != NULL);
+  void* buff = lac_buff_create(handle);
+  ASSERT_TRUE(buff != NULL);
+
+  int query_num = BENCH_LINES.size();
+  std::vector<const char*> queries;
+
+  for(const std::string& line : BENCH_LINES) {
+    queries.push_back(line.c_str());
+  }
+
+  std::vector<tag_t> results(query_num * BENCH_MAX_RESULT);
+  std::vector<int> result_nums(query_num);
+  ASSERT_EQ(lac_tagging_batch(handle, buff, queries.data(), query_num,
+                              results.data(), result_nums.data(), BENCH_MAX_RESULT), 0);
+
+  tag_t expected[BENCH_MAX_RESULT];
+
+  for(int q = 0; q < query_num; q++) {
+    lac_buff_reset(handle, buff);
+    int expected_num = lac_tagging(handle, buff, queries[q], expected, BENCH_MAX_RESULT);
+    ASSERT_EQ(result_nums[q], expected_num) << BENCH_LINES[q];
+
+    const tag_t* got = results.data() + q * BENCH_MAX_RESULT;
+
+    for(int i = 0; i < expected_num; i++) {
+      EXPECT_EQ(got[i].offset, expected[i].offset);
+      EXPECT_EQ(got[i].length, expected[i].length);
+      EXPECT_STREQ(got[i].type, expected[i].type);
+    }
+  }
+
+  lac_buff_destroy(handle, buff);
+  lac_destroy(handle);
+}
+
+/**
+ * 不同批大小下的吞吐量(queries/sec)
+ */
+TEST(LacTest, BATCH_THROUGHPUT) {
+  void* handle = lac_create("../../../../var/test/lac/conf");
+  ASSERT_TRUE(handle != NULL);
+  void* buff = lac_buff_create(handle);
+  ASSERT_TRUE(buff != NULL);
+
+  const int total = 512;
+  const int batch_sizes[] = {1, 4, 16, 64};
+
+  for(int batch_size : batch_sizes) {
+    std::vector<const char*> queries(batch_size);
+    std::vector<tag_t> results(batch_size * BENCH_MAX_RESULT);
+    std::vector<int> result_nums(batch_size);
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for(int done = 0; done < total; done += batch_size) {
+      for(int i = 0; i < batch_size; i++) {
+        queries[i] = BENCH_LINES[(done + i) % BENCH_LINES.size()].c_str();
+      }
+
+      lac_buff_reset(handle, buff);
+      ASSERT_EQ(lac_tagging_batch(handle, buff, queries.data(), batch_size,
+                                  results.data(), result_nums.data(), BENCH_MAX_RESULT), 0);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    LOG(INFO) << "batch_size " << batch_size << ": " << (total / seconds) << " queries/sec";
+  }
+
+  lac_buff_destroy(handle, buff);
+  lac_destroy(handle);
+}
@@ -72,4 +72,46 @@ TEST(LacTest, INIT) {
               << results[i].offset << " " << results[i].length;
   }
 
-}
\ No newline at end of file
+}
+
+/**
+ * 同一个lac_buff清空后复用，结果与新建的一致
+ */
+TEST(LacTest, REUSE_BUFF) {
+  LOG(INFO) << " reuse buff.";
+
+  void* handle = lac_create("../../../../var/test/lac/conf");
+  ASSERT_TRUE(handle != NULL);
+
+  std::vector<std::string> lines = {
+    "9月2日开始，北京中小学正式开学。",
+    "公交集团将启用新版行车时刻表，在早晚高峰时段增发3500车次。",
+    "我想明天下午去上海虹桥火车站"
+  };
+
+  void* reused = lac_buff_create(handle);
+  ASSERT_TRUE(reused != NULL);
+
+  tag_t results[100];
+  tag_t expected[100];
+
+  for(const std::string& line : lines) {
+    ASSERT_EQ(lac_buff_reset(handle, reused), 0);
+    int result_num = lac_tagging(handle, reused, line.c_str(), results, max_result_num);
+
+    void* fresh = lac_buff_create(handle);
+    int expected_num = lac_tagging(handle, fresh, line.c_str(), expected, max_result_num);
+    lac_buff_destroy(handle, fresh);
+
+    ASSERT_EQ(result_num, expected_num);
+
+    for(int i = 0; i < result_num; i++) {
+      EXPECT_EQ(results[i].offset, expected[i].offset);
+      EXPECT_EQ(results[i].length, expected[i].length);
+      EXPECT_STREQ(results[i].type, expected[i].type);
+    }
+  }
+
+  lac_buff_destroy(handle, reused);
+  lac_destroy(handle);
+}
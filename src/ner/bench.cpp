@@ -0,0 +1,151 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/ner/bench.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-20_10:12:35
+ * @brief
+ * Viterbi decoding benchmark: scalar vs. AVX2 kernels over label counts and sequence lengths.
+ **/
+
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <gflags/gflags.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glog/logging.h"
+#include "crfsuite.hpp"
+#include "StringUtils.hpp"
+
+using namespace std;
+using namespace chatopera::bot::crfsuite;
+
+DEFINE_string(labels, "8,32,64,128", "Label counts to sweep, comma separated.");
+DEFINE_string(lengths, "5,10,20,50", "Sequence lengths to sweep, comma separated.");
+DEFINE_int32(sequences, 2000, "Sequences tagged per kernel for each (labels, length).");
+DEFINE_string(workdir, "/tmp", "Directory to write the synthetic models.");
+
+/**
+ * 合成的标注序列：标签按相邻转移生成，每个位置的词与标签相关并带噪声
+ */
+static void synthesize(std::mt19937& rng,
+                       const int& labels,
+                       const int& length,
+                       ItemSequence& xseq,
+                       StringList& yseq) {
+  xseq.clear();
+  yseq.clear();
+  int y = rng() % labels;
+  string prev = "BOS";
+
+  for(int t = 0; t < length; t++) {
+    y = (y + rng() % 3) % labels;
+    int word = (rng() % 5 == 0) ? rng() % (labels * 4) : y * 4 + rng() % 4;
+    string w = std::to_string(word);
+
+    Item item;
+    item.push_back(Attribute("w=" + w));
+    item.push_back(Attribute("w[-1]=" + prev));
+    item.push_back(Attribute("w[-1]|w=" + prev + "|" + w));
+    xseq.push_back(item);
+    yseq.push_back("L" + std::to_string(y));
+    prev = w;
+  }
+}
+
+static vector<int> parse(const string& csv) {
+  vector<int> values;
+  vector<string> fields;
+  chatopera::utils::Split(csv, fields, ",");
+
+  for(const string& field : fields) {
+    values.push_back(atoi(field.c_str()));
+  }
+
+  return values;
+}
+
+static double tagAll(Tagger& tagger,
+                     const vector<ItemSequence>& xseqs,
+                     vector<StringList>& yseqs) {
+  yseqs.clear();
+  yseqs.reserve(xseqs.size());
+  auto start = std::chrono::steady_clock::now();
+
+  for(const ItemSequence& xseq : xseqs) {
+    yseqs.push_back(tagger.tag(xseq));
+  }
+
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+  // 解析命令行参数
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  // 初始化日志库
+  google::InitGoogleLogging(argv[0]);
+
+  const vector<int> labels = parse(FLAGS_labels);
+  const vector<int> lengths = parse(FLAGS_lengths);
+  int mismatches = 0;
+
+  printf("%8s %8s %14s %14s %8s %10s\n", "labels", "length", "scalar(us/seq)",
+         "auto(us/seq)", "speedup", "identical");
+
+  for(const int& L : labels) {
+    std::mt19937 rng(L);
+    Trainer trainer;
+    CHECK(trainer.select("averaged-perceptron", "crf1d")) << "Trainer select fails";
+    trainer.init();
+    trainer.set("max_iterations", "3");
+
+    for(int n = 0; n < 20 * L; n++) {
+      ItemSequence xseq;
+      StringList yseq;
+      synthesize(rng, L, 20, xseq, yseq);
+      trainer.append(xseq, yseq, 0);
+    }
+
+    const string model = FLAGS_workdir + "/crfsuitebench." + std::to_string(L) + ".model";
+    trainer.train(model, -1);
+
+    Tagger tagger;
+    CHECK(tagger.open(model)) << "Tagger open fails: " << model;
+
+    for(const int& T : lengths) {
+      vector<ItemSequence> xseqs(FLAGS_sequences);
+      StringList yseq;
+
+      for(ItemSequence& xseq : xseqs) {
+        synthesize(rng, L, T, xseq, yseq);
+      }
+
+      vector<StringList> scalar, simd;
+      crfsuite_set_viterbi_kernel(CRFSUITE_VITERBI_SCALAR);
+      tagAll(tagger, xseqs, scalar); // 预热
+      double scalarUs = tagAll(tagger, xseqs, scalar);
+      crfsuite_set_viterbi_kernel(CRFSUITE_VITERBI_AUTO);
+      tagAll(tagger, xseqs, simd);
+      double simdUs = tagAll(tagger, xseqs, simd);
+
+      bool identical = scalar == simd;
+      mismatches += identical ? 0 : 1;
+      printf("%8d %8d %14.2f %14.2f %7.2fx %10s\n", L, T, scalarUs / xseqs.size(),
+             simdUs / xseqs.size(), scalarUs / simdUs, identical ? "yes" : "NO");
+    }
+
+    remove(model.c_str());
+  }
+
+  return mismatches == 0 ? 0 : 1;
+}
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -392,6 +392,25 @@ bool Tagger::open(const std::string& name) {
   return true;
 }
 
+bool Tagger::open(const void* data, const size_t& size) {
+  int ret;
+
+  // Close the model if it is already opened.
+  this->close();
+
+  // Open the model in memory.
+  if ((ret = crfsuite_create_instance_from_memory(data, size, (void**)&model))) {
+    return false;
+  }
+
+  // Obtain the tagger interface.
+  if ((ret = model->get_tagger(model, &tagger))) {
+    throw std::runtime_error("Failed to obtain the tagger interface");
+  }
+
+  return true;
+}
+
 void Tagger::close() {
   if (tagger != NULL) {
     tagger->release(tagger);
@@ -435,11 +454,89 @@ StringList Tagger::labels() {
   return lseq;
 }
 
+StringList Tagger::attributes() {
+  int ret;
+  StringList aseq;
+  crfsuite_dictionary_t *attrs = NULL;
+
+  if (model == NULL) {
+    throw std::invalid_argument("The tagger is not opened");
+  }
+
+  if ((ret = model->get_attrs(model, &attrs))) {
+    throw std::runtime_error("Failed to obtain the dictionary interface for attributes");
+  }
+
+  aseq.reserve(attrs->num(attrs));
+
+  for (int i = 0; i < attrs->num(attrs); ++i) {
+    const char *attr = NULL;
+
+    if (attrs->to_string(attrs, i, &attr) != 0) {
+      attrs->release(attrs);
+      throw std::runtime_error("Failed to convert an attribute identifier to string.");
+    }
+
+    aseq.push_back(attr);
+    attrs->free(attrs, attr);
+  }
+
+  attrs->release(attrs);
+  return aseq;
+}
+
 StringList Tagger::tag(const ItemSequence& xseq) {
   set(xseq);
   return viterbi();
 }
 
+StringList Tagger::tag(const int* aids, const size_t* offsets, const size_t& length) {
+  set(aids, offsets, length);
+  return viterbi();
+}
+
+void Tagger::set(const int* aids, const size_t* offsets, const size_t& length) {
+  // tagger->set() only reads the instance while it runs, so the instance
+  // borrows buffers that are reused by later calls on this thread.
+  static thread_local std::vector<crfsuite_attribute_t> contents;
+  static thread_local std::vector<crfsuite_item_t> items;
+
+  if (model == NULL || tagger == NULL) {
+    throw std::invalid_argument("The tagger is not opened");
+  }
+
+  const size_t total = length > 0 ? offsets[length] : 0;
+
+  if (contents.size() < total) {
+    contents.resize(total);
+  }
+
+  if (items.size() < length) {
+    items.resize(length);
+  }
+
+  for (size_t i = 0; i < total; ++i) {
+    contents[i].aid = aids[i];
+    contents[i].value = 1.0;
+  }
+
+  for (size_t t = 0; t < length; ++t) {
+    items[t].num_contents = offsets[t + 1] - offsets[t];
+    items[t].cap_contents = items[t].num_contents;
+    items[t].contents = contents.data() + offsets[t];
+  }
+
+  crfsuite_instance_t _inst;
+  crfsuite_instance_init(&_inst);
+  _inst.num_items = length;
+  _inst.cap_items = length;
+  _inst.items = items.data();
+
+  if (tagger->set(tagger, &_inst)) {
+    throw std::runtime_error("Failed to set the instance to the tagger.");
+  }
+}
+
 void Tagger::set(const ItemSequence& xseq) {
   int ret;
   StringList yseq;
@@ -669,6 +766,95 @@ error_exit:
 }
 
 
+TaggerPool::TaggerPool() : created(0) {
+}
+
+TaggerPool::~TaggerPool() {
+  this->close();
+}
+
+bool TaggerPool::open(const std::string& name) {
+  this->close();
+
+  if (!file.open(name)) {
+    return false;
+  }
+
+  Tagger* tagger = new Tagger();
+
+  if (!tagger->open(file.data(), file.size())) {
+    delete tagger;
+    file.close();
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  idle.push_back(tagger);
+  created = 1;
+  return true;
+}
+
+void TaggerPool::close() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (size_t i = 0; i < idle.size(); ++i) {
+    delete idle[i];
+  }
+
+  idle.clear();
+  created = 0;
+  file.close();
+}
+
+Tagger* TaggerPool::acquire() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!file.isOpen()) {
+      throw std::invalid_argument("The tagger pool is not opened");
+    }
+
+    if (!idle.empty()) {
+      Tagger* tagger = idle.back();
+      idle.pop_back();
+      return tagger;
+    }
+
+    ++created;
+  }
+
+  // Opening a tagger only parses the model header and builds the transition
+  // scores; the mapped model itself is not copied.
+  Tagger* tagger = new Tagger();
+
+  if (!tagger->open(file.data(), file.size())) {
+    delete tagger;
+    std::lock_guard<std::mutex> lock(mutex);
+    --created;
+    throw std::runtime_error("Failed to open a tagger on the mapped model");
+  }
+
+  return tagger;
+}
+
+void TaggerPool::release(Tagger* tagger) {
+  if (tagger == NULL) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  idle.push_back(tagger);
+}
+
+size_t TaggerPool::size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return created;
+}
+
+size_t TaggerPool::model_size() const {
+  return file.size();
+}
+
 std::string version() {
   return CRFSUITE_VERSION;
 }
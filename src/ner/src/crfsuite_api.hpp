@@ -35,8 +35,11 @@
 #include <string>
 #include <stdexcept>
 #include <vector>
+#include <mutex>
 #include <stdio.h>
 
+#include "MmapFile.hpp"
+
 #ifndef __CRFSUITE_H__
 
 #ifdef  __cplusplus
@@ -348,6 +351,17 @@ class Tagger {
    */
   bool open(const std::string& name);
 
+  /**
+   * Open a model in memory.
+   *  The model is read in place; the memory must outlive the tagger.
+   *  @param  data        The pointer to the model.
+   *  @param  size        The size of the model in bytes.
+   *  @return bool        \c true if the model is successfully opened,
+   *                      \c false otherwise.
+   *  @throw  std::runtime_error      An internal error in the model.
+   */
+  bool open(const void* data, const size_t& size);
+
   /**
    * Close the model.
    */
@@ -361,6 +375,15 @@ class Tagger {
    */
   StringList labels();
 
+  /**
+   * Obtain the list of attributes.
+   *  The position of an attribute in the list is its identifier.
+   *  @return StringList  The list of attributes in the model.
+   *  @throw  std::invalid_argument   A model is not opened.
+   *  @throw  std::runtime_error      An internal error.
+   */
+  StringList attributes();
+
   /**
    * Predict the label sequence for the item sequence.
    *  This function calls set() and viterbi() functions to obtain the
@@ -382,6 +405,30 @@ class Tagger {
    */
   void set(const ItemSequence& xseq);
 
+  /**
+   * Predict the label sequence for attribute identifiers.
+   *  @param  aids        The attribute identifiers of all items.
+   *  @param  offsets     Item t has aids[offsets[t]] .. aids[offsets[t+1] - 1],
+   *                      each with value 1.
+   *  @param  length      The number of items.
+   *  @return StringList  The label sequence predicted.
+   *  @throw  std::invalid_argument   A model is not opened.
+   *  @throw  std::runtime_error      An internal error.
+   */
+  StringList tag(const int* aids, const size_t* offsets, const size_t& length);
+
+  /**
+   * Set an item sequence of attribute identifiers.
+   *  The instance is built on buffers of the calling thread, which are
+   *  reused by later calls.
+   *  @param  aids        The attribute identifiers of all items.
+   *  @param  offsets     Item t has aids[offsets[t]] .. aids[offsets[t+1] - 1].
+   *  @param  length      The number of items.
+   *  @throw  std::invalid_argument   A model is not opened.
+   *  @throw  std::runtime_error      An internal error.
+   */
+  void set(const int* aids, const size_t* offsets, const size_t& length);
+
   /**
    * Find the Viterbi label sequence for the item sequence.
    *  @return StringList  The label sequence predicted.
@@ -408,6 +455,82 @@ class Tagger {
   double marginal(const std::string& y, const int t);
 };
 
+/**
+ * A pool of taggers sharing one read-only model.
+ *  The model file is memory-mapped once. Every tagger reads the mapping in
+ *  place and owns only its lattice and score buffers, so concurrent threads
+ *  tag in parallel without sharing mutable state. Idle taggers are reused.
+ */
+class TaggerPool {
+ protected:
+  chatopera::utils::MmapFile file;
+  std::mutex mutex;
+  std::vector<Tagger*> idle;
+  size_t created;
+
+ public:
+  TaggerPool();
+  virtual ~TaggerPool();
+
+  /**
+   * Map a model file and open the first tagger.
+   *  @param  name        The file name of the model file.
+   *  @return bool        \c true if the model is successfully opened.
+   */
+  bool open(const std::string& name);
+
+  /**
+   * Release all taggers and unmap the model.
+   *  No tagger may be checked out.
+   */
+  void close();
+
+  /**
+   * Check out an idle tagger, or open a new one on the mapped model.
+   *  @throw  std::invalid_argument   The pool is not opened.
+   *  @throw  std::runtime_error      An internal error in the model.
+   */
+  Tagger* acquire();
+
+  /**
+   * Return a tagger checked out by acquire().
+   */
+  void release(Tagger* tagger);
+
+  /**
+   * The number of taggers opened so far.
+   */
+  size_t size();
+
+  /**
+   * The size of the mapped model in bytes.
+   */
+  size_t model_size() const;
+};
+
+/**
+ * Check out a tagger for the current scope.
+ */
+class ScopedTagger {
+ protected:
+  TaggerPool& pool;
+  Tagger* tagger;
+
+ public:
+  explicit ScopedTagger(TaggerPool& pool) : pool(pool), tagger(pool.acquire()) {}
+  ~ScopedTagger() {
+    pool.release(tagger);
+  }
+
+  Tagger* operator->() const {
+    return tagger;
+  }
+
+ private:
+  ScopedTagger(const ScopedTagger&);
+  ScopedTagger& operator=(const ScopedTagger&);
+};
+
 /**
  * Obtain the version number of the library.
  *  @return std::string     The version string.
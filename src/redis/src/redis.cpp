@@ -16,10 +16,14 @@
 #include "redis.h"
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
+#include <strings.h>
+#include <stdlib.h>
 #include <sstream>
 #include <glog/logging.h>
 #include <boost/format.hpp>
+#include <stdexcept>
 
 // REDIS_REPLY 响应的类型 type
 // "REDIS_REPLY_STRING 1";
@@ -34,15 +38,50 @@ namespace redis {
 
 Redis* Redis::_instance = NULL;
 
-Redis::Redis() {
-  _c = NULL;
+/**
+ * 将响应转化为字符串，二进制安全
+ */
+inline string reply_to_string(const redisReply* reply) {
+  switch(reply->type) {
+    case REDIS_REPLY_STRING:
+    case REDIS_REPLY_STATUS:
+      return string(reply->str, reply->len);
+
+    case REDIS_REPLY_INTEGER:
+      return std::to_string(reply->integer);
+
+    default:
+      return "";
+  }
+};
+
+/**
+ * 将参数列表转化为 hiredis 的 argv 格式
+ */
+inline void build_argv(const vector<string>& argv,
+                       vector<const char*>& args,
+                       vector<size_t>& lens) {
+  args.reserve(argv.size());
+  lens.reserve(argv.size());
+
+  for(const string& arg : argv) {
+    args.push_back(arg.data());
+    lens.push_back(arg.size());
+  }
+};
+
+Redis::Redis() : _port(6379), _db(0), _poolsize(8), _created(0) {
 };
 
 Redis::~Redis() {
-  if(_c != NULL) {
-    redisFree(_c);//析构函数释放资源
-    VLOG(2) << "[redis] free redis connection ";;
+  std::lock_guard<std::mutex> lock(_pool_lock);
+
+  for(redisContext* c : _idle) {
+    redisFree(c);//析构函数释放资源
   }
+
+  _idle.clear();
+  VLOG(2) << "[redis] free redis connections ";
 };
 
 /**
@@ -56,89 +95,290 @@ Redis* Redis::getInstance() {
 }
 
 /**
- * 初始化Redis连接
+ * 初始化Redis连接池
  */
 bool Redis::init(const string& host,
                  const int& port,
                  const int& db,
-                 const string& pass) {
+                 const string& pass,
+                 const int& poolsize) {
   // 连接信息
   _host = host;
   _port = port;
   _db = db;
   _pass = pass;
+  _poolsize = poolsize > 0 ? poolsize : 1;
+  VLOG(3) << "[init] ip: " << _host << ", port: " << port << ", db: " << db << ", pass: *****, poolsize: " << _poolsize;
 
-  struct timeval timeout = { 1, 500000 }; // 1.5 seconds 设置连接等待时间
-  char ip[255];
-  strcpy(ip, _host.c_str());
-  VLOG(3) << "[init] ip: " << _host << ", port: " << port << ", db: " << db << ", pass: *****";
+  // 重新初始化时释放已有的空闲连接
+  {
+    std::lock_guard<std::mutex> lock(_pool_lock);
 
-  _c = redisConnectWithTimeout(ip, _port, timeout);//建立连接
+    for(redisContext* c : _idle) {
+      redisFree(c);
+    }
 
-  if (_c->err) {
-    VLOG(2) << "Redis : Connection error: " << _c->errstr;
+    _created -= _idle.size();
+    _idle.clear();
+  }
+
+  // 建立第一个连接，检查配置
+  redisContext* c = acquire();
+
+  if(c == NULL) {
     return false;
   }
 
+  release(c);
+  return true;
+};
+
+/**
+ * 建立新连接，完成认证和选择db
+ */
+redisContext* Redis::connect() const {
+  struct timeval timeout = { 1, 500000 }; // 1.5 seconds 设置连接等待时间
+  redisContext* c = redisConnectWithTimeout(_host.c_str(), _port, timeout);//建立连接
+
+  if(c == NULL) {
+    VLOG(2) << "Redis : Connection error: can not allocate redis context";
+    return NULL;
+  }
+
+  if (c->err) {
+    VLOG(2) << "Redis : Connection error: " << c->errstr;
+    redisFree(c);
+    return NULL;
+  }
+
   // 认证
   if(!_pass.empty()) {
     redisReply *reply;
-    reply = (redisReply *)redisCommand(_c, "AUTH %s", _pass.c_str());
+    reply = (redisReply *)redisCommand(c, "AUTH %s", _pass.c_str());
 
-    if (reply->type == REDIS_REPLY_ERROR) {
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
       VLOG(2) << "[init] auth failure.";
-      freeReplyObject(reply);
-      return false;
+
+      if(reply != NULL) freeReplyObject(reply);
+
+      redisFree(c);
+      return NULL;
     } else {
       freeReplyObject(reply);
     }
   }
 
-  // 选择 db
-  redisReply *reply;
-
   /* Switch to specific DB */
-  reply =  (redisReply *) redisCommand(_c, "SELECT %s", std::to_string(_db).c_str());
+  redisReply *reply = (redisReply *) redisCommand(c, "SELECT %d", _db);
+
+  if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+    VLOG(2) << "[init] select db failure.";
+
+    if(reply != NULL) freeReplyObject(reply);
+
+    redisFree(c);
+    return NULL;
+  }
+
   freeReplyObject(reply);
+  return c;
+};
 
-  return true;
+/**
+ * 从连接池获取连接，连接数达到上限时等待归还
+ */
+redisContext* Redis::acquire() const {
+  {
+    std::unique_lock<std::mutex> lock(_pool_lock);
+    _pool_available.wait(lock, [this] { return !_idle.empty() || _created < _poolsize; });
+
+    if(!_idle.empty()) {
+      redisContext* c = _idle.back();
+      _idle.pop_back();
+      return c;
+    }
+
+    _created++;
+  }
+
+  redisContext* c = connect();
+
+  if(c == NULL) {
+    std::lock_guard<std::mutex> lock(_pool_lock);
+    _created--;
+    _pool_available.notify_one();
+  }
+
+  return c;
+};
+
+/**
+ * 归还连接，出错的连接直接释放，下次使用时重新建立
+ */
+void Redis::release(redisContext* c) const {
+  std::lock_guard<std::mutex> lock(_pool_lock);
+
+  if(c->err) {
+    VLOG(2) << "[redis] discard broken connection: " << c->errstr;
+    redisFree(c);
+    _created--;
+  } else {
+    _idle.push_back(c);
+  }
+
+  _pool_available.notify_one();
+};
+
+/**
+ * 连接断开后可以重发的命令：重复执行与执行一次的结果相同
+ * INCR、RPUSH、RPOP 等命令可能已经在服务端执行，不能重发
+ */
+inline bool is_idempotent(const char* name, size_t len) {
+  static const char* commands[] = {"GET", "MGET", "SET", "SETEX", "DEL", "EXPIRE", "TTL",
+                                   "LRANGE", "SCAN", "EXISTS"
+                                  };
+
+  for(const char* command : commands) {
+    if(strlen(command) == len && strncasecmp(command, name, len) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+};
+
+/**
+ * 在连接上发送格式化后的命令并读取响应
+ * 命令完整写出之前出错时 sent 为false，此时服务端不会执行该命令
+ */
+inline redisReply* roundtrip(redisContext* c, const char* cmd, size_t len, bool& sent) {
+  sent = false;
+
+  if(redisAppendFormattedCommand(c, cmd, len) != REDIS_OK) {
+    return NULL;
+  }
+
+  int done = 0;
+
+  do {
+    if(redisBufferWrite(c, &done) != REDIS_OK) {
+      return NULL;
+    }
+  } while(!done);
+
+  sent = true;
+  void* reply = NULL;
+
+  if(redisGetReply(c, &reply) != REDIS_OK) {
+    return NULL;
+  }
+
+  return (redisReply*)reply;
+};
+
+/**
+ * 执行格式化后的命令
+ * 发送前连接出错时重连并重试一次；已经发送后连接断开，只重试幂等的命令
+ */
+redisReply* Redis::execute(const char* cmd, size_t len, bool idempotent) const {
+  for(int attempt = 0; attempt < 2; attempt++) {
+    redisContext* c = acquire();
+
+    if(c == NULL) {
+      continue;
+    }
+
+    bool sent = false;
+    redisReply* reply = roundtrip(c, cmd, len, sent);
+    release(c);
+
+    if(reply != NULL) {
+      return reply;
+    }
+
+    if(sent && !idempotent) {
+      VLOG(2) << "[redis] reply is NULL after the command was sent, maybe redis server is down, no retry";
+      return NULL;
+    }
+
+    VLOG(2) << "[redis] reply is NULL, maybe redis server is down, retry: " << attempt;
+  }
+
+  return NULL;
+};
+
+/**
+ * 执行命令
+ */
+redisReply* Redis::command(const vector<string>& argv) const {
+  vector<const char*> args;
+  vector<size_t> lens;
+  build_argv(argv, args, lens);
+
+  char* cmd = NULL;
+  int len = redisFormatCommandArgv(&cmd, (int)args.size(), args.data(), lens.data());
+
+  if(len < 0) {
+    return NULL;
+  }
+
+  redisReply* reply = execute(cmd, len, !argv.empty() && is_idempotent(argv[0].data(), argv[0].size()));
+  free(cmd);
+  return reply;
+};
+
+/**
+ * 按格式执行命令，%b 参数二进制安全
+ */
+redisReply* Redis::commandf(const char* format, ...) const {
+  va_list ap;
+  va_start(ap, format);
+  char* cmd = NULL;
+  int len = redisvFormatCommand(&cmd, format, ap);
+  va_end(ap);
+
+  if(len < 0) {
+    return NULL;
+  }
+
+  redisReply* reply = execute(cmd, len, is_idempotent(format, strcspn(format, " ")));
+  free(cmd);
+  return reply;
 };
 
 /**
  * 设置过期
  */
-void Redis::expire(const string& key, unsigned int seconds) {
+void Redis::expire(const string& key, unsigned int seconds) const {
   VLOG(4) << __func__ << " key " << key << " " << seconds;
-  redisCommand(_c, "EXPIRE %s %s", key.c_str(), std::to_string(seconds).c_str());
+  redisReply* reply = command({"EXPIRE", key, std::to_string(seconds)});
+
+  if(reply != NULL) freeReplyObject(reply);
 };
 
 
 //向数据库写入string类型数据
-int Redis::set(string key, string value) {
-  VLOG(4) << __func__ << key << " = " << value;
+int Redis::set(const string& key, const string& value) const {
+  return set(key, value.data(), value.size());
+};
 
-  if(_c == NULL || _c->err) { //int err; /* Error flags, 错误标识，0表示无错误 */
-    VLOG(2) << "Redis init Error !!!";;
-    return -1;
-  }
+/**
+ * 写入二进制数据
+ */
+int Redis::set(const string& key, const char* value, size_t len) const {
+  VLOG(4) << __func__ << " key " << key << ", len " << len;
 
-  redisReply *reply;
-  reply = (redisReply *)redisCommand(_c, "SET %s %s", key.c_str(), value.c_str()); //执行写入命令
-  VLOG(4) << "set string type = " << reply->type;; //获取响应的枚举类型
+  redisReply *reply = commandf("SET %b %b", key.data(), key.size(), value, len); //执行写入命令
   int result = 0;
 
   if(reply == NULL) {
-    redisFree(_c);
-    _c = NULL;
-    result = -1;
-    VLOG(4) << "set string fail : reply->str = NULL ";;
-    //pthread_spin_unlock(&_c_flock);
+    VLOG(4) << "set string fail : reply->str = NULL ";
     return -1;
-  } else if(strcmp(reply->str, "OK") == 0) { //根据不同的响应类型进行判断获取成功与否
+  } else if(reply->type == REDIS_REPLY_STATUS && strcmp(reply->str, "OK") == 0) { //根据不同的响应类型进行判断获取成功与否
     result = 1;
   } else {
     result = -1;
-    VLOG(4) << "set string fail :" << reply->str;;
+    VLOG(4) << "set string fail :" << reply->type;
   }
 
   freeReplyObject(reply);//释放响应信息
@@ -146,52 +386,140 @@ int Redis::set(string key, string value) {
   return result;
 };
 
+/**
+ * 写入数据并设置过期时间，一次往返
+ */
+bool Redis::setex(const string& key, const string& value, unsigned int seconds) const {
+  return setex(key, value.data(), value.size(), seconds);
+};
+
+bool Redis::setex(const string& key, const char* value, size_t len, unsigned int seconds) const {
+  VLOG(4) << __func__ << " key " << key << ", len " << len << ", seconds " << seconds;
+
+  redisReply *reply = commandf("SETEX %b %u %b", key.data(), key.size(), seconds, value, len);
+
+  if(reply == NULL) {
+    return false;
+  }
+
+  bool result = reply->type == REDIS_REPLY_STATUS;
+  freeReplyObject(reply);
+  return result;
+};
+
 /**
  * 删除KEY
  */
-void Redis::del(const string& key) {
+void Redis::del(const string& key) const {
   VLOG(4) << __func__ << " key " << key;
-  redisCommand(_c, "DEL %s", key.c_str());
+  redisReply* reply = command({"DEL", key});
+
+  if(reply != NULL) freeReplyObject(reply);
 }
 
 //从数据库读出string类型数据
-string Redis::get(string key) {
-  if(_c == NULL || _c->err) {
-    VLOG(4) << "Redis init Error !!!";;
-    return NULL;
+string Redis::get(const string& key) const {
+  redisReply *reply = commandf("GET %b", key.data(), key.size());
+
+  if(reply == NULL) {
+    VLOG(2) << "ERROR getString: reply = NULL!!!!!!!!!!!! maybe redis server is down";
+    return "";
   }
 
-  redisReply *reply;
-  reply = (redisReply *)redisCommand(_c, "GET %s", key.c_str());
-  VLOG(4) << "get string type = " << reply->type;
+  // key not exist 时返回空字符串
+  string result = reply_to_string(reply);
+  freeReplyObject(reply);
+  return result;
+};
+
+/**
+ * 零拷贝读取，reader 返回值作为结果，reader 中不可保存指针
+ */
+bool Redis::get(const string& key, const std::function<bool(const char*, size_t)>& reader) const {
+  redisReply *reply = commandf("GET %b", key.data(), key.size());
 
   if(reply == NULL) {
-    redisFree(_c);
-    _c = NULL;
-    VLOG(2) << "ERROR getString: reply = NULL!!!!!!!!!!!! maybe redis server is down";;
-    return NULL;
-  } else if(reply->len <= 0) {
-    // key not exist
-    freeReplyObject(reply);
-    return "";
-  } else {
-    stringstream ss;
-    ss << reply->str;
-    freeReplyObject(reply);
-    return ss.str();
+    VLOG(2) << "ERROR getString: reply = NULL!!!!!!!!!!!! maybe redis server is down";
+    return false;
+  }
+
+  bool result = false;
+
+  if(reply->type == REDIS_REPLY_STRING && reply->len > 0) {
+    result = reader(reply->str, reply->len);
   }
+
+  freeReplyObject(reply);
+  return result;
 };
 
+/**
+ * 批量读取，不存在的KEY对应空字符串
+ */
+bool Redis::mget(const vector<string>& keys, vector<string>& values) const {
+  values.clear();
 
-//从数据库读出string类型数据
-signed int Redis::ttl(string key) {
-  if(_c == NULL || _c->err) {
-    VLOG(4) << "Redis init Error !!!";;
-    return NULL;
+  if(keys.empty()) {
+    return true;
+  }
+
+  vector<string> argv;
+  argv.reserve(keys.size() + 1);
+  argv.push_back("MGET");
+  argv.insert(argv.end(), keys.begin(), keys.end());
+
+  redisReply *reply = command(argv);
+
+  if(reply == NULL) {
+    return false;
+  } else if(reply->type != REDIS_REPLY_ARRAY) {
+    freeReplyObject(reply);
+    return false;
   }
 
-  redisReply *reply;
-  reply = (redisReply *)redisCommand(_c, "TTL %s", key.c_str());
+  values.reserve(reply->elements);
+
+  for(size_t i = 0; i < reply->elements; i++) {
+    values.push_back(reply_to_string(reply->element[i]));
+  }
+
+  freeReplyObject(reply);
+  return true;
+};
+
+bool Redis::scan(const string& pattern, vector<string>& keys, const size_t& count) const {
+  keys.clear();
+  string cursor("0");
+
+  do {
+    redisReply *reply = command({"SCAN", cursor, "MATCH", pattern, "COUNT", std::to_string(count)});
+
+    if(reply == NULL) {
+      return false;
+    } else if(reply->type != REDIS_REPLY_ARRAY
+              || reply->elements != 2
+              || reply->element[1]->type != REDIS_REPLY_ARRAY) {
+      freeReplyObject(reply);
+      return false;
+    }
+
+    cursor = reply_to_string(reply->element[0]);
+    const redisReply* batch = reply->element[1];
+
+    for(size_t i = 0; i < batch->elements; i++) {
+      keys.push_back(reply_to_string(batch->element[i]));
+    }
+
+    freeReplyObject(reply);
+  } while(cursor != "0" && !cursor.empty());
+
+  return true;
+};
+
+
+//从数据库读出string类型数据
+signed int Redis::ttl(const string& key) const {
+  redisReply *reply = command({"TTL", key});
 
   if(reply == NULL) {
     VLOG(2) << __func__ << " reply is NULL";
@@ -199,95 +527,71 @@ signed int Redis::ttl(string key) {
   } else if (reply->type == REDIS_REPLY_ERROR) {
     VLOG(3) << __func__ << "Error reading key: " << key;
     freeReplyObject(reply);
-    return;
+    return -2;
   } else {
-    return reply->integer;
+    signed int result = (signed int) reply->integer;
+    freeReplyObject(reply);
+    return result;
   }
 };
 
 
 // 向数据库写入vector（list）类型数据
-int Redis::setList(const string& key, const vector<string>& value) {
-  if(_c == NULL || _c->err) {
-    VLOG(4) << "Redis init Error !!!";;
-    return -1;
+int Redis::setList(const string& key, const vector<string>& value) const {
+  if(value.empty()) {
+    return 1;
   }
 
-  redisReply *reply;
+  vector<string> argv;
+  argv.reserve(value.size() + 2);
+  argv.push_back("RPUSH");
+  argv.push_back(key);
+  argv.insert(argv.end(), value.begin(), value.end());
 
-  int valueSize = value.size();
-  int result = 0;
-
-  for(int i = 0; i < valueSize; i++) {
-    reply = (redisReply*)redisCommand(_c, "RPUSH %s %s", key.c_str(), value.at(i).c_str());
-    VLOG(4) << "set list type = " << reply->type << " ";
-    int old = reply->integer;
-
-    if(reply == NULL) {
-      redisFree(_c);
-      _c = NULL;
-      result = -1;
-      VLOG(4) << "set list fail : reply->str = NULL ";;
-      //pthread_spin_unlock(&_c_flock);
-      return -1;
-    } else if(reply->integer == old++) {
-      result = 1;
-      VLOG(4) << "rpush list ok";;
-      continue;
-    } else {
-      result = -1;
-      VLOG(4) << "set list fail ,reply->integer = " << reply->integer;;
-      return -1;
-    }
+  redisReply *reply = command(argv);
 
+  if(reply == NULL) {
+    VLOG(4) << "set list fail : reply->str = NULL ";
+    return -1;
+  } else if(reply->type != REDIS_REPLY_INTEGER) {
+    VLOG(4) << "set list fail, reply->type = " << reply->type;
+    freeReplyObject(reply);
+    return -1;
   }
 
   freeReplyObject(reply);
-  VLOG(4) << "set List  success";;
-  return result;
+  VLOG(4) << "set List  success";
+  return 1;
 };
 
 //从数据库读出vector（list）类型数据
-vector<string> Redis::list(const string& key) {
+vector<string> Redis::list(const string& key) const {
+  vector<string> result;
+  redisReply *reply = command({"LRANGE", key, "0", "-1"});
 
-  if(_c == NULL || _c->err) {
-    VLOG(2) << "Redis init Error !!!";;
-    return vector<string> {}; //返回空的向量
+  if(reply == NULL) {
+    VLOG(2) << "Redis init Error !!!";
+    return result; //返回空的向量
   }
 
-  redisReply *reply;
-  reply = (redisReply*)redisCommand(_c, "LLEN %s", key.c_str());
-  int valueSize = reply->integer;
-  VLOG(4) << "List size is :" << reply->integer;;
+  if(reply->type == REDIS_REPLY_ARRAY) {
+    VLOG(4) << "get list size = " << reply->elements; //对于数组类型可以用elements元素获取数组长度
 
-  reply = (redisReply*)redisCommand(_c, "LRANGE %s %d %d", key.c_str(), 0, valueSize - 1);
-  VLOG(4) << "get list type = " << reply->type;;
-  VLOG(4) << "get list size = " << reply->elements;; //对于数组类型可以用elements元素获取数组长度
-
-  redisReply** replyVector = reply->element;//获取数组指针
-  vector<string> result;
-
-  for(int i = 0; i < valueSize; i++) {
-    string temp = (*replyVector)->str; //遍历redisReply*数组,存入vector向量
-    result.push_back(temp);
-    replyVector++;
+    for(size_t i = 0; i < reply->elements; i++) {
+      result.push_back(reply_to_string(reply->element[i]));
+    }
   }
 
-  VLOG(4) << "result size:" << result.size();;
+  freeReplyObject(reply);
+  VLOG(4) << "result size:" << result.size();
   return result;
 };
 
-bool Redis::rpush(const string& key, const string& value) {
-  if(_c == NULL || _c->err) {
-    VLOG(2) << "Redis init Error !!!";;
-    return false;
-  }
-
-  redisReply *reply;
-  reply = (redisReply*)redisCommand(_c, "RPUSH %s %s", key.c_str(), value.c_str());
+bool Redis::rpush(const string& key, const string& value) const {
+  redisReply *reply = command({"RPUSH", key, value});
 
   if (reply == NULL) {
-    VLOG(3) << "redisCommand reply is NULL: " << _c->errstr;
+    VLOG(3) << "redisCommand reply is NULL";
     return false;
   } else if(reply->type == REDIS_REPLY_ERROR) {
     VLOG(3) << "Command Error: " << reply->str;
@@ -295,33 +599,77 @@ bool Redis::rpush(const string& key, const string& value) {
     return false;
   }
 
+  freeReplyObject(reply);
   return true;
 };
 
-string Redis::rpop(const string& key) {
-  if(_c == NULL || _c->err) {
-    VLOG(2) << "Redis init Error !!!";;
-    throw std::runtime_error("Null Redis Connection.");
-  }
-
-  redisReply *reply;
-  reply = (redisReply*)redisCommand(_c, "RPOP %s", key.c_str());
+string Redis::rpop(const string& key) const {
+  redisReply *reply = command({"RPOP", key});
 
   if (reply == NULL) {
-    VLOG(3) << "redisCommand reply is NULL: " << _c->errstr;
+    VLOG(3) << "redisCommand reply is NULL";
     return "";
   } else if(reply->type == REDIS_REPLY_ERROR) {
     VLOG(3) << "Command Error: " << reply->str;
     freeReplyObject(reply);
     return "";
-  } else {
-    string temp(reply->str);
-    return temp;
   }
 
-  return "";
+  string result = reply_to_string(reply);
+  freeReplyObject(reply);
+  return result;
 };
 
+/**
+ * 管道：在同一个连接上连续发送多条命令，再依次读取响应
+ * 任何一条命令出错时返回false，replies中对应位置为空字符串
+ */
+bool Redis::pipeline(const vector<vector<string> >& commands, vector<string>& replies) const {
+  replies.clear();
+
+  if(commands.empty()) {
+    return true;
+  }
+
+  redisContext* c = acquire();
+
+  if(c == NULL) {
+    return false;
+  }
+
+  for(const vector<string>& argv : commands) {
+    vector<const char*> args;
+    vector<size_t> lens;
+    build_argv(argv, args, lens);
+    redisAppendCommandArgv(c, (int)args.size(), args.data(), lens.data());
+  }
+
+  bool result = true;
+  replies.reserve(commands.size());
+
+  for(size_t i = 0; i < commands.size(); i++) {
+    redisReply* reply = NULL;
+
+    if(redisGetReply(c, (void**)&reply) != REDIS_OK || reply == NULL) {
+      // 连接出错，release时释放该连接
+      VLOG(2) << __func__ << " lost connection: " << c->errstr;
+      result = false;
+      break;
+    }
+
+    if(reply->type == REDIS_REPLY_ERROR) {
+      VLOG(3) << __func__ << " command error: " << reply->str;
+      result = false;
+    }
+
+    replies.push_back(reply_to_string(reply));
+    freeReplyObject(reply);
+  }
+
+  release(c);
+  replies.resize(commands.size());
+  return result;
+};
 
 
 } // namespace redis
@@ -19,6 +19,9 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <hiredis/hiredis.h>
 
 using namespace std;
@@ -26,38 +29,68 @@ using namespace std;
 namespace chatopera {
 namespace redis {
 
+/**
+ * Redis客户端
+ * 内部维护一个连接池，每次命令从池中取出一个连接，用完归还，可被多个线程同时使用。
+ * 连接出错时丢弃该连接并重新建立。
+ */
 class Redis {
  public:
   static Redis* getInstance();
 
-  void expire(const string& key, unsigned int seconds);
-  signed int ttl(string key);
-
-  int set(string key, string value);
-  string get(string key);
-
-  int setList(const string& key, const vector<string>& value);
-  vector<string> list(const string& key);
-  bool rpush(const string& key, const string& value);
-  string rpop(const string& key);
-  void del(const string& key);
+  void expire(const string& key, unsigned int seconds) const;
+  signed int ttl(const string& key) const;
+
+  int set(const string& key, const string& value) const;
+  int set(const string& key, const char* value, size_t len) const;
+  bool setex(const string& key, const string& value, unsigned int seconds) const;
+  bool setex(const string& key, const char* value, size_t len, unsigned int seconds) const;
+  string get(const string& key) const;
+  // 零拷贝读取：直接在响应缓冲区上调用 reader，KEY不存在时返回false
+  bool get(const string& key, const std::function<bool(const char*, size_t)>& reader) const;
+  bool mget(const vector<string>& keys, vector<string>& values) const;
+  // 用SCAN遍历匹配pattern的KEY，不阻塞Redis，结果可能有重复
+  bool scan(const string& pattern, vector<string>& keys, const size_t& count = 1000) const;
+
+  int setList(const string& key, const vector<string>& value) const;
+  vector<string> list(const string& key) const;
+  bool rpush(const string& key, const string& value) const;
+  string rpop(const string& key) const;
+  void del(const string& key) const;
+
+  // 批量发送命令，一次网络往返，每条命令为参数列表，如 {"SET", key, value}
+  bool pipeline(const vector<vector<string> >& commands, vector<string>& replies) const;
 
   bool init(const string& host,
             const int& port = 6379,
             const int& db = 0,
-            const string& pass = "");
+            const string& pass = "",
+            const int& poolsize = 8);
 
  private: // constructor
   Redis();
   ~Redis();
 
  private:
+  redisContext* connect() const;
+  redisContext* acquire() const;
+  void release(redisContext* c) const;
+  redisReply* execute(const char* cmd, size_t len, bool idempotent) const;
+  redisReply* command(const vector<string>& argv) const;
+  redisReply* commandf(const char* format, ...) const;
+
   string _host;
   int _port;
   int _db;
   string _pass;
+  size_t _poolsize;
   static Redis* _instance;
-  redisContext *_c;
+
+  // 连接池
+  mutable std::mutex _pool_lock;
+  mutable std::condition_variable _pool_available;
+  mutable vector<redisContext*> _idle;
+  mutable size_t _created;
 };
 
 
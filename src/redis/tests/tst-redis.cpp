@@ -3,6 +3,10 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <string.h>
 #include "redis.h"
 
 using namespace chatopera::redis;
@@ -75,4 +79,144 @@ TEST(RedisTest, DEL) {
   EXPECT_TRUE(redis->init("192.168.2.219", 8050, 6, "myredispass2025")) << "Fail to init.";
 
   redis->del("foo");
-}
\ No newline at end of file
+}
+TEST(RedisTest, SETEX) {
+  LOG(INFO) << "SETEX";
+
+  Redis* redis = Redis::getInstance();
+
+  // 初始化
+  EXPECT_TRUE(redis->init("192.168.2.219", 8050, 6, "myredispass2025")) << "Fail to init.";
+
+  EXPECT_TRUE(redis->setex("hello", "world", 60));
+  EXPECT_EQ(redis->get("hello"), "world");
+  EXPECT_GT(redis->ttl("hello"), 0);
+}
+
+TEST(RedisTest, MGET) {
+  LOG(INFO) << "MGET";
+
+  Redis* redis = Redis::getInstance();
+
+  // 初始化
+  EXPECT_TRUE(redis->init("192.168.2.219", 8050, 6, "myredispass2025")) << "Fail to init.";
+
+  redis->set("k1", "v1");
+  redis->set("k2", "v2");
+  redis->del("k3");
+
+  vector<string> values;
+  EXPECT_TRUE(redis->mget({"k1", "k2", "k3"}, values));
+  ASSERT_EQ(values.size(), 3);
+  EXPECT_EQ(values[0], "v1");
+  EXPECT_EQ(values[1], "v2");
+  EXPECT_EQ(values[2], "");
+}
+
+TEST(RedisTest, SCAN) {
+  LOG(INFO) << "SCAN";
+
+  Redis* redis = Redis::getInstance();
+
+  // 初始化
+  EXPECT_TRUE(redis->init("192.168.2.219", 8050, 6, "myredispass2025")) << "Fail to init.";
+
+  redis->set("scan:1:status", "online");
+  redis->set("scan:2:status", "offline");
+
+  vector<string> keys;
+  EXPECT_TRUE(redis->scan("scan:*:status", keys, 10));
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  ASSERT_EQ(keys.size(), 2);
+  EXPECT_EQ(keys[0], "scan:1:status");
+  EXPECT_EQ(keys[1], "scan:2:status");
+
+  redis->del("scan:1:status");
+  redis->del("scan:2:status");
+}
+
+TEST(RedisTest, PIPELINE) {
+  LOG(INFO) << "PIPELINE";
+
+  Redis* redis = Redis::getInstance();
+
+  // 初始化
+  EXPECT_TRUE(redis->init("192.168.2.219", 8050, 6, "myredispass2025")) << "Fail to init.";
+
+  vector<string> replies;
+  EXPECT_TRUE(redis->pipeline({{"SET", "p1", "1"},
+    {"SETEX", "p2", "60", "2"},
+    {"GET", "p1"},
+    {"DEL", "p1", "p2"}
+  }, replies));
+
+  ASSERT_EQ(replies.size(), 4);
+  EXPECT_EQ(replies[0], "OK");
+  EXPECT_EQ(replies[2], "1");
+  EXPECT_EQ(replies[3], "2");
+}
+
+TEST(RedisTest, CONCURRENT) {
+  LOG(INFO) << "CONCURRENT";
+
+  Redis* redis = Redis::getInstance();
+
+  // 初始化
+  EXPECT_TRUE(redis->init("192.168.2.219", 8050, 6, "myredispass2025", 4)) << "Fail to init.";
+
+  std::vector<std::thread> workers;
+  std::atomic<int> failures(0);
+
+  for(int i = 0; i < 16; i++) {
+    workers.push_back(std::thread([redis, i, &failures]() {
+      string key = "concurrent:" + std::to_string(i);
+
+      for(int j = 0; j < 100; j++) {
+        redis->setex(key, std::to_string(j), 60);
+
+        if(redis->get(key) != std::to_string(j)) failures++;
+      }
+
+      redis->del(key);
+    }));
+  }
+
+  for(std::thread& t : workers) {
+    t.join();
+  }
+
+  EXPECT_EQ(failures.load(), 0);
+}
+
+TEST(RedisTest, BINARY) {
+  LOG(INFO) << "BINARY";
+
+  Redis* redis = Redis::getInstance();
+
+  // 初始化
+  EXPECT_TRUE(redis->init("192.168.2.219", 8050, 6, "myredispass2025")) << "Fail to init.";
+
+  // 含有 \0 的数据
+  const char raw[] = {'a', '\0', 'b', '\0', 'c'};
+  EXPECT_EQ(redis->set("binary", raw, sizeof(raw)), 1);
+
+  string result = redis->get("binary");
+  ASSERT_EQ(result.size(), sizeof(raw));
+  EXPECT_EQ(result, string(raw, sizeof(raw)));
+
+  size_t length = 0;
+  EXPECT_TRUE(redis->get("binary", [&length, &raw](const char* data, size_t len) {
+    length = len;
+    return memcmp(data, raw, len) == 0;
+  }));
+  EXPECT_EQ(length, sizeof(raw));
+
+  EXPECT_TRUE(redis->setex("binary", raw, sizeof(raw), 60));
+  EXPECT_EQ(redis->get("binary").size(), sizeof(raw));
+
+  redis->del("binary");
+  EXPECT_FALSE(redis->get("binary", [](const char* data, size_t len) {
+    return true;
+  }));
+}
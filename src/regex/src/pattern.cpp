@@ -29,27 +29,34 @@ PatternRegex::~PatternRegex() {
 
 /**
  * 从一个字符串中根据正则表达式匹配出目标值
+ * 每次调用都会编译表达式，对话流程中应使用预编译版本
  */
 bool PatternRegex::match(const string& pattern, const string& source, PatternDictMatch& pdm) {
-  VLOG(3) << __func__ << " source: " << source << ", pattern: " << pattern;
+  CompiledPattern compiled(pattern);
+  return match(compiled, source, pdm);
+};
+
+/**
+ * 使用预编译的表达式匹配目标值
+ */
+bool PatternRegex::match(const CompiledPattern& compiled, const string& source,
+                         PatternDictMatch& pdm) {
+  VLOG(3) << __func__ << " source: " << source << ", pattern: " << compiled.pattern;
   pdm.source = source;
-  pdm.regex = pattern;
+  pdm.regex = compiled.pattern;
 
-  boost::regex expr(pattern, boost::regex::perl);
   boost::cmatch results;
 
   const char *raw = source.c_str();
-  bool r = boost::regex_search(raw, results, expr);
+  bool r = boost::regex_search(raw, results, compiled.expr);
 
   if(r) {
-    for(boost::cmatch::iterator it = results.begin(); it != results.end(); ++it) {
-      //  指向子串对应首位置        指向子串对应尾位置          子串内容
-      pdm.val = it->str();
-      pdm.begin = (int)(it->first - raw);
-      pdm.end = (int)(it->second - raw);
-      VLOG(3) << __func__ << " val " << pdm.val  << ", range [" << pdm.begin << "," << pdm.end << "]";
-      return true;
-    }
+    //  指向子串对应首位置        指向子串对应尾位置          子串内容
+    pdm.val = results[0].str();
+    pdm.begin = (int)(results[0].first - raw);
+    pdm.end = (int)(results[0].second - raw);
+    VLOG(3) << __func__ << " val " << pdm.val  << ", range [" << pdm.begin << "," << pdm.end << "]";
+    return true;
   }
 
   return false;
@@ -71,6 +78,213 @@ bool PatternRegex::checkBoostPcreGrammar(const string& pattern, string& error_ms
   }
 };
 
+/**
+ * 组合匹配器
+ */
+PatternDictMatcher::PatternDictMatcher() : _combined(NULL) {
+};
+
+PatternDictMatcher::~PatternDictMatcher() {
+  delete _combined;
+};
+
+void PatternDictMatcher::add(const string& dictname, const string& dict_id,
+                             const CompiledPattern& compiled) {
+  Alternative alt = {dictname, dict_id, compiled, 0};
+  _alternatives.push_back(alt);
+};
+
+size_t PatternDictMatcher::size() const {
+  return _alternatives.size();
+};
+
+/**
+ * 表达式是否可以作为组合表达式的一个分支
+ * 反向引用、递归、条件分组等依赖分组编号，放入组合表达式后编号会偏移
+ */
+bool PatternDictMatcher::isCombinable(const string& pattern) {
+  for(size_t i = 0; i + 1 < pattern.size(); i++) {
+    if(pattern[i] == '\\') {
+      char next = pattern[i + 1];
+
+      if((next >= '1' && next <= '9') || next == 'g' || next == 'k' || next == 'G')
+        return false;
+
+      i++; // 跳过转义字符
+    } else if(pattern[i] == '(' && pattern[i + 1] == '?' && i + 2 < pattern.size()) {
+      char next = pattern[i + 2];
+
+      if((next >= '0' && next <= '9') || next == '+' || next == '-' ||
+          next == 'R' || next == '&' || next == '(' || next == 'P')
+        return false;
+    }
+  }
+
+  return true;
+};
+
+/**
+ * 生成组合表达式: (p0)|(p1)|...
+ * 每个分支外层分组的编号由之前分支的分组数量决定
+ */
+bool PatternDictMatcher::build() {
+  delete _combined;
+  _combined = NULL;
+  _combined_alternatives.clear();
+  _standalone_alternatives.clear();
+
+  std::stringstream ss;
+  size_t group = 1;
+
+  for(size_t i = 0; i < _alternatives.size(); i++) {
+    Alternative& alt = _alternatives[i];
+
+    if(!isCombinable(alt.compiled.pattern)) {
+      alt.group = 0;
+      _standalone_alternatives.push_back(i);
+      continue;
+    }
+
+    if(!_combined_alternatives.empty())
+      ss << "|";
+
+    ss << "(" << alt.compiled.pattern << ")";
+    alt.group = group;
+    group += 1 + alt.compiled.expr.mark_count();
+    _combined_alternatives.push_back(i);
+  }
+
+  if(_combined_alternatives.empty())
+    return true;
+
+  try {
+    _combined = new boost::regex(ss.str(), boost::regex::perl);
+  } catch(boost::regex_error& e) {
+    // 组合失败时退化为逐个匹配
+    VLOG(2) << __func__ << " fails to combine patterns, fallback to standalone matching: " << e.what();
+
+    for(const size_t& i : _combined_alternatives) {
+      _alternatives[i].group = 0;
+      _standalone_alternatives.push_back(i);
+    }
+
+    std::sort(_standalone_alternatives.begin(), _standalone_alternatives.end());
+    _combined_alternatives.clear();
+    return false;
+  }
+
+  VLOG(3) << __func__ << " combined patterns: " << _combined_alternatives.size()
+          << ", standalone patterns: " << _standalone_alternatives.size();
+  return true;
+};
+
+void PatternDictMatcher::collect(const Alternative& alt, const boost::cmatch& m, const char* raw,
+                                 const string& source,
+                                 std::vector<PatternDictMatch>& matches) const {
+  const boost::csub_match& sub = m[alt.group];
+  PatternDictMatch pdm;
+  pdm.source = source;
+  pdm.dictname = alt.dictname;
+  pdm.dict_id = alt.dict_id;
+  pdm.regex = alt.compiled.pattern;
+  pdm.val = sub.str();
+  pdm.begin = (int)(sub.first - raw);
+  pdm.end = (int)(sub.second - raw);
+  matches.push_back(pdm);
+};
+
+/**
+ * 一次扫描获得所有表达式的匹配，结果按位置升序且互不重叠
+ */
+void PatternDictMatcher::match(const string& source,
+                               std::vector<PatternDictMatch>& matches) const {
+  const char* raw = source.c_str();
+  const char* end = raw + source.size();
+
+  if(_combined != NULL) {
+    boost::cregex_iterator it(raw, end, *_combined, boost::match_not_null);
+    boost::cregex_iterator last;
+
+    for(; it != last; ++it) {
+      const boost::cmatch& m = *it;
+
+      // 找到命中的分支
+      for(const size_t& i : _combined_alternatives) {
+        const Alternative& alt = _alternatives[i];
+
+        if(m[alt.group].matched) {
+          collect(alt, m, raw, source, matches);
+          break;
+        }
+      }
+    }
+  }
+
+  if(_standalone_alternatives.empty())
+    return;
+
+  // 合并单独匹配的结果
+  std::vector<std::pair<size_t, PatternDictMatch> > merged;
+
+  for(const PatternDictMatch& pdm : matches) {
+    merged.push_back(std::make_pair((size_t)0, pdm));
+  }
+
+  for(const size_t& i : _standalone_alternatives) {
+    const Alternative& alt = _alternatives[i];
+    boost::cregex_iterator it(raw, end, alt.compiled.expr, boost::match_not_null);
+    boost::cregex_iterator last;
+    std::vector<PatternDictMatch> found;
+
+    for(; it != last; ++it) {
+      collect(alt, *it, raw, source, found);
+    }
+
+    for(const PatternDictMatch& pdm : found) {
+      merged.push_back(std::make_pair(i + 1, pdm));
+    }
+  }
+
+  // 按位置排序，位置相同时组合表达式和先加入的表达式优先
+  std::stable_sort(merged.begin(), merged.end(),
+  [](const std::pair<size_t, PatternDictMatch>& lhs, const std::pair<size_t, PatternDictMatch>& rhs) {
+    return lhs.second.begin < rhs.second.begin ||
+           (lhs.second.begin == rhs.second.begin && lhs.first < rhs.first);
+  });
+
+  matches.clear();
+  int covered = 0;
+
+  for(const std::pair<size_t, PatternDictMatch>& p : merged) {
+    if(p.second.begin < covered)
+      continue;
+
+    matches.push_back(p.second);
+    covered = p.second.end;
+  }
+};
+
+/**
+ * 将匹配到的值替换为 #词典名，一次拼接完成
+ * matches 需要按位置升序且互不重叠
+ */
+string PatternDictMatcher::rewrite(const string& source,
+                                   const std::vector<PatternDictMatch>& matches) {
+  string result;
+  result.reserve(source.size());
+  size_t last = 0;
+
+  for(const PatternDictMatch& pdm : matches) {
+    result.append(source, last, pdm.begin - last);
+    result.append("#");
+    result.append(pdm.dictname);
+    last = pdm.end;
+  }
+
+  result.append(source, last, string::npos);
+  return result;
+};
+
 } // namespace clause
 } // namespace bot
 } // namespace chatopera
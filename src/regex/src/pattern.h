@@ -44,6 +44,19 @@ struct PatternDictMatch {
   string regex;    // 匹配的表达式
 };
 
+/**
+ * 预编译的正则表达式
+ * 在机器人加载时编译一次，编译后只读，可被多个线程同时用于匹配
+ */
+struct CompiledPattern {
+  string pattern;      // 原始表达式
+  boost::regex expr;   // 编译结果
+
+  explicit CompiledPattern(const string& p)
+    : pattern(p), expr(p, boost::regex::perl) {
+  }
+};
+
 class PatternRegex {
  public: // constructors
   PatternRegex();
@@ -51,9 +64,48 @@ class PatternRegex {
 
  public: // functions
   static bool match(const string& pattern, const string& source, PatternDictMatch& pdm);
+  static bool match(const CompiledPattern& compiled, const string& source, PatternDictMatch& pdm);
   static bool checkBoostPcreGrammar(const string& pattern, string& error_msg);
 };
 
+/**
+ * 正则表达式词典组合匹配器
+ * 在机器人加载时把所有表达式组合成一个多分支表达式，对话时一次扫描返回全部匹配。
+ * 含有反向引用等依赖分组编号的表达式无法组合，单独匹配后再合并结果。
+ */
+class PatternDictMatcher {
+ public: // constructors
+  PatternDictMatcher();
+  ~PatternDictMatcher();
+
+ public: // functions
+  void add(const string& dictname, const string& dict_id, const CompiledPattern& compiled);
+  bool build();
+  void match(const string& source, std::vector<PatternDictMatch>& matches) const;
+  size_t size() const;
+  static string rewrite(const string& source, const std::vector<PatternDictMatch>& matches);
+
+ private:
+  struct Alternative {
+    string dictname;
+    string dict_id;
+    CompiledPattern compiled;
+    size_t group;        // 在组合表达式中的分组编号, 单独匹配时为0
+  };
+
+  static bool isCombinable(const string& pattern);
+  void collect(const Alternative& alt, const boost::cmatch& m, const char* raw,
+               const string& source, std::vector<PatternDictMatch>& matches) const;
+
+  std::vector<Alternative> _alternatives;
+  std::vector<size_t> _combined_alternatives;   // 参与组合的表达式, 按分组编号升序
+  std::vector<size_t> _standalone_alternatives; // 单独匹配的表达式
+  boost::regex* _combined;
+
+  PatternDictMatcher(const PatternDictMatcher&);
+  void operator=(const PatternDictMatcher&);
+};
+
 } // namespace clause
 } // bot
 } // chatopera
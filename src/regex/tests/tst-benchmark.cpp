@@ -0,0 +1,205 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file tests/tst-benchmark.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2019-12-20_10:12:31
+ * @brief 正则表达式词典匹配性能对比：每次编译 vs 预编译
+ *
+ **/
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "pattern.h"
+
+using namespace std;
+using namespace chatopera::bot::clause;
+
+namespace {
+
+// 模拟一个机器人的多个正则表达式词典
+const char* kPatterns[] = {
+  "1[3-9]\\d{9}",
+  "[A-Za-z0-9._%+-]+@[A-Za-z0-9.-]+\\.[A-Za-z]{2,}",
+  "\\d{4}-\\d{1,2}-\\d{1,2}",
+  "[A-Z]{2}\\d{6,8}",
+  "(\\d+)(元|块钱)",
+  "https?://[^\\s]+"
+};
+
+const char* kQueries[] = {
+  "我的手机号是13888888888，请尽快联系",
+  "发邮件到 support@chatopera.com 吧",
+  "我想预订2019-12-20的机票",
+  "订单号是 CN12345678",
+  "这个东西卖100块钱",
+  "没有任何可以匹配的内容"
+};
+
+const size_t kRounds = 2000;
+
+}
+
+TEST(RegexTest, BenchCompiledPattern) {
+  // 关闭匹配过程中的调试日志，避免影响计时
+  int verbose = FLAGS_v;
+  FLAGS_v = 0;
+
+  const size_t npatterns = sizeof(kPatterns) / sizeof(kPatterns[0]);
+  const size_t nqueries = sizeof(kQueries) / sizeof(kQueries[0]);
+
+  std::vector<CompiledPattern> compiled;
+
+  for(size_t i = 0; i < npatterns; i++) {
+    compiled.push_back(CompiledPattern(kPatterns[i]));
+  }
+
+  size_t hits_runtime = 0;
+  size_t hits_compiled = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for(size_t r = 0; r < kRounds; r++) {
+    for(size_t q = 0; q < nqueries; q++) {
+      for(size_t p = 0; p < npatterns; p++) {
+        PatternDictMatch pdm;
+
+        if(PatternRegex::match(kPatterns[p], kQueries[q], pdm)) hits_runtime++;
+      }
+    }
+  }
+
+  std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+  for(size_t r = 0; r < kRounds; r++) {
+    for(size_t q = 0; q < nqueries; q++) {
+      for(size_t p = 0; p < npatterns; p++) {
+        PatternDictMatch pdm;
+
+        if(PatternRegex::match(compiled[p], kQueries[q], pdm)) hits_compiled++;
+      }
+    }
+  }
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  FLAGS_v = verbose;
+
+  double runtime_ms = std::chrono::duration<double, std::milli>(middle - start).count();
+  double compiled_ms = std::chrono::duration<double, std::milli>(end - middle).count();
+  size_t requests = kRounds * nqueries;
+
+  LOG(INFO) << "[runtime compile] " << runtime_ms << "ms, " << (runtime_ms * 1000 / requests) << "us/request";
+  LOG(INFO) << "[precompiled] " << compiled_ms << "ms, " << (compiled_ms * 1000 / requests) << "us/request";
+
+  EXPECT_EQ(hits_runtime, hits_compiled);
+}
+
+/**
+ * 逐个表达式匹配 vs 组合表达式一次扫描
+ */
+TEST(RegexTest, BenchCombinedMatcher) {
+  int verbose = FLAGS_v;
+  FLAGS_v = 0;
+
+  const size_t npatterns = sizeof(kPatterns) / sizeof(kPatterns[0]);
+  const size_t nqueries = sizeof(kQueries) / sizeof(kQueries[0]);
+
+  std::vector<CompiledPattern> compiled;
+  PatternDictMatcher matcher;
+
+  for(size_t i = 0; i < npatterns; i++) {
+    compiled.push_back(CompiledPattern(kPatterns[i]));
+    matcher.add("dict" + std::to_string(i), std::to_string(i), compiled.back());
+  }
+
+  matcher.build();
+
+  size_t hits_each = 0;
+  size_t hits_combined = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for(size_t r = 0; r < kRounds; r++) {
+    for(size_t q = 0; q < nqueries; q++) {
+      for(size_t p = 0; p < npatterns; p++) {
+        PatternDictMatch pdm;
+
+        if(PatternRegex::match(compiled[p], kQueries[q], pdm)) hits_each++;
+      }
+    }
+  }
+
+  std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+  for(size_t r = 0; r < kRounds; r++) {
+    for(size_t q = 0; q < nqueries; q++) {
+      std::vector<PatternDictMatch> matches;
+      matcher.match(kQueries[q], matches);
+      hits_combined += matches.size();
+    }
+  }
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  FLAGS_v = verbose;
+
+  double each_ms = std::chrono::duration<double, std::milli>(middle - start).count();
+  double combined_ms = std::chrono::duration<double, std::milli>(end - middle).count();
+  size_t requests = kRounds * nqueries;
+
+  LOG(INFO) << "[each pattern] " << each_ms << "ms, " << (each_ms * 1000 / requests) << "us/request";
+  LOG(INFO) << "[combined] " << combined_ms << "ms, " << (combined_ms * 1000 / requests) << "us/request";
+  LOG(INFO) << "[hits] each pattern: " << hits_each << ", combined: " << hits_combined;
+
+  // 两种方式命中的词典相同；次数不可比，组合匹配会返回同一表达式的多处匹配
+  for(size_t q = 0; q < nqueries; q++) {
+    std::set<string> each, combined;
+
+    for(size_t p = 0; p < npatterns; p++) {
+      PatternDictMatch pdm;
+
+      if(PatternRegex::match(compiled[p], kQueries[q], pdm)) {
+        each.insert("dict" + std::to_string(p));
+      }
+    }
+
+    std::vector<PatternDictMatch> matches;
+    matcher.match(kQueries[q], matches);
+
+    for(const PatternDictMatch& pdm : matches) {
+      combined.insert(pdm.dictname);
+    }
+
+    EXPECT_TRUE(each == combined) << kQueries[q];
+  }
+}
+
+/**
+ * 预编译和每次编译的匹配结果一致
+ */
+TEST(RegexTest, CompiledPatternMatch) {
+  CompiledPattern compiled("(\\d+)(元|块钱)");
+  PatternDictMatch pdm;
+
+  ASSERT_TRUE(PatternRegex::match(compiled, "这个东西卖100块钱", pdm));
+  EXPECT_EQ(pdm.val, "100块钱");
+  EXPECT_EQ(pdm.begin, 15);
+  EXPECT_EQ(pdm.end, 24);
+
+  PatternDictMatch pdm2;
+  ASSERT_TRUE(PatternRegex::match("(\\d+)(元|块钱)", "这个东西卖100块钱", pdm2));
+  EXPECT_EQ(pdm.val, pdm2.val);
+  EXPECT_EQ(pdm.begin, pdm2.begin);
+  EXPECT_EQ(pdm.end, pdm2.end);
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,115 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file tests/tst-matcher.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2019-12-20_15:40:12
+ * @brief 正则表达式词典组合匹配器
+ *
+ **/
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+#include <string>
+#include <vector>
+
+#include "pattern.h"
+
+using namespace std;
+using namespace chatopera::bot::clause;
+
+TEST(RegexTest, MatcherSinglePass) {
+  PatternDictMatcher matcher;
+  matcher.add("phone", "d1", CompiledPattern("1[3-9]\\d{9}"));
+  matcher.add("money", "d2", CompiledPattern("(\\d+)(元|块钱)"));
+  matcher.add("date", "d3", CompiledPattern("(\\d{4})-(\\d{1,2})-(\\d{1,2})"));
+  ASSERT_TRUE(matcher.build());
+
+  string query("2019-12-20给13888888888转100块钱");
+  std::vector<PatternDictMatch> matches;
+  matcher.match(query, matches);
+
+  ASSERT_EQ(matches.size(), 3);
+  EXPECT_EQ(matches[0].dictname, "date");
+  EXPECT_EQ(matches[0].val, "2019-12-20");
+  EXPECT_EQ(matches[0].begin, 0);
+  EXPECT_EQ(matches[0].end, 10);
+  EXPECT_EQ(matches[1].dictname, "phone");
+  EXPECT_EQ(matches[1].dict_id, "d1");
+  EXPECT_EQ(matches[1].val, "13888888888");
+  EXPECT_EQ(matches[2].dictname, "money");
+  EXPECT_EQ(matches[2].val, "100块钱");
+
+  EXPECT_EQ(PatternDictMatcher::rewrite(query, matches), "#date给#phone转#money");
+}
+
+/**
+ * 含有反向引用的表达式单独匹配后合并
+ */
+TEST(RegexTest, MatcherStandalonePattern) {
+  PatternDictMatcher matcher;
+  matcher.add("repeat", "d1", CompiledPattern("(\\w)\\1{2}"));
+  matcher.add("code", "d2", CompiledPattern("[A-Z]{2}\\d{4}"));
+  ASSERT_TRUE(matcher.build());
+
+  string query("编号CN1234重复aaa");
+  std::vector<PatternDictMatch> matches;
+  matcher.match(query, matches);
+
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches[0].dictname, "code");
+  EXPECT_EQ(matches[0].val, "CN1234");
+  EXPECT_EQ(matches[1].dictname, "repeat");
+  EXPECT_EQ(matches[1].val, "aaa");
+
+  EXPECT_EQ(PatternDictMatcher::rewrite(query, matches), "编号#code重复#repeat");
+}
+
+/**
+ * 不同词典的表达式在同一位置重叠时，组合表达式只保留先加入的分支，
+ * 所以机器人按意图只组合相关的词典
+ */
+TEST(RegexTest, MatcherOverlappingDicts) {
+  string query("订单13888888888已发货");
+  std::vector<PatternDictMatch> matches;
+
+  PatternDictMatcher all;
+  all.add("orderno", "d1", CompiledPattern("\\d{11}"));
+  all.add("phone", "d2", CompiledPattern("1[3-9]\\d{9}"));
+  ASSERT_TRUE(all.build());
+  all.match(query, matches);
+
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0].dictname, "orderno");
+
+  PatternDictMatcher related;
+  related.add("phone", "d2", CompiledPattern("1[3-9]\\d{9}"));
+  ASSERT_TRUE(related.build());
+  matches.clear();
+  related.match(query, matches);
+
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0].dictname, "phone");
+  EXPECT_EQ(matches[0].dict_id, "d2");
+  EXPECT_EQ(matches[0].val, "13888888888");
+  EXPECT_EQ(PatternDictMatcher::rewrite(query, matches), "订单#phone已发货");
+}
+
+TEST(RegexTest, MatcherNoMatch) {
+  PatternDictMatcher matcher;
+  matcher.add("phone", "d1", CompiledPattern("1[3-9]\\d{9}"));
+  ASSERT_TRUE(matcher.build());
+
+  string query("没有任何可以匹配的内容");
+  std::vector<PatternDictMatch> matches;
+  matcher.match(query, matches);
+
+  EXPECT_TRUE(matches.empty());
+  EXPECT_EQ(PatternDictMatcher::rewrite(query, matches), query);
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -19,6 +19,9 @@
 DEFINE_int32(server_port, 6600, "Server's port to process requests.");
 DEFINE_int32(server_threads, 24, "serving threads");
 DEFINE_string(lac_conf_dir, "../../../../var/data/lac/conf", "Baidu LAC Config dir");
+DEFINE_int32(lac_batch_size, 1, "Max queries tagged together by LAC, 1 disables micro batching");
+DEFINE_int32(lac_batch_wait_us, 500, "Max microseconds to wait for a batch to fill up");
+DEFINE_int32(lac_batch_workers, 2, "Threads running batched LAC tagging");
 
 using namespace std;
 using namespace ::chatopera::bot::sysdicts;
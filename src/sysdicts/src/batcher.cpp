@@ -0,0 +1,186 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file src/batcher.cpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2019-12-23_11:05:42
+ * @brief
+ *
+ **/
+
+#include "batcher.h"
+#include <chrono>
+#include <string.h>
+
+namespace chatopera {
+namespace bot {
+namespace sysdicts {
+
+LacBatcher::LacBatcher(void* lac_handle, int batch_size, int wait_us, int workers) :
+  _lac_handle(lac_handle),
+  _batch_size(batch_size > 0 ? batch_size : 1),
+  _wait_us(wait_us > 0 ? wait_us : 0),
+  _workers(workers > 0 ? workers : 1),
+  _alive(0),
+  _stopped(false) {
+};
+
+LacBatcher::~LacBatcher() {
+  stop();
+};
+
+bool LacBatcher::start() {
+  VLOG(2) << __func__ << " batch size: " << _batch_size << ", wait us: " << _wait_us << ", workers: " << _workers;
+
+  // 在启动线程前创建缓存，创建失败的线程不启动
+  for(int i = 0; i < _workers; i++) {
+    void* lac_buff = lac_buff_create(_lac_handle);
+
+    if(lac_buff == NULL) {
+      VLOG(2) << __func__ << " create lac_buff error, skip worker " << i;
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      _alive++;
+    }
+
+    _threads.push_back(std::thread(&LacBatcher::run, this, lac_buff));
+  }
+
+  return !_threads.empty();
+};
+
+void LacBatcher::stop() {
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+
+    if(_stopped)
+      return;
+
+    _stopped = true;
+  }
+
+  _pending_cv.notify_all();
+
+  for(std::thread& t : _threads) {
+    if(t.joinable()) t.join();
+  }
+
+  _threads.clear();
+};
+
+/**
+ * 提交查询，等待所在批次完成
+ */
+int LacBatcher::tagging(const string& query, tag_t* results, int max_result_num) {
+  Task task = {&query, results, max_result_num, -1, false};
+
+  std::unique_lock<std::mutex> lock(_lock);
+
+  // 没有存活的后台线程时，提交的查询不会被处理
+  if(_stopped || _alive == 0) {
+    return -1;
+  }
+
+  _pending.push_back(&task);
+  _pending_cv.notify_one();
+  _done_cv.wait(lock, [&task] { return task.done; });
+  return task.result_num;
+};
+
+/**
+ * 后台线程：攒批，标注，分发
+ */
+void LacBatcher::run(void* lac_buff) {
+  std::vector<Task*> batch;
+  std::vector<tag_t> results;
+  std::vector<int> result_nums;
+
+  while(true) {
+    batch.clear();
+    {
+      std::unique_lock<std::mutex> lock(_lock);
+      _pending_cv.wait(lock, [this] { return _stopped || !_pending.empty(); });
+
+      if(_stopped && _pending.empty())
+        break;
+
+      // 第一个查询到达后，最多再等待 wait_us 微秒
+      if((int) _pending.size() < _batch_size && _wait_us > 0) {
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+            + std::chrono::microseconds(_wait_us);
+        _pending_cv.wait_until(lock, deadline, [this] {
+          return _stopped || (int) _pending.size() >= _batch_size;
+        });
+      }
+
+      while(!_pending.empty() && (int) batch.size() < _batch_size) {
+        batch.push_back(_pending.front());
+        _pending.pop_front();
+      }
+    }
+
+    if(batch.empty())
+      continue;
+
+    process(lac_buff, batch, results, result_nums);
+
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+
+      for(Task* task : batch) {
+        task->done = true;
+      }
+    }
+
+    _done_cv.notify_all();
+  }
+
+  lac_buff_destroy(_lac_handle, lac_buff);
+
+  std::lock_guard<std::mutex> lock(_lock);
+  _alive--;
+};
+
+void LacBatcher::process(void* lac_buff, std::vector<Task*>& batch,
+                         std::vector<tag_t>& results, std::vector<int>& result_nums) {
+  int max_result_num = CL_BOT_SYSDICT_MAX_RESULT_LEN;
+  std::vector<const char*> queries;
+  queries.reserve(batch.size());
+
+  for(Task* task : batch) {
+    queries.push_back(task->query->c_str());
+  }
+
+  results.resize(batch.size() * max_result_num);
+  result_nums.resize(batch.size());
+
+  int rc = lac_tagging_batch(_lac_handle, lac_buff, queries.data(), (int) batch.size(),
+                             results.data(), result_nums.data(), max_result_num);
+
+  for(size_t i = 0; i < batch.size(); i++) {
+    Task* task = batch[i];
+
+    if(rc < 0 || result_nums[i] > task->max_result_num) {
+      task->result_num = -1;
+      continue;
+    }
+
+    memcpy(task->results, results.data() + i * max_result_num, sizeof(tag_t) * result_nums[i]);
+    task->result_num = result_nums[i];
+  }
+
+  VLOG(4) << __func__ << " tagged batch size: " << batch.size() << ", rc: " << rc;
+};
+
+} // namespace sysdicts
+} // namespace bot
+} // namespace chatopera
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,86 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file src/batcher.h
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2019-12-23_11:05:18
+ * @brief
+ * 合并并发的标注请求，批量调用LAC
+ **/
+
+#ifndef __CHATOPERA_BOT_SYSDICTS_BATCHER_H__
+#define __CHATOPERA_BOT_SYSDICTS_BATCHER_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ilac.h"
+#include "marcos.h"
+#include "SysdictsEntities.hpp"
+#include "glog/logging.h"
+
+using namespace std;
+
+namespace chatopera {
+namespace bot {
+namespace sysdicts {
+
+/**
+ * 微批处理
+ * 服务线程提交查询后等待；后台线程在攒够 batch_size 个查询或者等待超过 wait_us 微秒后
+ * 调用一次 lac_tagging_batch，再把结果分发给各个服务线程。
+ */
+class LacBatcher {
+ public:
+  LacBatcher(void* lac_handle, int batch_size, int wait_us, int workers);
+  ~LacBatcher();
+
+  // 至少一个后台线程创建缓存成功时返回true
+  bool start();
+  void stop();
+
+  // 阻塞直到完成标注，返回结果数量，失败返回 -1
+  int tagging(const string& query, tag_t* results, int max_result_num);
+
+ private:
+  struct Task {
+    const string* query;
+    tag_t* results;
+    int max_result_num;
+    int result_num;
+    bool done;
+  };
+
+  void run(void* lac_buff);
+  void process(void* lac_buff, std::vector<Task*>& batch,
+               std::vector<tag_t>& results, std::vector<int>& result_nums);
+
+  void* _lac_handle;
+  int _batch_size;
+  int _wait_us;
+  int _workers;
+
+  std::mutex _lock;
+  std::condition_variable _pending_cv;  // 有新的查询
+  std::condition_variable _done_cv;     // 有批次完成
+  std::deque<Task*> _pending;
+  std::vector<std::thread> _threads;
+  int _alive;                           // 存活的后台线程数
+  bool _stopped;
+};
+
+} // namespace sysdicts
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
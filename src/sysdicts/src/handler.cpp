@@ -19,16 +19,65 @@ using namespace chatopera::bot::sysdicts;
 using namespace std;
 
 DECLARE_string(lac_conf_dir);
+DECLARE_int32(lac_batch_size);
+DECLARE_int32(lac_batch_wait_us);
+DECLARE_int32(lac_batch_workers);
 
 namespace chatopera {
 namespace bot {
 namespace sysdicts {
 
-ServingHandler::ServingHandler() {
+/**
+ * LAC缓存和结果数组，归 ServingHandler 所有，请求期间由一个服务线程独占
+ * 未开启微批处理时才创建 buff
+ */
+struct LacBuff {
+  void* buff;
+  tag_t results[CL_BOT_SYSDICT_MAX_RESULT_LEN];
+
+  LacBuff() : buff(NULL) {
+  }
+};
+
+ServingHandler::ServingHandler() : _g_lac_handle(NULL), _batcher(NULL) {
 };
 
 ServingHandler::~ServingHandler() {
-  lac_destroy(_g_lac_handle);
+  delete _batcher;
+
+  // 缓存依赖 _g_lac_handle，先释放缓存
+  for(LacBuff* local : _lac_idle) {
+    if(local->buff != NULL) {
+      lac_buff_destroy(_g_lac_handle, local->buff);
+    }
+
+    delete local;
+  }
+
+  _lac_idle.clear();
+
+  if(_g_lac_handle != NULL) {
+    lac_destroy(_g_lac_handle);
+  }
+};
+
+LacBuff* ServingHandler::acquireLacBuff() {
+  {
+    std::lock_guard<std::mutex> lock(_pool_lock);
+
+    if(!_lac_idle.empty()) {
+      LacBuff* local = _lac_idle.back();
+      _lac_idle.pop_back();
+      return local;
+    }
+  }
+
+  return new LacBuff();
+};
+
+void ServingHandler::releaseLacBuff(LacBuff* local) {
+  std::lock_guard<std::mutex> lock(_pool_lock);
+  _lac_idle.push_back(local);
 };
 
 bool ServingHandler::init() {
@@ -41,6 +90,21 @@ bool ServingHandler::init() {
     return false;
   }
 
+  // 合并并发请求，批量标注
+  if(FLAGS_lac_batch_size > 1) {
+    _batcher = new LacBatcher(_g_lac_handle,
+                              FLAGS_lac_batch_size,
+                              FLAGS_lac_batch_wait_us,
+                              FLAGS_lac_batch_workers);
+
+    // 没有可用的后台线程时，退回到在服务线程内逐个标注
+    if(!_batcher->start()) {
+      VLOG(2) << __func__ << " batcher init fails, fallback to tagging in serving threads.";
+      delete _batcher;
+      _batcher = NULL;
+    }
+  }
+
   return true;
 };
 
@@ -55,134 +119,48 @@ inline void rc_and_error(Data& data, const int rc, const std::string& error) {
   data.__isset.error = true;
 }
 
-/**
- * 保存实体信息到回复
- */
-inline bool set_entity_into_response(Data& _return,
-                                     const vector<Entity>& entities,
-                                     const bool& fetchall,
-                                     const string& dictname,
-                                     const string& val) {
-  VLOG(3) << __func__ << " dictname: " << dictname << ", value: " << val;
-
-  if(fetchall) {
-    Entity entity;
-    entity.dictname = dictname;
-    entity.val = val;
-    entity.__isset.dictname = true;
-    entity.__isset.val = true;
-    _return.entities.push_back(entity);
-    _return.__isset.entities = true;
-    return true;
-  } else {
-    for(vector<Entity>::const_iterator it = entities.begin(); it != entities.end(); it++) {
-      if(it->dictname == dictname) {
-        // 多个词典属于同一个意图的不同槽位，有被覆盖的危险
-        bool settledown = false;
-
-        if( (*it).__isset.slotname &&
-            !((*it).slotname.empty()) &&
-            _return.__isset.entities &&
-            _return.entities.size() > 0) {
-          for(vector<Entity>::iterator it2 = _return.entities.begin(); it2 != _return.entities.end(); it2++) {
-            if(it2->dictname == dictname &&
-                (it2->slotname == it->slotname)) {
-              settledown = true;
-              break;
-            }
-          }
-        }
-
-        if(settledown) {
-          continue;
-        } else {
-          Entity entity;
-          entity.val = val;
-          entity.dictname = dictname;
-
-          if(((*it).__isset.slotname) && !((*it).slotname.empty())) {
-            entity.slotname = it->slotname;
-            entity.__isset.slotname = true;
-          }
-
-          entity.__isset.dictname = true;
-          entity.__isset.val = true;
-          _return.entities.push_back(entity);
-          _return.__isset.entities = true;
-          return true;
-        }
-      }
-    }
-  }
-
-  return false;
-}
-
-
 void ServingHandler::label(Data& _return, const Data& request) {
   VLOG(3) << __func__ << " request " << FromThriftToUtf8DebugString(&request);
 
   if(request.__isset.query) {
-    void* lac_buff = lac_buff_create(_g_lac_handle);
-
-    if (lac_buff == NULL) {
-      VLOG(2) << __func__ << " create lac_buff error";
-      rc_and_error(_return, 12, "Can not create lac buff.");
-      return;
-    }
+    LacBuff* local = acquireLacBuff();
+    tag_t *results = local->results;
+    int result_num = -1;
+
+    if(_batcher != NULL) {
+      result_num = _batcher->tagging(request.query, results, CL_BOT_SYSDICT_MAX_RESULT_LEN);
+    } else {
+      if(local->buff == NULL) {
+        local->buff = lac_buff_create(_g_lac_handle);
+      } else if(lac_buff_reset(_g_lac_handle, local->buff) < 0) {
+        // 清空失败时重新创建
+        lac_buff_destroy(_g_lac_handle, local->buff);
+        local->buff = lac_buff_create(_g_lac_handle);
+      }
 
-    bool fetchall = true;     // 返回所有结果
+      if (local->buff == NULL) {
+        VLOG(2) << __func__ << " create lac_buff error";
+        releaseLacBuff(local);
+        rc_and_error(_return, 12, "Can not create lac buff.");
+        return;
+      }
 
-    if(request.__isset.entities && request.entities.size() > 0) {
-      fetchall = false;
+      result_num = lac_tagging(_g_lac_handle,
+                               local->buff,
+                               request.query.c_str(),
+                               results,
+                               CL_BOT_SYSDICT_MAX_RESULT_LEN);
     }
 
-    tag_t *results = new tag_t[CL_BOT_SYSDICT_MAX_RESULT_LEN];
-
-    int result_num = lac_tagging(_g_lac_handle,
-                                 lac_buff,
-                                 request.query.c_str(),
-                                 results,
-                                 CL_BOT_SYSDICT_MAX_RESULT_LEN);
-
     if (result_num < 0) {
       VLOG(2) << __func__ << " tagging failed query: " << request.query;
+      releaseLacBuff(local);
       rc_and_error(_return, 13, "Can not tagging query.");
+      return;
     }
 
-    for (int i = 0; i < result_num; i++) {
-      std::string val = request.query.substr(results[i].offset,
-                                             results[i].length);
-
-      VLOG(3) << __func__ << " parsed: " << val << " " << results[i].type;
-      string type(results[i].type);
-
-      if(type == CL_SYSDICT_LABEL_LOC) {
-        set_entity_into_response(_return,
-                                 request.entities,
-                                 fetchall,
-                                 CL_SYSDICT_DICT_LOC,
-                                 val);
-      } else if(type == CL_SYSDICT_LABEL_ORG) {
-        set_entity_into_response(_return,
-                                 request.entities,
-                                 fetchall,
-                                 CL_SYSDICT_DICT_ORG,
-                                 val);
-      } else if(type == CL_SYSDICT_LABEL_TIME) {
-        set_entity_into_response(_return,
-                                 request.entities,
-                                 fetchall,
-                                 CL_SYSDICT_DICT_TIME,
-                                 val);
-      } else if(type == CL_SYSDICT_LABEL_PER) {
-        set_entity_into_response(_return,
-                                 request.entities,
-                                 fetchall,
-                                 CL_SYSDICT_DICT_PER,
-                                 val);
-      }
-    }
+    set_tags_into_response(_return, request, results, result_num);
+    releaseLacBuff(local);
 
     _return.rc = 0;
     _return.__isset.rc = true;
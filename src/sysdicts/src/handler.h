@@ -17,6 +17,7 @@
 #include <map>
 #include <string>
 #include <vector>
+#include <mutex>
 #include <stdlib.h>
 #include <iostream>
 #include <sstream>
@@ -24,6 +25,7 @@
 #include <boost/scoped_ptr.hpp>
 
 #include "ilac.h"
+#include "batcher.h"
 #include "marcos.h"
 #include "glog/logging.h"
 #include "serving/Serving.h"
@@ -35,6 +37,8 @@ namespace chatopera {
 namespace bot {
 namespace sysdicts {
 
+struct LacBuff;
+
 class ServingHandler : virtual public ServingIf {
  public:
   ServingHandler();
@@ -44,7 +48,13 @@ class ServingHandler : virtual public ServingIf {
 
  protected:
  private:
+  LacBuff* acquireLacBuff();
+  void releaseLacBuff(LacBuff* local);
+
   void* _g_lac_handle;    // lac labeling obj pointer
+  LacBatcher* _batcher;   // 微批处理，未开启时为NULL
+  std::mutex _pool_lock;
+  std::vector<LacBuff*> _lac_idle; // 空闲的LAC缓存，析构时先于 _g_lac_handle 释放
 };
 
 } // namespace sysdicts
@@ -16,7 +16,6 @@
 #ifndef __CHATOPERA_BOT_SYSDICTS_MARCO_H__
 #define __CHATOPERA_BOT_SYSDICTS_MARCO_H__
 
-#define CL_BOT_SYSDICT_MAX_RESULT_LEN 100
 #define CL_SYSDICT_CHATBOT_ID "@BUILTIN"
 #define CL_SYSDICT_CHATBOT_ID "@BUILTIN"
 
@@ -0,0 +1,594 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/utils/DictwordsAutomaton.hpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-21_15:37:02
+ * @brief
+ * Aho-Corasick automaton over custom dictionary words, written once and memory mapped read-only.
+ **/
+
+#ifndef __CHATOPERA_UTILS_DICTWORDS_AUTOMATON_H__
+#define __CHATOPERA_UTILS_DICTWORDS_AUTOMATON_H__
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <stdint.h>
+#include "MmapFile.hpp"
+
+namespace chatopera {
+namespace utils {
+
+/**
+ * 一次匹配：词条在文本中的字节区间 [begin, end)
+ */
+struct DictwordsMatch {
+  size_t begin;
+  size_t end;
+  uint32_t word;                            // 词条ID
+};
+
+/**
+ * 自定义词典词条（含近义词）的Aho-Corasick自动机，每个词条附带所属词典的位图。
+ * 训练时由 DictwordsAutomatonBuilder 生成，加载BOT时映射到内存，各数组直接指向映射的页面，
+ * 同一版本的多个进程共用这些页面。
+ * 对话时对用户输入按字节扫描一遍，得到全部匹配，各槽位的查找共用这一份匹配结果。
+ *
+ * 状态按层次遍历编号，根为0，子状态的编号大于父状态，失配指针和输出链指向编号更小的状态。
+ * 词条ID按字节序，词典ID按名称升序。
+ *
+ * 文件格式: magic, format, 状态数N, 边数E, 词条数W, 词典数D, 位图宽度M, 词条字节数B, 词典名称字节数S,
+ *          位图[W*M](8), 根转移[256](4), 边偏移[N+1](4), 边目标[E](4), 失配指针[N](4),
+ *          输出[N](4), 输出链[N](4), 词条偏移[W+1](4), 词典名称偏移[D+1](4),
+ *          边字节[E], 词条字节[B], 词典名称字节[S]
+ */
+class DictwordsAutomaton {
+ public:
+  static const uint32_t MAGIC = 0x43414c43;  // "CLAC"
+  static const uint32_t FORMAT = 1;
+
+  DictwordsAutomaton() {
+    reset();
+  }
+
+  bool open(const std::string& path) {
+    close();
+
+    if(!_file.open(path) || !parse(_file.data(), _file.size())) {
+      close();
+      return false;
+    }
+
+    return true;
+  }
+
+  // 使用内存中的文件内容，之前训练的版本没有该文件时使用
+  bool assign(const std::string& bytes) {
+    close();
+    _buffer.assign((bytes.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+
+    if(!bytes.empty()) {
+      memcpy(_buffer.data(), bytes.data(), bytes.size());
+    }
+
+    if(!parse(reinterpret_cast<const char*>(_buffer.data()), bytes.size())) {
+      close();
+      return false;
+    }
+
+    return true;
+  }
+
+  void close() {
+    _file.close();
+    std::vector<uint64_t>().swap(_buffer);
+    reset();
+  }
+
+  bool isOpen() const {
+    return _states > 0;
+  }
+
+  // 所有匹配，按begin升序，begin相同时按长度降序
+  void match(const std::string& text, std::vector<DictwordsMatch>& matches) const {
+    matches.clear();
+
+    if(_states == 0) {
+      return;
+    }
+
+    uint32_t state = 0;
+
+    for(size_t i = 0; i < text.size(); i++) {
+      state = next(state, (unsigned char) text[i]);
+
+      for(uint32_t s = _outputs[state] >= 0 ? state : _output_links[state]; s != 0; s = _output_links[s]) {
+        DictwordsMatch m;
+        m.word = _outputs[s];
+        m.end = i + 1;
+        m.begin = m.end - (_word_offsets[m.word + 1] - _word_offsets[m.word]);
+        matches.push_back(m);
+      }
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const DictwordsMatch & lhs, const DictwordsMatch & rhs) {
+      return lhs.begin < rhs.begin || (lhs.begin == rhs.begin && lhs.end > rhs.end);
+    });
+  }
+
+  // 与逐个字符位置取最长前缀词条的查找一致：按位置从前往后，
+  // 只看每个位置上最长的词条，返回第一个属于dictname的词条
+  bool extract(const std::vector<DictwordsMatch>& matches,
+               const std::string& dictname,
+               std::string& word) const {
+    std::unordered_map<std::string, uint32_t>::const_iterator dict = _dict_ids.find(dictname);
+
+    if(dict == _dict_ids.end()) {
+      return false;
+    }
+
+    for(size_t i = 0; i < matches.size(); i++) {
+      if(i > 0 && matches[i].begin == matches[i - 1].begin) {
+        continue; // 同一位置只看最长的词条
+      }
+
+      if(hasBit(matches[i].word, dict->second)) {
+        word = getWord(matches[i].word);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool belongTo(const uint32_t& word, const std::string& dictname) const {
+    std::unordered_map<std::string, uint32_t>::const_iterator dict = _dict_ids.find(dictname);
+    return dict != _dict_ids.end() && hasBit(word, dict->second);
+  }
+
+  std::string getWord(const uint32_t& word) const {
+    return std::string(_word_bytes + _word_offsets[word], _word_offsets[word + 1] - _word_offsets[word]);
+  }
+
+  std::vector<std::string> getDictnames(const uint32_t& word) const {
+    std::vector<std::string> dictnames;
+
+    for(uint32_t dictID = 0; dictID < _dictnames.size(); dictID++) {
+      if(hasBit(word, dictID)) {
+        dictnames.push_back(_dictnames[dictID]);
+      }
+    }
+
+    return dictnames;
+  }
+
+  size_t size() const {
+    return _words;
+  }
+
+  // 映射的字节数，或 assign 时复制的字节数，加上词典名称索引
+  size_t memoryUsage() const {
+    size_t bytes = _file.size() + _buffer.capacity() * sizeof(uint64_t);
+
+    for(const std::string& dictname : _dictnames) {
+      bytes += 2 * (sizeof(std::string) + dictname.capacity()) + 2 * sizeof(void*) + sizeof(uint32_t);
+    }
+
+    return bytes;
+  }
+
+ private:
+  friend class DictwordsAutomatonBuilder;
+
+  DictwordsAutomaton(const DictwordsAutomaton&);
+  DictwordsAutomaton& operator=(const DictwordsAutomaton&);
+
+  void reset() {
+    _states = 0;
+    _words = 0;
+    _mask_words = 0;
+    _masks = NULL;
+    _root = NULL;
+    _edge_offsets = NULL;
+    _targets = NULL;
+    _fails = NULL;
+    _outputs = NULL;
+    _output_links = NULL;
+    _word_offsets = NULL;
+    _labels = NULL;
+    _word_bytes = NULL;
+    _dictnames.clear();
+    _dict_ids.clear();
+  }
+
+  /**
+   * 检查头部与各段的大小，以及每个段内的偏移和状态编号，通过后各数组指向data。
+   * 损坏的文件返回false，通过检查的文件在查询时不会越界，失配指针和输出链也不会成环。
+   */
+  bool parse(const char* data, const size_t& size) {
+    MmapReader reader(data, size);
+    uint32_t magic = 0, format = 0;
+    uint64_t header[7] = {0};
+
+    if(!reader.read(magic) || !reader.read(format) || magic != MAGIC || format != FORMAT
+        || !reader.read(header, 7)) {
+      return false;
+    }
+
+    const uint64_t N = header[0], E = header[1], W = header[2], D = header[3];
+    const uint64_t M = header[4], B = header[5], S = header[6];
+
+    // 前缀树中除根以外的每个状态恰有一条入边
+    if(N == 0 || N > UINT32_MAX || E + 1 != N || W >= UINT32_MAX || D >= UINT32_MAX
+        || M != (D + 63) / 64 || B > UINT32_MAX || S > UINT32_MAX
+        || reader.remaining() != W * M * sizeof(uint64_t)
+        + (256 + (N + 1) + E + 3 * N + (W + 1) + (D + 1)) * sizeof(uint32_t) + E + B + S) {
+      return false;
+    }
+
+    const uint64_t* masks = reinterpret_cast<const uint64_t*>(reader.skip(W * M * sizeof(uint64_t)));
+    const uint32_t* root = reinterpret_cast<const uint32_t*>(reader.skip(256 * sizeof(uint32_t)));
+    const uint32_t* edgeOffsets = reinterpret_cast<const uint32_t*>(reader.skip((N + 1) * sizeof(uint32_t)));
+    const uint32_t* targets = reinterpret_cast<const uint32_t*>(reader.skip(E * sizeof(uint32_t)));
+    const uint32_t* fails = reinterpret_cast<const uint32_t*>(reader.skip(N * sizeof(uint32_t)));
+    const int32_t* outputs = reinterpret_cast<const int32_t*>(reader.skip(N * sizeof(int32_t)));
+    const uint32_t* outputLinks = reinterpret_cast<const uint32_t*>(reader.skip(N * sizeof(uint32_t)));
+    const uint32_t* wordOffsets = reinterpret_cast<const uint32_t*>(reader.skip((W + 1) * sizeof(uint32_t)));
+    const uint32_t* dictOffsets = reinterpret_cast<const uint32_t*>(reader.skip((D + 1) * sizeof(uint32_t)));
+    const unsigned char* labels = reinterpret_cast<const unsigned char*>(reader.skip(E));
+    const char* wordBytes = reader.skip(B);
+    const char* dictBytes = reader.skip(S);
+
+    if(!validOffsets(wordOffsets, W, B) || !validOffsets(dictOffsets, D, S)) {
+      return false;
+    }
+
+    // 边偏移单调且不超过E，边目标大于所在状态且只有一条入边，同一状态的出边按字节严格升序；
+    // 失配指针和输出链指向更浅的状态，词条的长度等于其状态的深度，匹配的起点不会越过文本开头
+    std::vector<uint32_t> depth(N, 0);
+
+    if(edgeOffsets[0] != 0 || edgeOffsets[N] != E || outputs[0] != -1 || fails[0] != 0 || outputLinks[0] != 0) {
+      return false;
+    }
+
+    for(uint64_t s = 0; s < N; s++) {
+      if(edgeOffsets[s] > edgeOffsets[s + 1] || edgeOffsets[s + 1] > E) {
+        return false;
+      }
+
+      for(uint64_t e = edgeOffsets[s]; e < edgeOffsets[s + 1]; e++) {
+        if(targets[e] <= s || targets[e] >= N || depth[targets[e]] != 0
+            || (e > edgeOffsets[s] && labels[e - 1] >= labels[e])) {
+          return false;
+        }
+
+        depth[targets[e]] = depth[s] + 1;
+      }
+
+      if(s > 0 && (fails[s] >= s || depth[fails[s]] >= depth[s]
+                   || outputLinks[s] >= s || depth[outputLinks[s]] >= depth[s]
+                   || (outputLinks[s] != 0 && outputs[outputLinks[s]] < 0))) {
+        return false;
+      }
+
+      if(outputs[s] < -1 || (outputs[s] >= 0 && ((uint64_t) outputs[s] >= W
+                                                 || wordOffsets[outputs[s] + 1] - wordOffsets[outputs[s]] != depth[s]))) {
+        return false;
+      }
+    }
+
+    for(size_t c = 0; c < 256; c++) {
+      if(root[c] >= N || depth[root[c]] > 1) {
+        return false;
+      }
+    }
+
+    for(uint32_t dictID = 0; dictID < D; dictID++) {
+      _dictnames.push_back(std::string(dictBytes + dictOffsets[dictID], dictOffsets[dictID + 1] - dictOffsets[dictID]));
+      _dict_ids[_dictnames.back()] = dictID;
+    }
+
+    _states = N;
+    _words = W;
+    _mask_words = M;
+    _masks = masks;
+    _root = root;
+    _edge_offsets = edgeOffsets;
+    _targets = targets;
+    _fails = fails;
+    _outputs = outputs;
+    _output_links = outputLinks;
+    _word_offsets = wordOffsets;
+    _labels = labels;
+    _word_bytes = wordBytes;
+    return true;
+  }
+
+  // offsets[0, count] 从0开始单调不减，结束于size
+  static bool validOffsets(const uint32_t* offsets, const uint64_t& count, const uint64_t& size) {
+    if(offsets[0] != 0 || offsets[count] != size) {
+      return false;
+    }
+
+    for(uint64_t i = 0; i < count; i++) {
+      if(offsets[i] > offsets[i + 1]) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  inline uint32_t next(uint32_t state, const unsigned char& c) const {
+    return next(_edge_offsets, _labels, _targets, _fails, _root, state, c);
+  }
+
+  /** 状态转移，沿失配指针回退直到根，生成文件时也使用 */
+  static inline uint32_t next(const uint32_t* edgeOffsets,
+                              const unsigned char* labels,
+                              const uint32_t* targets,
+                              const uint32_t* fails,
+                              const uint32_t* root,
+                              uint32_t state,
+                              const unsigned char& c) {
+    while(state != 0) {
+      const unsigned char* begin = labels + edgeOffsets[state];
+      const unsigned char* end = labels + edgeOffsets[state + 1];
+      const unsigned char* found = std::lower_bound(begin, end, c);
+
+      if(found != end && *found == c) {
+        return targets[found - labels];
+      }
+
+      state = fails[state];
+    }
+
+    return root[c];
+  }
+
+  inline bool hasBit(const uint32_t& word, const uint32_t& dictID) const {
+    return (_masks[(uint64_t) word * _mask_words + dictID / 64] >> (dictID % 64)) & 1;
+  }
+
+  MmapFile _file;
+  std::vector<uint64_t> _buffer;            // assign 时的文件内容，按8字节对齐
+
+  uint64_t _states;
+  uint64_t _words;
+  uint64_t _mask_words;                     // 每个词条的位图占用的uint64_t个数
+  const uint64_t* _masks;                   // 词条ID -> 词典位图
+  const uint32_t* _root;                    // 根节点的完整转移表，256项
+  const uint32_t* _edge_offsets;            // 状态 s 的边为 [_edge_offsets[s], _edge_offsets[s+1])
+  const uint32_t* _targets;
+  const uint32_t* _fails;                   // 失配指针
+  const int32_t* _outputs;                  // 状态对应的词条ID，不是词条结尾时为-1
+  const uint32_t* _output_links;            // 沿失配指针最近的词条结尾状态，没有时为0
+  const uint32_t* _word_offsets;            // 词条ID -> [offset, next offset)
+  const unsigned char* _labels;             // 边的字节，同一状态的出边按字节升序
+  const char* _word_bytes;
+  std::vector<std::string> _dictnames;
+  std::unordered_map<std::string, uint32_t> _dict_ids; // 词典名称 -> ID
+};
+
+/**
+ * 训练时生成 DictwordsAutomaton 文件
+ */
+class DictwordsAutomatonBuilder {
+ public:
+  void add(const std::string& word, const std::string& dictname) {
+    if(!word.empty()) {
+      _words[word].insert(dictname);
+    }
+  }
+
+  size_t size() const {
+    return _words.size();
+  }
+
+  bool save(const std::string& path) const {
+    std::ofstream ofs(path.c_str(), std::ios::binary | std::ios::trunc);
+
+    if(!ofs.is_open() || !write(ofs)) {
+      return false;
+    }
+
+    ofs.close();
+    return !ofs.fail();
+  }
+
+  bool save(std::string& bytes) const {
+    std::ostringstream oss;
+
+    if(!write(oss)) {
+      return false;
+    }
+
+    bytes = oss.str();
+    return true;
+  }
+
+ private:
+  struct Edge {
+    uint32_t parent;
+    uint32_t child;
+    unsigned char label;
+  };
+
+  /**
+   * 词条按字节序插入前缀树：与上一个词条的公共前缀沿用已有的路径，其余字节新建状态，
+   * 同一状态的出边按字节升序产生。按父状态计数排序压平边表后按层次遍历重新编号，
+   * 再按编号顺序计算失配指针和输出链，父状态总是先于子状态。
+   */
+  bool write(std::ostream& os) const {
+    std::set<std::string> names;
+
+    for(std::map<std::string, std::set<std::string> >::const_iterator it = _words.begin(); it != _words.end(); it++) {
+      names.insert(it->second.begin(), it->second.end());
+    }
+
+    const std::vector<std::string> dictnames(names.begin(), names.end());
+    const uint64_t W = _words.size(), D = dictnames.size(), M = (D + 63) / 64;
+    std::vector<Edge> edges;
+    std::vector<int32_t> terminals(1, -1);   // 插入顺序的状态 -> 词条ID
+    std::vector<uint32_t> path(1, 0);
+    std::vector<uint32_t> wordOffsets(1, 0), dictOffsets(1, 0);
+    std::vector<uint64_t> masks(W * M, 0);
+    std::string wordBytes, dictBytes;
+    const std::string* prev = NULL;
+    int32_t w = 0;
+
+    for(std::map<std::string, std::set<std::string> >::const_iterator it = _words.begin(); it != _words.end(); it++, w++) {
+      const std::string& word = it->first;
+      size_t common = 0;
+
+      while(prev != NULL && common < word.size() && common < prev->size() && word[common] == (*prev)[common]) {
+        common++;
+      }
+
+      path.resize(common + 1);
+      uint32_t state = path[common];
+
+      for(size_t i = common; i < word.size(); i++) {
+        Edge edge;
+        edge.parent = state;
+        edge.child = terminals.size();
+        edge.label = (unsigned char) word[i];
+        edges.push_back(edge);
+        terminals.push_back(-1);
+        state = edge.child;
+        path.push_back(state);
+      }
+
+      terminals[state] = w;
+      prev = &word;
+      wordBytes.append(word);
+      wordOffsets.push_back(wordBytes.size());
+
+      for(const std::string& dictname : it->second) {
+        const uint64_t dictID = std::lower_bound(dictnames.begin(), dictnames.end(), dictname) - dictnames.begin();
+        masks[w * M + dictID / 64] |= 1ULL << (dictID % 64);
+      }
+    }
+
+    for(const std::string& dictname : dictnames) {
+      dictBytes.append(dictname);
+      dictOffsets.push_back(dictBytes.size());
+    }
+
+    const uint64_t N = terminals.size(), E = edges.size();
+
+    if(N > UINT32_MAX || W >= UINT32_MAX || wordBytes.size() > UINT32_MAX || dictBytes.size() > UINT32_MAX) {
+      return false; // 超过32位编号或偏移
+    }
+
+    // 按父状态计数排序，同一状态的出边保持字节升序
+    std::vector<uint32_t> offsets(N + 1, 0), children(E);
+    std::vector<unsigned char> labels(E);
+
+    for(const Edge& edge : edges) {
+      offsets[edge.parent + 1]++;
+    }
+
+    for(uint64_t s = 0; s < N; s++) {
+      offsets[s + 1] += offsets[s];
+    }
+
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+
+    for(const Edge& edge : edges) {
+      const uint32_t e = cursor[edge.parent]++;
+      children[e] = edge.child;
+      labels[e] = edge.label;
+    }
+
+    std::vector<Edge>().swap(edges);
+
+    // 按层次遍历重新编号：order 新编号 -> 插入顺序，ids 插入顺序 -> 新编号
+    std::vector<uint32_t> order(1, 0), ids(N, 0);
+    order.reserve(N);
+
+    for(uint64_t i = 0; i < order.size(); i++) {
+      for(uint32_t e = offsets[order[i]]; e < offsets[order[i] + 1]; e++) {
+        ids[children[e]] = order.size();
+        order.push_back(children[e]);
+      }
+    }
+
+    std::vector<uint32_t> edgeOffsets(N + 1, 0), targets(E), root(256, 0);
+    std::vector<unsigned char> edgeLabels(E);
+    std::vector<int32_t> outputs(N);
+    uint32_t k = 0;
+
+    for(uint64_t s = 0; s < N; s++) {
+      edgeOffsets[s] = k;
+      outputs[s] = terminals[order[s]];
+
+      for(uint32_t e = offsets[order[s]]; e < offsets[order[s] + 1]; e++, k++) {
+        targets[k] = ids[children[e]];
+        edgeLabels[k] = labels[e];
+      }
+    }
+
+    edgeOffsets[N] = k;
+
+    for(uint32_t e = edgeOffsets[0]; e < edgeOffsets[1]; e++) {
+      root[edgeLabels[e]] = targets[e];
+    }
+
+    std::vector<uint32_t> fails(N, 0), outputLinks(N, 0);
+
+    for(uint64_t s = 0; s < N; s++) {
+      for(uint32_t e = edgeOffsets[s]; e < edgeOffsets[s + 1]; e++) {
+        const uint32_t child = targets[e];
+        const uint32_t fail = s == 0 ? 0 : DictwordsAutomaton::next(edgeOffsets.data(), edgeLabels.data(),
+                              targets.data(), fails.data(), root.data(), fails[s], edgeLabels[e]);
+        fails[child] = fail;
+        outputLinks[child] = outputs[fail] >= 0 ? fail : outputLinks[fail];
+      }
+    }
+
+    writeBinary(os, (uint32_t) DictwordsAutomaton::MAGIC);
+    writeBinary(os, (uint32_t) DictwordsAutomaton::FORMAT);
+    writeBinary(os, N);
+    writeBinary(os, E);
+    writeBinary(os, W);
+    writeBinary(os, D);
+    writeBinary(os, M);
+    writeBinary(os, (uint64_t) wordBytes.size());
+    writeBinary(os, (uint64_t) dictBytes.size());
+    writeBinary(os, masks.data(), masks.size());
+    writeBinary(os, root.data(), root.size());
+    writeBinary(os, edgeOffsets.data(), edgeOffsets.size());
+    writeBinary(os, targets.data(), targets.size());
+    writeBinary(os, fails.data(), fails.size());
+    writeBinary(os, outputs.data(), outputs.size());
+    writeBinary(os, outputLinks.data(), outputLinks.size());
+    writeBinary(os, wordOffsets.data(), wordOffsets.size());
+    writeBinary(os, dictOffsets.data(), dictOffsets.size());
+    writeBinary(os, edgeLabels.data(), edgeLabels.size());
+    writeBinary(os, wordBytes.data(), wordBytes.size());
+    writeBinary(os, dictBytes.data(), dictBytes.size());
+    return !os.fail();
+  }
+
+  std::map<std::string, std::set<std::string> > _words; // 词条 -> 所属词典名称
+};
+
+} // namespace utils
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
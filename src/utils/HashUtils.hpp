@@ -0,0 +1,44 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/utils/HashUtils.hpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-24_10:21:05
+ * @brief
+ * 64-bit FNV-1a shared by file checksums, membership tables and NER attributes.
+ **/
+
+#ifndef __CHATOPERA_UTILS_HASH_UTILS_H__
+#define __CHATOPERA_UTILS_HASH_UTILS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace chatopera {
+namespace utils {
+
+// FNV-1a 64位的初始值
+const uint64_t FNV1A64_INIT = 14695981039346656037ULL;
+
+/**
+ * 从h开始继续计算64位FNV-1a，可分段调用，结果与对拼接后的字节计算相同
+ */
+inline uint64_t fnv1a64(uint64_t h, const char* data, const size_t& size) {
+  for(size_t i = 0; i < size; i++) {
+    h = (h ^ (unsigned char) data[i]) * 1099511628211ULL;
+  }
+
+  return h;
+}
+
+} // namespace utils
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
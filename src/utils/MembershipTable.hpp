@@ -0,0 +1,270 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/utils/MembershipTable.hpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-22_16:08:41
+ * @brief
+ * Static (dictname, word) membership table, written once and memory mapped read-only.
+ **/
+
+#ifndef __CHATOPERA_UTILS_MEMBERSHIP_TABLE_H__
+#define __CHATOPERA_UTILS_MEMBERSHIP_TABLE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <stdint.h>
+#include "MmapFile.hpp"
+#include "HashUtils.hpp"
+
+namespace chatopera {
+namespace utils {
+
+/**
+ * 词典成员表：(词典名称, 词条) -> 规范词条
+ * 键与原leveldb相同，为 词典名称 + '\001' + 词条。
+ * 开放寻址、线性探测，槽数为2的幂且负载不超过1/2。
+ * 查找时分段计算哈希、分段比较键，不拼接字符串，也不分配内存。
+ *
+ * 文件格式: magic, format, 槽数, 条目数, 字符串区字节数,
+ *          槽[哈希(8), 键偏移(4), 值偏移(4)], 字符串区[长度(4) + 字节]
+ * 空槽的键偏移为 0xFFFFFFFF
+ */
+class MembershipTable {
+ public:
+  static const uint32_t MAGIC = 0x544d4c43;  // "CLMT"
+  static const uint32_t FORMAT = 1;
+  static const uint32_t EMPTY = 0xFFFFFFFF;
+
+  struct Slot {
+    uint64_t hash;
+    uint32_t key;
+    uint32_t value;
+  };
+
+  MembershipTable() : _slots(NULL), _mask(0), _entries(0), _pool(NULL), _pool_size(0) {
+  }
+
+  bool open(const std::string& path) {
+    close();
+
+    if(!_file.open(path)) {
+      return false;
+    }
+
+    MmapReader reader(_file);
+    uint32_t magic = 0, format = 0;
+    uint64_t slots = 0, entries = 0, poolSize = 0;
+
+    if(!reader.read(magic) || !reader.read(format) || magic != MAGIC || format != FORMAT
+        || !reader.read(slots) || !reader.read(entries) || !reader.read(poolSize)
+        || slots == 0 || (slots & (slots - 1)) != 0 || entries * 2 > slots
+        || reader.remaining() != slots * sizeof(Slot) + poolSize) {
+      _file.close();
+      return false;
+    }
+
+    _slots = reinterpret_cast<const Slot*>(reader.skip(slots * sizeof(Slot)));
+    _pool = reader.skip(poolSize);
+    _mask = slots - 1;
+    _entries = entries;
+    _pool_size = poolSize;
+    return true;
+  }
+
+  void close() {
+    _file.close();
+    _slots = NULL;
+    _pool = NULL;
+    _mask = 0;
+    _entries = 0;
+    _pool_size = 0;
+  }
+
+  bool isOpen() const {
+    return _file.isOpen();
+  }
+
+  bool contains(const std::string& dictname, const std::string& word) const {
+    return lookup(dictname, word) != NULL;
+  }
+
+  // 找到时返回规范词条（近义词对应的原词条）
+  bool find(const std::string& dictname, const std::string& word, std::string& canonical) const {
+    const Slot* slot = lookup(dictname, word);
+    uint32_t size = 0;
+    const char* value = slot == NULL ? NULL : pooled(slot->value, size);
+
+    if(value == NULL) {
+      return false;
+    }
+
+    canonical.assign(value, size);
+    return true;
+  }
+
+  size_t size() const {
+    return _entries;
+  }
+
+  // 映射的字节数
+  size_t memoryUsage() const {
+    return _file.size();
+  }
+
+  /** 与对 dictname + '\001' + word 计算的64位FNV-1a相同 */
+  static uint64_t hash(const std::string& dictname, const std::string& word) {
+    uint64_t h = fnv1a64(FNV1A64_INIT, dictname.data(), dictname.size());
+    h = fnv1a64(h, "\001", 1);
+    return fnv1a64(h, word.data(), word.size());
+  }
+
+ private:
+  MembershipTable(const MembershipTable&);
+  MembershipTable& operator=(const MembershipTable&);
+
+  /** 字符串区offset处的字符串，越界时返回NULL */
+  const char* pooled(const uint32_t& offset, uint32_t& size) const {
+    if((uint64_t) offset + sizeof(uint32_t) > _pool_size) {
+      return NULL;
+    }
+
+    memcpy(&size, _pool + offset, sizeof(uint32_t));
+
+    if((uint64_t) offset + sizeof(uint32_t) + size > _pool_size) {
+      return NULL;
+    }
+
+    return _pool + offset + sizeof(uint32_t);
+  }
+
+  const Slot* lookup(const std::string& dictname, const std::string& word) const {
+    if(_slots == NULL) {
+      return NULL;
+    }
+
+    const uint64_t h = hash(dictname, word);
+    const size_t size = dictname.size() + 1 + word.size();
+
+    // 最多探测一圈，损坏的文件没有空槽时也会结束
+    for(uint64_t n = 0, i = h & _mask; n <= _mask; n++, i = (i + 1) & _mask) {
+      const Slot* slot = _slots + i;
+
+      if(slot->key == EMPTY) {
+        return NULL;
+      }
+
+      if(slot->hash != h) {
+        continue;
+      }
+
+      uint32_t length = 0;
+      const char* key = pooled(slot->key, length);
+
+      if(key != NULL && length == size
+          && memcmp(key, dictname.data(), dictname.size()) == 0
+          && key[dictname.size()] == '\001'
+          && memcmp(key + dictname.size() + 1, word.data(), word.size()) == 0) {
+        return slot;
+      }
+    }
+
+    return NULL;
+  }
+
+  MmapFile _file;
+  const Slot* _slots;
+  uint64_t _mask;
+  uint64_t _entries;
+  const char* _pool;
+  uint64_t _pool_size;
+};
+
+/**
+ * 训练时生成 MembershipTable 文件
+ */
+class MembershipTableBuilder {
+ public:
+  // 键相同时后加入的覆盖先加入的，与 leveldb::WriteBatch 一致
+  void add(const std::string& dictname, const std::string& word, const std::string& canonical) {
+    _entries[dictname + '\001' + word] = std::make_pair(MembershipTable::hash(dictname, word), canonical);
+  }
+
+  size_t size() const {
+    return _entries.size();
+  }
+
+  bool save(const std::string& path) const {
+    uint64_t slots = 2;
+
+    while(slots < _entries.size() * 2) {
+      slots <<= 1;
+    }
+
+    MembershipTable::Slot empty;
+    empty.hash = 0;
+    empty.key = MembershipTable::EMPTY;
+    empty.value = MembershipTable::EMPTY;
+    std::vector<MembershipTable::Slot> table(slots, empty);
+    std::string pool;
+
+    for(std::map<std::string, std::pair<uint64_t, std::string> >::const_iterator it = _entries.begin();
+        it != _entries.end(); it++) {
+      uint64_t i = it->second.first & (slots - 1);
+
+      while(table[i].key != MembershipTable::EMPTY) {
+        i = (i + 1) & (slots - 1);
+      }
+
+      table[i].hash = it->second.first;
+      table[i].key = append(pool, it->first);
+      table[i].value = append(pool, it->second.second);
+
+      if(pool.size() >= MembershipTable::EMPTY) {
+        return false; // 字符串区超过32位偏移
+      }
+    }
+
+    std::ofstream ofs(path.c_str(), std::ios::binary | std::ios::trunc);
+
+    if(!ofs.is_open()) {
+      return false;
+    }
+
+    writeBinary(ofs, (uint32_t) MembershipTable::MAGIC);
+    writeBinary(ofs, (uint32_t) MembershipTable::FORMAT);
+    writeBinary(ofs, slots);
+    writeBinary(ofs, (uint64_t) _entries.size());
+    writeBinary(ofs, (uint64_t) pool.size());
+    writeBinary(ofs, table.data(), table.size());
+    writeBinary(ofs, pool.data(), pool.size());
+    ofs.close();
+    return !ofs.fail();
+  }
+
+ private:
+  static uint32_t append(std::string& pool, const std::string& s) {
+    const uint32_t offset = pool.size();
+    const uint32_t size = s.size();
+    pool.append(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
+    pool.append(s);
+    return offset;
+  }
+
+  std::map<std::string, std::pair<uint64_t, std::string> > _entries; // 键 -> (哈希, 规范词条)
+};
+
+} // namespace utils
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
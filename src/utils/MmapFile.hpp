@@ -0,0 +1,200 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2019 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/utils/MmapFile.hpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2019-12-31_10:21:05
+ * @brief
+ * Read-only memory mapped file and helpers for simple binary artifacts.
+ **/
+
+#ifndef __CHATOPERA_UTILS_MMAP_FILE_H__
+#define __CHATOPERA_UTILS_MMAP_FILE_H__
+
+#include <string>
+#include <ostream>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "HashUtils.hpp"
+
+namespace chatopera {
+namespace utils {
+
+/**
+ * 只读映射整个文件，析构时解除映射
+ */
+class MmapFile {
+ public:
+  MmapFile() : _data(NULL), _size(0) {
+  }
+  ~MmapFile() {
+    close();
+  }
+
+  bool open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if(fd < 0) {
+      return false;
+    }
+
+    struct stat st;
+
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if(addr == MAP_FAILED) {
+      return false;
+    }
+
+    _data = static_cast<const char*>(addr);
+    _size = st.st_size;
+    return true;
+  }
+
+  void close() {
+    if(_data != NULL) {
+      munmap(const_cast<char*>(_data), _size);
+      _data = NULL;
+      _size = 0;
+    }
+  }
+
+  bool isOpen() const {
+    return _data != NULL;
+  }
+  const char* data() const {
+    return _data;
+  }
+  size_t size() const {
+    return _size;
+  }
+
+ private:
+  MmapFile(const MmapFile&);
+  MmapFile& operator=(const MmapFile&);
+
+  const char* _data;
+  size_t _size;
+};
+
+/**
+ * 顺序读取映射内存中的定长数据，越界时返回false
+ */
+class MmapReader {
+ public:
+  MmapReader(const char* data, size_t size) : _cur(data), _end(data + size) {
+  }
+  explicit MmapReader(const MmapFile& file) : _cur(file.data()), _end(file.data() + file.size()) {
+  }
+
+  template<typename T>
+  bool read(T& value) {
+    return read(&value, 1);
+  }
+
+  template<typename T>
+  bool read(T* values, size_t count) {
+    const char* p = skip(sizeof(T) * count);
+
+    if(p == NULL) {
+      return false;
+    }
+
+    if(count > 0) {
+      memcpy(values, p, sizeof(T) * count);
+    }
+
+    return true;
+  }
+
+  /** 返回当前位置并前移bytes，剩余不足时返回NULL */
+  const char* skip(size_t bytes) {
+    if(size_t(_end - _cur) < bytes) {
+      return NULL;
+    }
+
+    const char* p = _cur;
+    _cur += bytes;
+    return p;
+  }
+
+  size_t remaining() const {
+    return _end - _cur;
+  }
+
+ private:
+  const char* _cur;
+  const char* _end;
+};
+
+template<typename T>
+inline void writeBinary(std::ostream& os, const T& value) {
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+inline void writeBinary(std::ostream& os, const T* values, size_t count) {
+  if(count > 0) {
+    os.write(reinterpret_cast<const char*>(values), sizeof(T) * count);
+  }
+}
+
+/** 文件字节数，不存在时返回-1 */
+inline long long fileSize(const std::string& path) {
+  struct stat st;
+
+  if(stat(path.c_str(), &st) != 0) {
+    return -1;
+  }
+
+  return st.st_size;
+}
+
+/** 文件的修改时间(ns)，不存在时返回-1 */
+inline long long fileModified(const std::string& path) {
+  struct stat st;
+
+  if(stat(path.c_str(), &st) != 0) {
+    return -1;
+  }
+
+#ifdef __APPLE__
+  return (long long) st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+  return (long long) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+
+/** 文件内容的64位FNV-1a校验和，不存在或为空时返回0 */
+inline uint64_t fileChecksum(const std::string& path) {
+  MmapFile file;
+
+  if(!file.open(path)) {
+    return 0;
+  }
+
+  return fnv1a64(FNV1A64_INIT, file.data(), file.size());
+}
+
+} // namespace utils
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
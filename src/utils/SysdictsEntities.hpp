@@ -0,0 +1,127 @@
+/***************************************************************************
+ *
+ * Copyright (c) 2020 Chatopera.Inc, Inc. All Rights Reserved
+ *
+ **************************************************************************/
+
+/**
+ * @file /Users/hain/chatopera/chatopera.io/clause/src/utils/SysdictsEntities.hpp
+ * @author Hai Liang Wang(hain@chatopera.com)
+ * @date 2020-01-23_11:02:17
+ * @brief
+ * Map LAC tagging results to sysdicts entities, shared by sysdicts_server and
+ * the in process labeling of clause_server.
+ **/
+
+#ifndef __CHATOPERA_UTILS_SYSDICTS_ENTITIES_H__
+#define __CHATOPERA_UTILS_SYSDICTS_ENTITIES_H__
+
+#include <string>
+#include <vector>
+#include "glog/logging.h"
+#include "marcos.h"
+
+// LAC 单次标注返回的最大实体数
+#define CL_BOT_SYSDICT_MAX_RESULT_LEN 100
+
+namespace chatopera {
+namespace bot {
+namespace sysdicts {
+
+/**
+ * 保存实体信息到回复
+ * Data、Entity 为 sysdicts thrift 生成的类型，clause 和 sysdicts 各自生成一份，所以使用模板
+ */
+template<typename Data, typename Entity>
+inline bool set_entity_into_response(Data& _return,
+                                     const std::vector<Entity>& entities,
+                                     const bool& fetchall,
+                                     const std::string& dictname,
+                                     const std::string& val) {
+  VLOG(3) << __func__ << " dictname: " << dictname << ", value: " << val;
+
+  if(fetchall) {
+    Entity entity;
+    entity.dictname = dictname;
+    entity.val = val;
+    entity.__isset.dictname = true;
+    entity.__isset.val = true;
+    _return.entities.push_back(entity);
+    _return.__isset.entities = true;
+    return true;
+  }
+
+  for(typename std::vector<Entity>::const_iterator it = entities.begin(); it != entities.end(); it++) {
+    if(it->dictname != dictname)
+      continue;
+
+    // 多个词典属于同一个意图的不同槽位，有被覆盖的危险
+    bool settledown = false;
+
+    if(it->__isset.slotname && !(it->slotname.empty())) {
+      for(typename std::vector<Entity>::iterator it2 = _return.entities.begin(); it2 != _return.entities.end(); it2++) {
+        if(it2->dictname == dictname && (it2->slotname == it->slotname)) {
+          settledown = true;
+          break;
+        }
+      }
+    }
+
+    if(settledown)
+      continue;
+
+    Entity entity;
+    entity.val = val;
+    entity.dictname = dictname;
+
+    if(it->__isset.slotname && !(it->slotname.empty())) {
+      entity.slotname = it->slotname;
+      entity.__isset.slotname = true;
+    }
+
+    entity.__isset.dictname = true;
+    entity.__isset.val = true;
+    _return.entities.push_back(entity);
+    _return.__isset.entities = true;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * 将LAC的标注结果按标签转为系统词典的实体
+ * 请求中没有指定实体时返回所有结果
+ */
+template<typename Data, typename Tag>
+inline void set_tags_into_response(Data& _return,
+                                   const Data& request,
+                                   const Tag* tags,
+                                   const int& size) {
+  bool fetchall = !(request.__isset.entities && request.entities.size() > 0);
+
+  for(int i = 0; i < size; i++) {
+    std::string val = request.query.substr(tags[i].offset, tags[i].length);
+    VLOG(3) << __func__ << " parsed: " << val << " " << tags[i].type;
+    std::string type(tags[i].type);
+
+    if(type == CL_SYSDICT_LABEL_LOC) {
+      set_entity_into_response(_return, request.entities, fetchall, CL_SYSDICT_DICT_LOC, val);
+    } else if(type == CL_SYSDICT_LABEL_ORG) {
+      set_entity_into_response(_return, request.entities, fetchall, CL_SYSDICT_DICT_ORG, val);
+    } else if(type == CL_SYSDICT_LABEL_TIME) {
+      set_entity_into_response(_return, request.entities, fetchall, CL_SYSDICT_DICT_TIME, val);
+    } else if(type == CL_SYSDICT_LABEL_PER) {
+      set_entity_into_response(_return, request.entities, fetchall, CL_SYSDICT_DICT_PER, val);
+    }
+  }
+}
+
+} // namespace sysdicts
+} // namespace bot
+} // namespace chatopera
+
+#endif
+
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -73,6 +73,22 @@
 // BOT构建状态：取消训练
 #define CL_CHATBOT_BUILD_CANCAL   "cancelled"
 
+/**
+ * 意图分类
+ */
+// 线性分类器文件，位于版本目录
+#define CL_INTENT_LINEAR_MODEL "intent.linear.bin"
+// 线性分类器特征哈希桶数，2的幂；模型只保存出现过的特征，桶数不影响模型大小
+#define CL_INTENT_LINEAR_BUCKETS (1 << 14)
+
+/**
+ * 自定义词典
+ */
+// 词表词典的成员表文件，位于版本目录，见 MembershipTable.hpp
+#define CL_DICTWORDS_MEMBERSHIP "dictwords.member.bin"
+// 词表词典的AC自动机文件，位于版本目录，见 DictwordsAutomaton.hpp
+#define CL_DICTWORDS_AUTOMATON "dictwords.ac.bin"
+
 #endif
 
 /* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
\ No newline at end of file
@@ -744,6 +744,21 @@ int crfsuite_create_instance(const char *iid, void **ptr);
  */
 int crfsuite_create_instance_from_file(const char *filename, void **ptr);
 
+/**
+ * Create an instance of a model object from a model in memory.
+ *  The model object reads the memory block in place without copying it.
+ *  The memory block must stay valid until the model object is released.
+ *  Several model objects may share one memory block.
+ *  @param  data        The pointer to the memory block of the model.
+ *  @param  size        The size of the memory block in bytes.
+ *  @param  ptr         The pointer to \c void* that points to the
+ *                      instance of the model object if successful,
+ *                      *ptr points to \c NULL otherwise.
+ *  @return int         \c 0 if this function creates an object successfully,
+ *                      \c 1 otherwise.
+ */
+int crfsuite_create_instance_from_memory(const void *data, size_t size, void **ptr);
+
 /**
  * Create instances of tagging object from a model file.
  *  @param  filename    The filename of the model.
@@ -1035,6 +1050,25 @@ int crfsuite_interlocked_increment(int *count);
  */
 int crfsuite_interlocked_decrement(int *count);
 
+/**
+ * Viterbi kernels.
+ *  @see    crfsuite_set_viterbi_kernel().
+ */
+enum {
+    CRFSUITE_VITERBI_AUTO = 0,  /**< AVX2 when the CPU supports it, scalar otherwise. */
+    CRFSUITE_VITERBI_SCALAR,    /**< Always use the scalar loop. */
+};
+
+/**
+ * Select the kernel used by the Viterbi decoder.
+ *  Both kernels yield identical label sequences; the scalar one is kept for
+ *  benchmarking and for CPUs without AVX2. The setting is process-wide and
+ *  should not be changed while other threads are tagging.
+ *  @param  kernel      One of CRFSUITE_VITERBI_AUTO or CRFSUITE_VITERBI_SCALAR.
+ *  @return int         The kernel selected before this call.
+ */
+int crfsuite_set_viterbi_kernel(int kernel);
+
 /**@}*/
 
 /**@}*/
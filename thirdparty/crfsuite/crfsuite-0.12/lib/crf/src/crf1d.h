@@ -108,6 +108,22 @@ typedef struct {
      */
     floatval_t *trans;
 
+    /**
+     * Transposed transition scores (work space for the vectorized Viterbi).
+     *  This is a [ceil(L/4)][L][4] matrix whose element [b][i][k] represents
+     *  the score of the transition from label #i to label #(4*b+k), so that
+     *  the scores arriving at four consecutive labels are contiguous and
+     *  32-byte aligned. Lanes beyond L are zero. This member is allocated
+     *  and rebuilt lazily by crf1dc_viterbi() after the transition scores
+     *  are reset.
+     */
+    floatval_t *trans_t;
+
+    /**
+     * Non-zero if trans_t is consistent with trans.
+     */
+    int trans_t_ready;
+
     /**
      * Alpha score matrix.
      *  This is a [T][L] matrix whose element [t][l] presents the total
@@ -334,6 +350,7 @@ int crf1dmw_close_features(crf1dmw_t* writer);
 int crf1dmw_put_feature(crf1dmw_t* writer, int fid, const crf1dm_feature_t* f);
 
 crf1dm_t* crf1dm_new(const char *filename);
+crf1dm_t* crf1dm_new_from_memory(const void *data, size_t size);
 void crf1dm_close(crf1dm_t* model);
 int crf1dm_get_num_attrs(crf1dm_t* model);
 int crf1dm_get_num_labels(crf1dm_t* model);
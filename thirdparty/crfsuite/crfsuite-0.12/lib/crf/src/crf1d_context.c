@@ -46,6 +46,18 @@
 #include "crf1d.h"
 #include "vecmath.h"
 
+/*
+    The AVX2 Viterbi kernel is compiled with a per-function target attribute
+    and selected at runtime, so the library still runs on CPUs without AVX2.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define CRF1DC_USE_AVX2 1
+#include <immintrin.h>
+#endif
+
+static int viterbi_kernel = CRFSUITE_VITERBI_AUTO;
+
 
 
 crf1d_context_t* crf1dc_new(int flag, int L, int T)
@@ -141,6 +153,7 @@ void crf1dc_delete(crf1d_context_t* ctx)
         free(ctx->alpha_score);
         free(ctx->mexp_trans);
         _aligned_free(ctx->exp_trans);
+        _aligned_free(ctx->trans_t);
         free(ctx->trans);
     }
     free(ctx);
@@ -156,6 +169,7 @@ void crf1dc_reset(crf1d_context_t* ctx, int flag)
     }
     if (flag & RF_TRANS) {
         veczero(ctx->trans, L*L);
+        ctx->trans_t_ready = 0;
     }
 
     if (ctx->flag & CTXF_MARGINALS) {
@@ -462,19 +476,192 @@ floatval_t crf1dc_lognorm(crf1d_context_t* ctx)
     return ctx->log_norm;
 }
 
+int crfsuite_set_viterbi_kernel(int kernel)
+{
+    int prev = viterbi_kernel;
+    viterbi_kernel = kernel;
+    return prev;
+}
+
+static void crf1dc_viterbi_scalar(
+    crf1d_context_t* ctx,
+    const floatval_t *prev,
+    const floatval_t *state,
+    floatval_t *cur,
+    int *back
+    )
+{
+    int i, j;
+    floatval_t max_score, score;
+    const floatval_t *trans = NULL;
+    const int L = ctx->num_labels;
+
+    /* Compute the score of (t, j). */
+    for (j = 0;j < L;++j) {
+        max_score = -FLOAT_MAX;
+
+        for (i = 0;i < L;++i) {
+            /* Transit from (t-1, i) to (t, j). */
+            trans = TRANS_SCORE(ctx, i);
+            score = prev[i] + trans[j];
+
+            /* Store this path if it has the maximum score. */
+            if (max_score < score) {
+                max_score = score;
+                /* Backward link (#t, #j) -> (#t-1, #i). */
+                back[j] = i;
+            }
+        }
+        /* Add the state score on (t, j). */
+        cur[j] = max_score + state[j];
+    }
+}
+
+#ifdef  CRF1DC_USE_AVX2
+
+static int crf1dc_transpose_transition(crf1d_context_t* ctx)
+{
+    int b, i, k;
+    const int L = ctx->num_labels;
+    const int B = (L + 3) / 4;
+    floatval_t *dst = NULL;
+
+    if (ctx->trans_t == NULL) {
+        ctx->trans_t = (floatval_t*)_aligned_malloc(B * L * 4 * sizeof(floatval_t), 32);
+        if (ctx->trans_t == NULL) return CRFSUITEERR_OUTOFMEMORY;
+    }
+
+    dst = ctx->trans_t;
+    for (b = 0;b < B;++b) {
+        for (i = 0;i < L;++i) {
+            const floatval_t *trans = TRANS_SCORE(ctx, i);
+            for (k = 0;k < 4;++k) {
+                *dst++ = (4 * b + k < L) ? trans[4 * b + k] : 0.;
+            }
+        }
+    }
+
+    ctx->trans_t_ready = 1;
+    return 0;
+}
+
+/*
+    Computes the same recurrence as crf1dc_viterbi_scalar() for four labels
+    (j) at a time. The comparison is strict and i runs upwards, so ties keep
+    the smallest i exactly as the scalar loop does; the additions are the
+    same double operations, so the scores and paths are bit-identical.
+ */
+__attribute__((target("avx2")))
+static inline void crf1dc_viterbi_avx2_store(
+    const int L,
+    const int j,
+    __m256d max_score,
+    __m256d argmax,
+    const floatval_t *state,
+    floatval_t *cur,
+    int *back
+    )
+{
+    int k;
+    MIE_ALIGN(32) floatval_t cur4[4];
+    MIE_ALIGN(16) int back4[4];
+
+    if (j + 4 <= L) {
+        _mm256_storeu_pd(cur + j, _mm256_add_pd(max_score, _mm256_loadu_pd(state + j)));
+        _mm_storeu_si128((__m128i*)(back + j), _mm256_cvtpd_epi32(argmax));
+    } else {
+        _mm256_store_pd(cur4, max_score);
+        _mm_store_si128((__m128i*)back4, _mm256_cvtpd_epi32(argmax));
+        for (k = 0;j + k < L;++k) {
+            cur[j + k] = cur4[k] + state[j + k];
+            back[j + k] = back4[k];
+        }
+    }
+}
+
+/*
+    Computes the same recurrence as crf1dc_viterbi_scalar() for eight labels
+    (j) at a time, as two independent blocks of four to hide the latency of
+    the compare/blend chain. The comparison is strict and i runs upwards, so
+    ties keep the smallest i exactly as the scalar loop does; the additions
+    are the same double operations, so the scores and paths are bit-identical.
+ */
+__attribute__((target("avx2")))
+static void crf1dc_viterbi_avx2(
+    crf1d_context_t* ctx,
+    const floatval_t *prev,
+    const floatval_t *state,
+    floatval_t *cur,
+    int *back
+    )
+{
+    int i, j;
+    const int L = ctx->num_labels;
+    const floatval_t *trans = ctx->trans_t;
+
+    for (j = 0;j + 4 < L;j += 8, trans += 8 * L) {
+        const floatval_t *trans1 = trans + 4 * L;
+        __m256d max0 = _mm256_set1_pd(-FLOAT_MAX), max1 = max0;
+        __m256d arg0 = _mm256_setzero_pd(), arg1 = arg0;
+
+        for (i = 0;i < L;++i) {
+            /* Transit from (t-1, i) to (t, j..j+7). */
+            const __m256d p = _mm256_set1_pd(prev[i]);
+            const __m256d label = _mm256_set1_pd((double)i);
+            __m256d score0 = _mm256_add_pd(p, _mm256_load_pd(trans + 4 * i));
+            __m256d score1 = _mm256_add_pd(p, _mm256_load_pd(trans1 + 4 * i));
+            __m256d greater0 = _mm256_cmp_pd(score0, max0, _CMP_GT_OQ);
+            __m256d greater1 = _mm256_cmp_pd(score1, max1, _CMP_GT_OQ);
+            max0 = _mm256_blendv_pd(max0, score0, greater0);
+            max1 = _mm256_blendv_pd(max1, score1, greater1);
+            arg0 = _mm256_blendv_pd(arg0, label, greater0);
+            arg1 = _mm256_blendv_pd(arg1, label, greater1);
+        }
+
+        crf1dc_viterbi_avx2_store(L, j, max0, arg0, state, cur, back);
+        crf1dc_viterbi_avx2_store(L, j + 4, max1, arg1, state, cur, back);
+    }
+
+    if (j < L) {
+        __m256d max0 = _mm256_set1_pd(-FLOAT_MAX);
+        __m256d arg0 = _mm256_setzero_pd();
+
+        for (i = 0;i < L;++i) {
+            __m256d score0 = _mm256_add_pd(_mm256_set1_pd(prev[i]), _mm256_load_pd(trans + 4 * i));
+            __m256d greater0 = _mm256_cmp_pd(score0, max0, _CMP_GT_OQ);
+            max0 = _mm256_blendv_pd(max0, score0, greater0);
+            arg0 = _mm256_blendv_pd(arg0, _mm256_set1_pd((double)i), greater0);
+        }
+
+        crf1dc_viterbi_avx2_store(L, j, max0, arg0, state, cur, back);
+    }
+}
+
+#endif/*CRF1DC_USE_AVX2*/
+
 floatval_t crf1dc_viterbi(crf1d_context_t* ctx, int *labels)
 {
     int i, j, t;
     int *back = NULL;
-    floatval_t max_score, score, *cur = NULL;
-    const floatval_t *prev = NULL, *state = NULL, *trans = NULL;
+    floatval_t max_score, *cur = NULL;
+    const floatval_t *prev = NULL, *state = NULL;
     const int T = ctx->num_items;
     const int L = ctx->num_labels;
+    void (*step)(crf1d_context_t*, const floatval_t*, const floatval_t*, floatval_t*, int*) =
+        crf1dc_viterbi_scalar;
 
     /*
         This function assumes state and trans scores to be in the logarithm domain.
      */
 
+#ifdef  CRF1DC_USE_AVX2
+    if (viterbi_kernel == CRFSUITE_VITERBI_AUTO && 1 < T && __builtin_cpu_supports("avx2")) {
+        if (ctx->trans_t_ready || crf1dc_transpose_transition(ctx) == 0) {
+            step = crf1dc_viterbi_avx2;
+        }
+    }
+#endif/*CRF1DC_USE_AVX2*/
+
     /* Compute the scores at (0, *). */
     cur = ALPHA_SCORE(ctx, 0);
     state = STATE_SCORE(ctx, 0);
@@ -488,26 +675,7 @@ floatval_t crf1dc_viterbi(crf1d_context_t* ctx, int *labels)
         cur = ALPHA_SCORE(ctx, t);
         state = STATE_SCORE(ctx, t);
         back = BACKWARD_EDGE_AT(ctx, t);
-
-        /* Compute the score of (t, j). */
-        for (j = 0;j < L;++j) {
-            max_score = -FLOAT_MAX;
-
-            for (i = 0;i < L;++i) {
-                /* Transit from (t-1, i) to (t, j). */
-                trans = TRANS_SCORE(ctx, i);
-                score = prev[i] + trans[j];
-
-                /* Store this path if it has the maximum score. */
-                if (max_score < score) {
-                    max_score = score;
-                    /* Backward link (#t, #j) -> (#t-1, #i). */
-                    back[j] = i;
-                }
-            }
-            /* Add the state score on (t, j). */
-            cur[j] = max_score + state[j];
-        }
+        step(ctx, prev, state, cur, back);
     }
 
     /* Find the node (#T, #i) that reaches EOS with the maximum score. */
@@ -700,37 +700,20 @@ int crf1dmw_put_feature(crf1dmw_t* writer, int fid, const crf1dm_feature_t* f)
     return 0;
 }
 
-crf1dm_t* crf1dm_new(const char *filename)
+static crf1dm_t* crf1dm_new_impl(uint8_t* buffer_orig, uint8_t* buffer, uint32_t size)
 {
-    FILE *fp = NULL;
     uint8_t* p = NULL;
     crf1dm_t *model = NULL;
     header_t *header = NULL;
 
     model = (crf1dm_t*)calloc(1, sizeof(crf1dm_t));
     if (model == NULL) {
-        goto error_exit;
-    }
-
-    fp = fopen(filename, "rb");
-    if (fp == NULL) {
-        goto error_exit;
-    }
-
-    fseek(fp, 0, SEEK_END);
-    model->size = (uint32_t)ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    model->buffer = model->buffer_orig = (uint8_t*)malloc(model->size + 16);
-    while ((uintptr_t)model->buffer % 16 != 0) {
-        ++model->buffer;
+        return NULL;
     }
 
-    if (fread(model->buffer, 1, model->size, fp) != model->size) {
-        free(model->buffer_orig);
-        goto error_exit;
-    }
-    fclose(fp);
+    model->buffer_orig = buffer_orig;
+    model->buffer = buffer;
+    model->size = size;
 
     /* Write the file header. */
     header = (header_t*)calloc(1, sizeof(header_t));
@@ -761,15 +744,55 @@ crf1dm_t* crf1dm_new(const char *filename)
         );
 
     return model;
+}
 
-error_exit:
-    if (model != NULL) {
-        free(model);
+crf1dm_t* crf1dm_new(const char *filename)
+{
+    FILE *fp = NULL;
+    uint8_t* buffer_orig = NULL;
+    uint8_t* buffer = NULL;
+    uint32_t size = 0;
+    crf1dm_t *model = NULL;
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        return NULL;
     }
-    if (fp != NULL) {
+
+    fseek(fp, 0, SEEK_END);
+    size = (uint32_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    buffer = buffer_orig = (uint8_t*)malloc(size + 16);
+    if (buffer_orig == NULL) {
         fclose(fp);
+        return NULL;
     }
-    return NULL;
+    while ((uintptr_t)buffer % 16 != 0) {
+        ++buffer;
+    }
+
+    if (fread(buffer, 1, size, fp) != size) {
+        free(buffer_orig);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+
+    model = crf1dm_new_impl(buffer_orig, buffer, size);
+    if (model == NULL) {
+        free(buffer_orig);
+    }
+    return model;
+}
+
+/*
+ * The model reads the caller's buffer in place and does not free it; the
+ * buffer must outlive the model. Several models may share one buffer.
+ */
+crf1dm_t* crf1dm_new_from_memory(const void *data, size_t size)
+{
+    return crf1dm_new_impl(NULL, (uint8_t*)data, (uint32_t)size);
 }
 
 void crf1dm_close(crf1dm_t* model)
@@ -43,6 +43,7 @@
 int crf1de_create_instance(const char *iid, void **ptr);
 int crfsuite_dictionary_create_instance(const char *interface, void **ptr);
 int crf1m_create_instance_from_file(const char *filename, void **ptr);
+int crf1m_create_instance_from_memory(const void *data, size_t size, void **ptr);
 
 int crfsuite_create_instance(const char *iid, void **ptr)
 {
@@ -59,6 +60,12 @@ int crfsuite_create_instance_from_file(const char *filename, void **ptr)
     return ret;
 }
 
+int crfsuite_create_instance_from_memory(const void *data, size_t size, void **ptr)
+{
+    int ret = crf1m_create_instance_from_memory(data, size, ptr);
+    return ret;
+}
+
 
 
 void crfsuite_attribute_init(crfsuite_attribute_t* cont)